@@ -1,15 +1,47 @@
 package com.soundVisualizationsNonEngine;
 import android.media.audiofx.Visualizer;
+import java.nio.ByteBuffer;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
 
 public class SoundVisualizer {
   Visualizer soundViz;
-  static native void nativeSendWaveForm(long callbackObject, byte[] bytes, int sampleRate);
+  // Shared with native code, which reads each waveform and spectrum straight out of them
+  ByteBuffer captureBuffer;
+  ByteBuffer fftBuffer;
+  static native void nativeSetCaptureBuffers(long callbackObject, ByteBuffer waveBuffer, ByteBuffer fftBuffer);
+  static native void nativeSetCaptureLimits(long callbackObject, int minSize, int maxSize, int maxRate);
+  static native void nativeSendWaveForm(long callbackObject, int length, int sampleRate);
+  static native void nativeSendFft(long callbackObject, int length, int samplingRate);
 
   static public SoundVisualizer createSoundVisualizer(long callbackObject, int sampleRate) {
     return new SoundVisualizer(callbackObject, sampleRate);
   }
 
-  boolean bEnabled;
+  // Every visualizer is reconfigured on this one thread, in the order the requests were made
+  static final ExecutorService worker = Executors.newSingleThreadExecutor();
+
+  // What native code asked for; the worker brings the Visualizer in line with it
+  volatile boolean bEnabled;
+  volatile boolean bFftEnabled;
+  volatile int captureSize;
+  volatile int captureRate;
+  // Set once release() has begun; held while a callback is in native code, so release() waits for it
+  boolean bReleased;
+  final Object callbackLock = new Object();
+  // Worker thread only: what the listener was registered with
+  boolean bListenerFft;
+  int listenerRate;
+  final long callbackObject;
+  final int sampleRate;
+
+  final Runnable applyTask = new Runnable() {
+    public void run() {
+      apply();
+    }
+  };
 
   static void error(String message) {
     android.util.Log.e("SoundVisualizer", message);
@@ -20,36 +52,132 @@ public class SoundVisualizer {
   }
 
   public SoundVisualizer(final long callbackObject, final int sampleRate) {
+    this.callbackObject = callbackObject;
+    this.sampleRate = sampleRate;
     soundViz = new Visualizer(0);
-    if (soundViz.setCaptureSize(Visualizer.getCaptureSizeRange()[1]) != Visualizer.SUCCESS) {
-      error("invalid capture size: "+ Visualizer.getCaptureSizeRange()[1]);
+    final int[] sizeRange = Visualizer.getCaptureSizeRange();
+    captureSize = sizeRange[1];
+    captureRate = Visualizer.getMaxCaptureRate();
+    note("maxSize="+captureSize+" maxRate="+captureRate);
+    // Sized for the largest capture so they never have to be swapped under a running capture
+    captureBuffer = ByteBuffer.allocateDirect(sizeRange[1]);
+    fftBuffer = ByteBuffer.allocateDirect(sizeRange[1]);
+    nativeSetCaptureBuffers(callbackObject, captureBuffer, fftBuffer);
+    nativeSetCaptureLimits(callbackObject, sizeRange[0], sizeRange[1], captureRate);
+    worker.execute(applyTask);
+  }
+
+  // Worker thread only. The capture size and listener can only change while the visualizer is disabled.
+  void apply() {
+    if (soundViz == null) {
+      return;
+    }
+    final boolean enabled = bEnabled;
+    final boolean fft = bFftEnabled;
+    final int size = captureSize;
+    final int rate = captureRate;
+    final boolean resize = size != soundViz.getCaptureSize();
+    final boolean relisten = fft != bListenerFft || rate != listenerRate;
+    if ((!enabled || resize || relisten) && soundViz.getEnabled()) {
+      soundViz.setEnabled(false);
     }
-    final int maxRate = Visualizer.getMaxCaptureRate();
-    note("maxRate="+maxRate);
+    if (resize && soundViz.setCaptureSize(size) != Visualizer.SUCCESS) {
+      error("invalid capture size: "+ size);
+    }
+    if (relisten) {
+      setCaptureListener(fft, rate);
+    }
+    if (enabled && !soundViz.getEnabled()) {
+      soundViz.setEnabled(true);
+    }
+  }
+
+  void setCaptureListener(final boolean fft, final int rate) {
+    note("rate="+rate+" fft="+fft);
     if (soundViz.setDataCaptureListener(new Visualizer.OnDataCaptureListener() {
         @Override
         public void onWaveFormDataCapture(Visualizer visualizer, byte[] bytes, int sampleRate) {
           //note("wave capture: "+ bytes.length + " bytes. SampleRate: "+sampleRate + " Callback: "+callbackObject);
-          if (bEnabled) {
-            nativeSendWaveForm(callbackObject, bytes, sampleRate);
+          synchronized (callbackLock) {
+            if (bEnabled && !bReleased) {
+              final int length = Math.min(bytes.length, captureBuffer.capacity());
+              captureBuffer.clear();
+              captureBuffer.put(bytes, 0, length);
+              nativeSendWaveForm(callbackObject, length, sampleRate);
+            }
           }
         }
         
         @Override
-        public void onFftDataCapture(Visualizer visualizer, byte[] bytes, int i) {
-          
+        public void onFftDataCapture(Visualizer visualizer, byte[] bytes, int samplingRate) {
+          synchronized (callbackLock) {
+            if (bEnabled && bFftEnabled && !bReleased) {
+              final int length = Math.min(bytes.length, fftBuffer.capacity());
+              fftBuffer.clear();
+              fftBuffer.put(bytes, 0, length);
+              nativeSendFft(callbackObject, length, samplingRate);
+            }
+          }
         }
-      }, maxRate, true, false) != Visualizer.SUCCESS) {
+      }, rate, true, fft) != Visualizer.SUCCESS) {
       error("setDataCaptureListenerFailed: "+sampleRate);
+      return;
     }
+    bListenerFft = fft;
+    listenerRate = rate;
   }
 
   public void setEnabled(final boolean value) {
     bEnabled = value;
-    new Thread() {
+    worker.execute(applyTask);
+  }
+
+  public void setFftCaptureEnabled(final boolean value) {
+    bFftEnabled = value;
+    worker.execute(applyTask);
+  }
+
+  public void setCaptureFormat(final boolean enabled, final int size, final int rate) {
+    captureSize = size;
+    captureRate = Math.min(rate, Visualizer.getMaxCaptureRate());
+    bEnabled = enabled;
+    worker.execute(applyTask);
+  }
+
+  // Stops capture for good and frees the Visualizer's audio session, of which the platform allows only a
+  // few. Returns once no callback can reach native code again, so the caller may free callbackObject.
+  public void release() {
+    synchronized (callbackLock) {
+      bEnabled = false;
+      bReleased = true;
+    }
+    final Future<?> done = worker.submit(new Runnable() {
       public void run() {
-        soundViz.setEnabled(value);
+        if (soundViz == null) {
+          return;
+        }
+        soundViz.setEnabled(false);
+        soundViz.setDataCaptureListener(null, listenerRate, false, false);
+        soundViz.release();
+        soundViz = null;
+        captureBuffer = null;
+        fftBuffer = null;
+      }
+    });
+    boolean interrupted = false;
+    while (true) {
+      try {
+        done.get();
+        break;
+      } catch (InterruptedException e) {
+        interrupted = true;
+      } catch (ExecutionException e) {
+        error("release failed: "+e.getCause());
+        break;
       }
-    }.start();
+    }
+    if (interrupted) {
+      Thread.currentThread().interrupt();
+    }
   }
 }
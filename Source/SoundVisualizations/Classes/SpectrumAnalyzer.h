@@ -6,43 +6,106 @@
 #include "IMediaPlayer.h"
 #include "IMediaAudioSink.h"
 #include "MediaSoundWave.h"
-#include "CircularBuffer.h"
 #include "WeakObjectPtr.h"
-#if PLATFORM_ANDROID
-#include <jni.h>
-#endif
 #include "SpectrumAnalyzer.generated.h"
 
-class SOUNDVISUALIZATIONSNONENGINE_API SinkDelegate : public IMediaAudioSink
+struct FSpectrumAnalysisResult;
+struct FSpectrumAnalysisSettings;
+class FMediaAudioHub;
+class FSharedSpectrumAnalysis;
+class FBakedSpectrogram;
+
+/** Tapering applied to each analysis window before the FFT */
+UENUM(BlueprintType)
+enum class ESpectrumWindowType : uint8
 {
-	FWeakObjectPtr Analyzer;
-	int32 SampleRate;
-	int32 Channels;
-public:
-	SinkDelegate(class USpectrumAnalyzer *InAnalyzer = nullptr);
-	UMediaSoundWave* GetSoundWave();
-	int32 GetNumChannels() { return Channels; }
-	int32 GetSamplesPerSecond() { return SampleRate; }
-
-	// IMediaAudioSink overrides
-	virtual void FlushAudioSink() override;
-	virtual bool InitializeAudioSink(uint32 InChannels, uint32 InSampleRate);
-	virtual int32 GetAudioSinkChannels() const override;
-	virtual int32 GetAudioSinkSampleRate() const override;
-	virtual void PauseAudioSink() override;
-	virtual void PlayAudioSink(const uint8* Buffer, uint32 BufferSize, FTimespan Time) override;
-	virtual void ResumeAudioSink() override;
-	virtual void ShutdownAudioSink() override;
+	Hann,
+	Hamming,
+	BlackmanHarris,
+	/** Kaiser with beta = 8.6, roughly Blackman sidelobes */
+	Kaiser,
+	/** Flat top, for accurate peak amplitudes at the cost of frequency resolution */
+	FlatTop,
+};
+
+/** How FFT bins are grouped into the SpectrumWidth output bands */
+UENUM(BlueprintType)
+enum class ESpectrumBandScale : uint8
+{
+	/** Equal width bands from DC to Nyquist */
+	Linear,
+	/** Bands of equal width in log frequency, from MinFrequency to Nyquist */
+	Logarithmic,
+	Mel,
+	Bark,
+	/** 1/OctaveFraction octave bands starting at MinFrequency */
+	Octave,
+};
 
+/** Where spectra come from */
+UENUM(BlueprintType)
+enum class ESpectrumAnalysisBackend : uint8
+{
+	/** Window the audio and run our own FFT */
+	Native,
+	/**
+	 * Map the spectrum captured by the Android Visualizer onto the bands and run no FFT at all. Only the
+	 * output mix is captured, so every channel gets the same spectrum, and no window is applied. Same as
+	 * Native on other platforms.
+	 */
+	PlatformFFT,
+};
+
+/** Bytes per value of a baked spectrogram */
+UENUM(BlueprintType)
+enum class ESpectrogramBakePrecision : uint8
+{
+	/** Steps of about half a dB over the 120 dB a 16 bit sound spans */
+	EightBit,
+	SixteenBit,
 };
 
+/**
+ * Spectra and amplitudes of every channel for one analysis window, as returned by GetAnalysisFrame.
+ * Each array holds NumChannels + 1 runs back to back: run 0 mixes all channels and run c holds
+ * channel c, the same numbering as the Channel argument of the other queries.
+ */
+USTRUCT(BlueprintType)
+struct FSpectrumAnalysisFrame
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Channels of the audio; 0 when there is no analysis yet */
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		int32 NumChannels;
+	/** Run c of Spectrum starts at c * SpectrumStride */
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		TArray<float> Spectrum;
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		int32 SpectrumStride;
+	/** Run c of Amplitude starts at c * AmplitudeStride */
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		TArray<float> Amplitude;
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		int32 AmplitudeStride;
+	/** Playback position in seconds the window was analyzed for */
+	UPROPERTY(Category = "SoundVisualization", BlueprintReadOnly)
+		float Time;
+
+	FSpectrumAnalysisFrame()
+		: NumChannels(0)
+		, SpectrumStride(0)
+		, AmplitudeStride(0)
+		, Time(0.f)
+	{
+	}
+};
 
 UCLASS(BlueprintType, Blueprintable, meta = (BlueprintSpawnableComponent))
 class SOUNDVISUALIZATIONSNONENGINE_API USpectrumAnalyzer : public UActorComponent
 {
 	GENERATED_UCLASS_BODY()
 public:
-	virtual ~USpectrumAnalyzer();
 	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadOnly)
 		UMediaPlayer *MediaPlayer;
 	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadOnly)
@@ -53,13 +116,95 @@ public:
 		int32 SpectrumWidth;
 	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadOnly)
 		int32 AmplitudeBuckets;
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite)
+		ESpectrumWindowType WindowType;
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite)
+		ESpectrumBandScale BandScale;
+	/** Lowest frequency in Hz covered by the Logarithmic, Mel, Bark and Octave scales */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1.0"))
+		float MinFrequency;
+	/** Bands per octave for the Octave scale */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 OctaveFraction;
+	/**
+	 * Analyze on a background thread as audio arrives instead of inside the Blueprint calls, which then
+	 * just copy the latest finished analysis. See AnalysisStaleness for how far behind it is.
+	 */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite)
+		bool bAnalyzeOnWorkerThread;
+	/**
+	 * Analyze the audio as it arrives at a fixed hop instead of whenever results are requested, and
+	 * return the frame heard at the current playback position. The cost then depends only on the
+	 * audio, not the frame rate. Runs on the worker thread if bAnalyzeOnWorkerThread is set,
+	 * otherwise on the thread delivering the audio.
+	 */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite)
+		bool bStreamingAnalysis;
+	/** Hop between streaming frames as a fraction of the FFT size; 0.5 overlaps frames by 50%, 0.25 by 75% */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.05", ClampMax = "1.0"))
+		float HopFraction;
+	/**
+	 * Where spectra come from. Where PlatformFFT is available it ignores bAnalyzeOnWorkerThread and
+	 * bStreamingAnalysis: mapping a capture on the game thread costs less than handing it to another thread.
+	 */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite)
+		ESpectrumAnalysisBackend AnalysisBackend;
+	/** Number of recent spectra kept for GetSpectrogram; 0 turns the history off */
+	UPROPERTY(Category = "SoundVisualization", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+		int32 SpectrogramFrames;
+	/** Seconds between the playback position and the window behind the last returned results */
+	UPROPERTY(Category = "SoundVisualization", VisibleAnywhere, BlueprintReadOnly, Transient)
+		float AnalysisStaleness;
+	/** Spectrum and amplitude queries answered from the last analysis because playback had not moved */
+	UPROPERTY(Category = "SoundVisualization", VisibleAnywhere, BlueprintReadOnly, Transient)
+		int32 AnalysisCacheHits;
+	/** Spectrum and amplitude queries that had to analyze a new window */
+	UPROPERTY(Category = "SoundVisualization", VisibleAnywhere, BlueprintReadOnly, Transient)
+		int32 AnalysisCacheMisses;
+	/** Audio captures the platform delivered per second, where audio is captured rather than handed over by the player (Android) */
+	UPROPERTY(Category = "SoundVisualization", VisibleAnywhere, BlueprintReadOnly, Transient)
+		float CaptureCallbacksPerSecond;
+	/** Bytes of captured audio handed over from Java per second */
+	UPROPERTY(Category = "SoundVisualization", VisibleAnywhere, BlueprintReadOnly, Transient)
+		float CaptureBytesPerSecond;
 
 	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
 		void CalculateFrequencySpectrum(int32 Channel, TArray<float>& OutSpectrum);
 	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
 		void GetAmplitude(int32 Channel, TArray<float>& OutAmplitudes);
+	/**
+	 * Spectra and amplitudes of every channel from one window, for the cost of a single
+	 * CalculateFrequencySpectrum call. Returns false, with NumChannels 0 and empty arrays, if there is
+	 * no analysis yet. OutFrame's arrays keep their allocations between calls.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
+		bool GetAnalysisFrame(FSpectrumAnalysisFrame& OutFrame);
+	/**
+	 * Copies the spectra of up to NumFrames of the most recent frames heard so far, oldest first, into one
+	 * flat array; frame i starts at i * OutStride. Returns the number of frames copied.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
+		int32 GetSpectrogram(int32 Channel, int32 NumFrames, TArray<float>& OutSpectrogram, int32& OutStride);
+	/** Like GetSpectrogram, for the frames heard between StartTime and EndTime, in seconds of media time. */
+	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
+		int32 GetSpectrogramInTimeRange(int32 Channel, float StartTime, float EndTime, TArray<float>& OutSpectrogram, int32& OutStride);
 
-	virtual void ProcessMediaSample(uint32 Channels, uint32 SampleRate, const uint8* Buffer, uint32 BufferSize, FTimespan Duration, FTimespan Time);
+	/**
+	 * Analyzes the whole of Source, or the WAV file at MediaUrl if Source is null, with this analyzer's
+	 * settings and saves every frame next to MediaUrl. Analyzers whose player opens MediaUrl then look
+	 * their results up by playback time in the baked frames instead of running any FFT, as long as
+	 * their settings match apart from HopFraction and AnalysisBackend. Blocks until done.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "SoundVisualization")
+		bool BakeSpectrogram(USoundWave* Source, const FString& MediaUrl, ESpectrogramBakePrecision Precision);
+
+	/**
+	 * Native versions of CalculateFrequencySpectrum and GetAmplitude that write into the caller's storage
+	 * and never allocate. Out is filled from the start and anything past the analyzed bands is zeroed.
+	 * Returns the number of bands analyzed, which may exceed Out.Num(), or 0 if there is no analysis yet.
+	 */
+	int32 CopyFrequencySpectrum(int32 Channel, TArrayView<float> OutSpectrum);
+	int32 CopyAmplitude(int32 Channel, TArrayView<float> OutAmplitudes);
 
 	virtual void BeginPlay() override;
 	virtual void BeginDestroy() override;
@@ -75,23 +220,27 @@ public:
 		void HandleMediaClosed();
 
 private:
-	void ConnectSink();
-	bool DoCalculateFrequencySpectrum(bool bSplitChannels, TArray<TArray<float> >& OutSpectrums);
-	bool DoGetAmplitude(bool bSplitChannels, TArray<TArray<float> >& OutSpectrums);
-	TCircularBuffer<int16>  *PCMData;
-	FTimespan CurrentTime;
+	FSpectrumAnalysisSettings GetAnalysisSettings() const;
+	/** Subscribes to MediaPlayer's hub if not already, or null if there is no MediaPlayer. */
+	FMediaAudioHub* AcquireHub();
+	/** The shared analysis matching the current configuration, or null if there is no MediaPlayer. */
+	FSharedSpectrumAnalysis* AcquireAnalysis();
+	void ReleaseHub();
+	/** Analyzes the window ending at the current playback position, or returns the cached result if it has not moved. */
+	const FSpectrumAnalysisResult* UpdateAnalysis();
+	const FSpectrumAnalysisResult* AnalyzeOnGameThread(FSharedSpectrumAnalysis& Shared, const FSpectrumAnalysisSettings& Settings);
+	/** AnalyzeOnGameThread for the PlatformFFT backend, or null if nothing has been captured yet */
+	const FSpectrumAnalysisResult* AnalyzeCaptureOnGameThread(FSharedSpectrumAnalysis& Shared, const FSpectrumAnalysisSettings& Settings);
+	/** UpdateAnalysis for a baked spectrogram: looks up the frame heard at the current playback position */
+	const FSpectrumAnalysisResult* LookupBakedOnGameThread(FSharedSpectrumAnalysis& Shared, const TSharedPtr<FBakedSpectrogram, ESPMode::ThreadSafe>& Baked);
+	/** UpdateAnalysis, or null if the result has no run for Channel */
+	const FSpectrumAnalysisResult* UpdateChannelAnalysis(int32 Channel);
+	int32 CopySpectrogram(int32 Channel, FTimespan StartTime, FTimespan EndTime, int32 MaxFrames, TArray<float>& OutSpectrogram, int32& OutStride);
 	FTimespan PlaybackTime;
-	TSharedRef<SinkDelegate, ESPMode::ThreadSafe> Sink;
-	uint32 CurSampleIndex;
-	mutable FCriticalSection CriticalSection;
-#if PLATFORM_ANDROID
-public:
-	void HandleCapture(const uint8* WaveForm, uint32 WaveFormSize);
-	TArray<int16> ResampleBuffer;
-	jobject Visualizer;
-	static jclass VisualizerClass;
-	static jmethodID CreateVisualizer;
-	static jmethodID EnableVisualizer;
-	static void InitMethodIds();
-#endif
+	/** Sink of MediaPlayer's audio, shared with every other analyzer of it */
+	TSharedPtr<FMediaAudioHub, ESPMode::ThreadSafe> Hub;
+	/** Sound wave this analyzer added to Hub */
+	UMediaSoundWave* HubSoundWave;
+	/** Analysis shared with the other analyzers of Hub configured the same way */
+	TSharedPtr<FSharedSpectrumAnalysis, ESPMode::ThreadSafe> Analysis;
 };
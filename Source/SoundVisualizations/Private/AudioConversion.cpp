@@ -0,0 +1,368 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "AudioConversion.h"
+
+#if defined(__AVX2__)
+#define SOUNDVIS_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUNDVIS_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOUNDVIS_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	void DeinterleaveGeneric(const int16* In, uint32 NumChannels, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+	{
+		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+		{
+			const int16* Src = In + ChannelIndex;
+			float* Dst = Out + ChannelIndex * OutPlaneStride;
+			for (uint32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+			{
+				Dst[FrameIndex] = Src[FrameIndex * NumChannels];
+			}
+		}
+	}
+
+	uint32 DeinterleaveMono(const int16* In, uint32 NumFrames, float* Out)
+	{
+		uint32 Frame = 0;
+#if SOUNDVIS_SIMD_SSE2
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const __m128i Samples = _mm_loadu_si128((const __m128i*)(In + Frame));
+			// Unpacking a register with itself and shifting right sign extends each sample
+			const __m128i Lo = _mm_srai_epi32(_mm_unpacklo_epi16(Samples, Samples), 16);
+			const __m128i Hi = _mm_srai_epi32(_mm_unpackhi_epi16(Samples, Samples), 16);
+			_mm_storeu_ps(Out + Frame, _mm_cvtepi32_ps(Lo));
+			_mm_storeu_ps(Out + Frame + 4, _mm_cvtepi32_ps(Hi));
+		}
+#elif SOUNDVIS_SIMD_NEON
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const int16x8_t Samples = vld1q_s16(In + Frame);
+			vst1q_f32(Out + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Samples))));
+			vst1q_f32(Out + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(Samples))));
+		}
+#endif
+		return Frame;
+	}
+
+	uint32 DeinterleaveStereo(const int16* In, uint32 NumFrames, float* OutLeft, float* OutRight)
+	{
+		uint32 Frame = 0;
+#if SOUNDVIS_SIMD_AVX2
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			// Each 32 bit lane holds one frame: left in the low half, right in the high half
+			const __m256i Frames = _mm256_loadu_si256((const __m256i*)(In + Frame * 2));
+			const __m256i Left = _mm256_srai_epi32(_mm256_slli_epi32(Frames, 16), 16);
+			const __m256i Right = _mm256_srai_epi32(Frames, 16);
+			_mm256_storeu_ps(OutLeft + Frame, _mm256_cvtepi32_ps(Left));
+			_mm256_storeu_ps(OutRight + Frame, _mm256_cvtepi32_ps(Right));
+		}
+#endif
+#if SOUNDVIS_SIMD_SSE2
+		for (; Frame + 4 <= NumFrames; Frame += 4)
+		{
+			const __m128i Frames = _mm_loadu_si128((const __m128i*)(In + Frame * 2));
+			const __m128i Left = _mm_srai_epi32(_mm_slli_epi32(Frames, 16), 16);
+			const __m128i Right = _mm_srai_epi32(Frames, 16);
+			_mm_storeu_ps(OutLeft + Frame, _mm_cvtepi32_ps(Left));
+			_mm_storeu_ps(OutRight + Frame, _mm_cvtepi32_ps(Right));
+		}
+#elif SOUNDVIS_SIMD_NEON
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const int16x8x2_t Frames = vld2q_s16(In + Frame * 2);
+			vst1q_f32(OutLeft + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Frames.val[0]))));
+			vst1q_f32(OutLeft + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(Frames.val[0]))));
+			vst1q_f32(OutRight + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Frames.val[1]))));
+			vst1q_f32(OutRight + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(Frames.val[1]))));
+		}
+#endif
+		return Frame;
+	}
+
+#if SOUNDVIS_SIMD_SSE2
+	/** Transposes 4 frames of 4 channels, held two frames per register, into channels 0 and 1 (Pairs[0]) and 2 and 3 (Pairs[1]) */
+	inline void TransposeQuad(__m128i R0, __m128i R1, __m128i Pairs[2])
+	{
+		const __m128i A0 = _mm_unpacklo_epi16(R0, R1), A1 = _mm_unpackhi_epi16(R0, R1);
+		Pairs[0] = _mm_unpacklo_epi16(A0, A1);
+		Pairs[1] = _mm_unpackhi_epi16(A0, A1);
+	}
+
+	/** Widens the low four samples of Samples into Dst and the high four into Dst + OutPlaneStride */
+	inline void StorePair(__m128i Samples, float* Dst, uint32 OutPlaneStride)
+	{
+		_mm_storeu_ps(Dst, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(Samples, Samples), 16)));
+		_mm_storeu_ps(Dst + OutPlaneStride, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(Samples, Samples), 16)));
+	}
+#endif
+
+	uint32 DeinterleaveQuad(const int16* In, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+	{
+		uint32 Frame = 0;
+#if SOUNDVIS_SIMD_SSE2
+		for (; Frame + 4 <= NumFrames; Frame += 4)
+		{
+			__m128i Pairs[2];
+			TransposeQuad(_mm_loadu_si128((const __m128i*)(In + Frame * 4)), _mm_loadu_si128((const __m128i*)(In + Frame * 4 + 8)), Pairs);
+			StorePair(Pairs[0], Out + Frame, OutPlaneStride);
+			StorePair(Pairs[1], Out + 2 * OutPlaneStride + Frame, OutPlaneStride);
+		}
+#elif SOUNDVIS_SIMD_NEON
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const int16x8x4_t Frames = vld4q_s16(In + Frame * 4);
+			for (int32 ChannelIndex = 0; ChannelIndex < 4; ++ChannelIndex)
+			{
+				float* Dst = Out + ChannelIndex * OutPlaneStride + Frame;
+				vst1q_f32(Dst, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Frames.val[ChannelIndex]))));
+				vst1q_f32(Dst + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(Frames.val[ChannelIndex]))));
+			}
+		}
+#endif
+		return Frame;
+	}
+
+	uint32 DeinterleaveHexa(const int16* In, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+	{
+		uint32 Frame = 0;
+#if SOUNDVIS_SIMD_SSE2
+		// Frames are 12 bytes, so each is split into its first four channels, transposed as quad, and
+		// its last two, which line up as a stereo frame per 32 bit lane
+		for (; Frame + 4 <= NumFrames; Frame += 4)
+		{
+			const int16* Src = In + Frame * 6;
+			__m128i Heads[4], Tails[4];
+			for (int32 FrameIndex = 0; FrameIndex < 4; ++FrameIndex)
+			{
+				// Channels 0-3, and 2-5 so the load stays inside the frame
+				Heads[FrameIndex] = _mm_loadl_epi64((const __m128i*)(Src + FrameIndex * 6));
+				Tails[FrameIndex] = _mm_loadl_epi64((const __m128i*)(Src + FrameIndex * 6 + 2));
+			}
+			__m128i Pairs[2];
+			TransposeQuad(_mm_unpacklo_epi64(Heads[0], Heads[1]), _mm_unpacklo_epi64(Heads[2], Heads[3]), Pairs);
+			StorePair(Pairs[0], Out + Frame, OutPlaneStride);
+			StorePair(Pairs[1], Out + 2 * OutPlaneStride + Frame, OutPlaneStride);
+
+			const __m128i Tail = _mm_unpackhi_epi64(_mm_unpacklo_epi32(Tails[0], Tails[1]), _mm_unpacklo_epi32(Tails[2], Tails[3]));
+			_mm_storeu_ps(Out + 4 * OutPlaneStride + Frame, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(Tail, 16), 16)));
+			_mm_storeu_ps(Out + 5 * OutPlaneStride + Frame, _mm_cvtepi32_ps(_mm_srai_epi32(Tail, 16)));
+		}
+#elif SOUNDVIS_SIMD_NEON
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const int16x8x3_t Frames = vld3q_s16(In + Frame * 6);
+			for (int32 ChannelIndex = 0; ChannelIndex < 3; ++ChannelIndex)
+			{
+				// vld3 pairs channel c with channel c + 3 in alternating lanes
+				const int16x8x2_t Split = vuzpq_s16(Frames.val[ChannelIndex], Frames.val[ChannelIndex]);
+				vst1q_f32(Out + ChannelIndex * OutPlaneStride + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[0]))));
+				vst1q_f32(Out + (ChannelIndex + 3) * OutPlaneStride + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[1]))));
+			}
+			const int16x8x3_t Next = vld3q_s16(In + Frame * 6 + 24);
+			for (int32 ChannelIndex = 0; ChannelIndex < 3; ++ChannelIndex)
+			{
+				const int16x8x2_t Split = vuzpq_s16(Next.val[ChannelIndex], Next.val[ChannelIndex]);
+				vst1q_f32(Out + ChannelIndex * OutPlaneStride + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[0]))));
+				vst1q_f32(Out + (ChannelIndex + 3) * OutPlaneStride + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[1]))));
+			}
+		}
+#endif
+		return Frame;
+	}
+
+	uint32 DeinterleaveOctal(const int16* In, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+	{
+		uint32 Frame = 0;
+#if SOUNDVIS_SIMD_SSE2
+		// One register holds one frame, so transposing an 8x8 block of int16 yields 8 frames per channel
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			const __m128i* Src = (const __m128i*)(In + Frame * 8);
+			const __m128i R0 = _mm_loadu_si128(Src + 0), R1 = _mm_loadu_si128(Src + 1);
+			const __m128i R2 = _mm_loadu_si128(Src + 2), R3 = _mm_loadu_si128(Src + 3);
+			const __m128i R4 = _mm_loadu_si128(Src + 4), R5 = _mm_loadu_si128(Src + 5);
+			const __m128i R6 = _mm_loadu_si128(Src + 6), R7 = _mm_loadu_si128(Src + 7);
+
+			const __m128i A0 = _mm_unpacklo_epi16(R0, R1), A1 = _mm_unpackhi_epi16(R0, R1);
+			const __m128i A2 = _mm_unpacklo_epi16(R2, R3), A3 = _mm_unpackhi_epi16(R2, R3);
+			const __m128i A4 = _mm_unpacklo_epi16(R4, R5), A5 = _mm_unpackhi_epi16(R4, R5);
+			const __m128i A6 = _mm_unpacklo_epi16(R6, R7), A7 = _mm_unpackhi_epi16(R6, R7);
+
+			const __m128i B0 = _mm_unpacklo_epi32(A0, A2), B1 = _mm_unpackhi_epi32(A0, A2);
+			const __m128i B2 = _mm_unpacklo_epi32(A1, A3), B3 = _mm_unpackhi_epi32(A1, A3);
+			const __m128i B4 = _mm_unpacklo_epi32(A4, A6), B5 = _mm_unpackhi_epi32(A4, A6);
+			const __m128i B6 = _mm_unpacklo_epi32(A5, A7), B7 = _mm_unpackhi_epi32(A5, A7);
+
+			const __m128i Channels[8] =
+			{
+				_mm_unpacklo_epi64(B0, B4), _mm_unpackhi_epi64(B0, B4),
+				_mm_unpacklo_epi64(B1, B5), _mm_unpackhi_epi64(B1, B5),
+				_mm_unpacklo_epi64(B2, B6), _mm_unpackhi_epi64(B2, B6),
+				_mm_unpacklo_epi64(B3, B7), _mm_unpackhi_epi64(B3, B7),
+			};
+			for (int32 ChannelIndex = 0; ChannelIndex < 8; ++ChannelIndex)
+			{
+				const __m128i Samples = Channels[ChannelIndex];
+				float* Dst = Out + ChannelIndex * OutPlaneStride + Frame;
+				_mm_storeu_ps(Dst, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(Samples, Samples), 16)));
+				_mm_storeu_ps(Dst + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(Samples, Samples), 16)));
+			}
+		}
+#elif SOUNDVIS_SIMD_NEON
+		for (; Frame + 8 <= NumFrames; Frame += 8)
+		{
+			// vld4 pairs channel c with channel c + 4 in alternating lanes
+			const int16x8x4_t Frames = vld4q_s16(In + Frame * 8);
+			for (int32 ChannelIndex = 0; ChannelIndex < 4; ++ChannelIndex)
+			{
+				const int16x8x2_t Split = vuzpq_s16(Frames.val[ChannelIndex], Frames.val[ChannelIndex]);
+				vst1q_f32(Out + ChannelIndex * OutPlaneStride + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[0]))));
+				vst1q_f32(Out + (ChannelIndex + 4) * OutPlaneStride + Frame, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[1]))));
+			}
+			const int16x8x4_t Next = vld4q_s16(In + Frame * 8 + 32);
+			for (int32 ChannelIndex = 0; ChannelIndex < 4; ++ChannelIndex)
+			{
+				const int16x8x2_t Split = vuzpq_s16(Next.val[ChannelIndex], Next.val[ChannelIndex]);
+				vst1q_f32(Out + ChannelIndex * OutPlaneStride + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[0]))));
+				vst1q_f32(Out + (ChannelIndex + 4) * OutPlaneStride + Frame + 4, vcvtq_f32_s32(vmovl_s16(vget_low_s16(Split.val[1]))));
+			}
+		}
+#endif
+		return Frame;
+	}
+}
+
+void AudioConversion::DeinterleaveToFloat(const int16* In, uint32 NumChannels, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+{
+	uint32 Done = 0;
+	switch (NumChannels)
+	{
+	case 1: Done = DeinterleaveMono(In, NumFrames, Out); break;
+	case 2: Done = DeinterleaveStereo(In, NumFrames, Out, Out + OutPlaneStride); break;
+	case 4: Done = DeinterleaveQuad(In, NumFrames, Out, OutPlaneStride); break;
+	case 6: Done = DeinterleaveHexa(In, NumFrames, Out, OutPlaneStride); break;
+	case 8: Done = DeinterleaveOctal(In, NumFrames, Out, OutPlaneStride); break;
+	default: break;
+	}
+	if (Done < NumFrames)
+	{
+		DeinterleaveGeneric(In + Done * NumChannels, NumChannels, NumFrames - Done, Out + Done, OutPlaneStride);
+	}
+}
+
+void AudioConversion::Unsigned8ToFloat(const uint8* In, uint32 NumFrames, float* Out, uint32 NumPlanes, uint32 OutPlaneStride)
+{
+	uint32 Frame = 0;
+#if SOUNDVIS_SIMD_SSE2
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Bias = _mm_set1_epi8((char)0x80);
+	for (; Frame + 16 <= NumFrames; Frame += 16)
+	{
+		// Flipping the top bit recenters on 0; placing the byte at the top of each 32 bit lane and
+		// shifting right arithmetically by 16 gives (Sample - 128) << 8, sign extended
+		const __m128i Bytes = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(In + Frame)), Bias);
+		const __m128i Lo = _mm_unpacklo_epi8(Zero, Bytes);
+		const __m128i Hi = _mm_unpackhi_epi8(Zero, Bytes);
+		const __m128 Samples[4] =
+		{
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(Zero, Lo), 16)),
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(Zero, Lo), 16)),
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(Zero, Hi), 16)),
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(Zero, Hi), 16)),
+		};
+		for (uint32 PlaneIndex = 0; PlaneIndex < NumPlanes; ++PlaneIndex)
+		{
+			float* Dst = Out + PlaneIndex * OutPlaneStride + Frame;
+			_mm_storeu_ps(Dst, Samples[0]);
+			_mm_storeu_ps(Dst + 4, Samples[1]);
+			_mm_storeu_ps(Dst + 8, Samples[2]);
+			_mm_storeu_ps(Dst + 12, Samples[3]);
+		}
+	}
+#elif SOUNDVIS_SIMD_NEON
+	for (; Frame + 16 <= NumFrames; Frame += 16)
+	{
+		const int8x16_t Bytes = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(In + Frame), vdupq_n_u8(0x80)));
+		const int16x8_t Lo = vshlq_n_s16(vmovl_s8(vget_low_s8(Bytes)), 8);
+		const int16x8_t Hi = vshlq_n_s16(vmovl_s8(vget_high_s8(Bytes)), 8);
+		const float32x4_t Samples[4] =
+		{
+			vcvtq_f32_s32(vmovl_s16(vget_low_s16(Lo))),
+			vcvtq_f32_s32(vmovl_s16(vget_high_s16(Lo))),
+			vcvtq_f32_s32(vmovl_s16(vget_low_s16(Hi))),
+			vcvtq_f32_s32(vmovl_s16(vget_high_s16(Hi))),
+		};
+		for (uint32 PlaneIndex = 0; PlaneIndex < NumPlanes; ++PlaneIndex)
+		{
+			float* Dst = Out + PlaneIndex * OutPlaneStride + Frame;
+			vst1q_f32(Dst, Samples[0]);
+			vst1q_f32(Dst + 4, Samples[1]);
+			vst1q_f32(Dst + 8, Samples[2]);
+			vst1q_f32(Dst + 12, Samples[3]);
+		}
+	}
+#endif
+	for (; Frame < NumFrames; ++Frame)
+	{
+		const float Sample = (float)(((int32)In[Frame] - 128) << 8);
+		for (uint32 PlaneIndex = 0; PlaneIndex < NumPlanes; ++PlaneIndex)
+		{
+			Out[PlaneIndex * OutPlaneStride + Frame] = Sample;
+		}
+	}
+}
+
+void AudioConversion::ApplyWindow(const float* In, const float* Window, float* Out, uint32 Num)
+{
+	uint32 Index = 0;
+#if SOUNDVIS_SIMD_AVX2
+	for (; Index + 8 <= Num; Index += 8)
+	{
+		_mm256_storeu_ps(Out + Index, _mm256_mul_ps(_mm256_loadu_ps(In + Index), _mm256_loadu_ps(Window + Index)));
+	}
+#endif
+#if SOUNDVIS_SIMD_SSE2
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		_mm_storeu_ps(Out + Index, _mm_mul_ps(_mm_loadu_ps(In + Index), _mm_loadu_ps(Window + Index)));
+	}
+#elif SOUNDVIS_SIMD_NEON
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		vst1q_f32(Out + Index, vmulq_f32(vld1q_f32(In + Index), vld1q_f32(Window + Index)));
+	}
+#endif
+	for (; Index < Num; ++Index)
+	{
+		Out[Index] = In[Index] * Window[Index];
+	}
+}
+
+void AudioConversion::ApplyWindowQ15(const float* In, const int16* Window, int16* Out, uint32 Num)
+{
+	uint32 Index = 0;
+#if SOUNDVIS_SIMD_NEON
+	for (; Index + 8 <= Num; Index += 8)
+	{
+		// Saturating narrow, then a doubling high multiply rounds (Sample * Window) >> 15
+		const int16x8_t Samples = vcombine_s16(
+			vqmovn_s32(vcvtq_s32_f32(vld1q_f32(In + Index))),
+			vqmovn_s32(vcvtq_s32_f32(vld1q_f32(In + Index + 4))));
+		vst1q_s16(Out + Index, vqrdmulhq_s16(Samples, vld1q_s16(Window + Index)));
+	}
+#endif
+	for (; Index < Num; ++Index)
+	{
+		const int32 Sample = (int32)FMath::Clamp(In[Index], -32768.f, 32767.f);
+		Out[Index] = (int16)FMath::Clamp((Sample * Window[Index] + (1 << 14)) >> 15, -32768, 32767);
+	}
+}
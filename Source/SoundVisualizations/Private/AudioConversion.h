@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * Sample format conversion kernels used when audio is ingested.
+ *
+ * Output planes hold one channel each, starting at Out + Channel * OutPlaneStride. Samples keep the
+ * int16 scale (no normalization) so spectra and amplitudes come out in the same units as before.
+ */
+namespace AudioConversion
+{
+	/** Deinterleaves NumFrames frames of NumChannels int16 samples into float planes. */
+	void DeinterleaveToFloat(const int16* In, uint32 NumChannels, uint32 NumFrames, float* Out, uint32 OutPlaneStride);
+
+	/** Widens NumFrames unsigned 8 bit mono samples, centered on 128, to the int16 scale and writes them to each of NumPlanes planes. */
+	void Unsigned8ToFloat(const uint8* In, uint32 NumFrames, float* Out, uint32 NumPlanes, uint32 OutPlaneStride);
+
+	/** Out[i] = In[i] * Window[i]; used to taper a window of history into FFT input in a single pass. */
+	void ApplyWindow(const float* In, const float* Window, float* Out, uint32 Num);
+
+	/** ApplyWindow for the fixed point FFT: In saturated to int16, times the Q15 Window, rounded. */
+	void ApplyWindowQ15(const float* In, const int16* Window, int16* Out, uint32 Num);
+}
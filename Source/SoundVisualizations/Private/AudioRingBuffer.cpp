@@ -0,0 +1,131 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "AudioRingBuffer.h"
+#include "AudioConversion.h"
+
+#define AUDIO_RING_ALIGNMENT 64
+
+FAudioRingBuffer::FAudioRingBuffer(uint32 InNumChannels, uint32 InSampleRate, uint32 MinCapacityFrames)
+	: NumChannels(FMath::Max<uint32>(InNumChannels, 1))
+	, SampleRate(InSampleRate)
+	, CapacityFrames(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(MinCapacityFrames, 16)))
+	, WriteCursor(0)
+	, ReserveCursor(0)
+	, EndTimeTicks(0)
+	, ReadCursor(0)
+{
+	FrameMask = CapacityFrames - 1;
+	const SIZE_T NumBytes = sizeof(float) * CapacityFrames * NumChannels;
+	Planes = (float*)FMemory::Malloc(NumBytes, AUDIO_RING_ALIGNMENT);
+	FMemory::Memzero(Planes, NumBytes);
+}
+
+FAudioRingBuffer::~FAudioRingBuffer()
+{
+	FMemory::Free(Planes);
+}
+
+template<typename ConvertType>
+void FAudioRingBuffer::WriteFrames(uint32 NumFrames, FTimespan EndTime, ConvertType Convert)
+{
+	// Only the last CapacityFrames frames can be kept anyway
+	int64 Skipped = 0;
+	if (NumFrames > CapacityFrames)
+	{
+		Skipped = NumFrames - CapacityFrames;
+		NumFrames = CapacityFrames;
+	}
+
+	const int64 Start = WriteCursor + Skipped;
+	const int64 End = Start + NumFrames;
+
+	// Announce the frames we are about to overwrite before touching them
+	FPlatformAtomics::InterlockedExchange(&ReserveCursor, End);
+
+	// Convert in at most two contiguous blocks, split where the ring wraps
+	const uint32 StartIndex = (uint32)Start & FrameMask;
+	const uint32 FirstPart = FMath::Min(NumFrames, CapacityFrames - StartIndex);
+	Convert((uint32)Skipped, FirstPart, Planes + StartIndex);
+	if (FirstPart < NumFrames)
+	{
+		Convert((uint32)Skipped + FirstPart, NumFrames - FirstPart, Planes);
+	}
+
+	FPlatformAtomics::InterlockedExchange(&EndTimeTicks, EndTime.GetTicks());
+	FPlatformAtomics::InterlockedExchange(&WriteCursor, End);
+}
+
+void FAudioRingBuffer::Write(const int16* Samples, uint32 NumFrames, FTimespan EndTime)
+{
+	const uint32 Channels = NumChannels;
+	const uint32 Stride = CapacityFrames;
+	WriteFrames(NumFrames, EndTime, [Samples, Channels, Stride](uint32 FirstFrame, uint32 Count, float* Out)
+	{
+		AudioConversion::DeinterleaveToFloat(Samples + FirstFrame * Channels, Channels, Count, Out, Stride);
+	});
+}
+
+void FAudioRingBuffer::WriteUnsigned8(const uint8* Samples, uint32 NumFrames, FTimespan EndTime)
+{
+	const uint32 Channels = NumChannels;
+	const uint32 Stride = CapacityFrames;
+	WriteFrames(NumFrames, EndTime, [Samples, Channels, Stride](uint32 FirstFrame, uint32 Count, float* Out)
+	{
+		AudioConversion::Unsigned8ToFloat(Samples + FirstFrame, Count, Out, Channels, Stride);
+	});
+}
+
+uint64 FAudioRingBuffer::GetWritePosition(FTimespan& OutEndTime) const
+{
+	for (;;)
+	{
+		const int64 Committed = AtomicRead(&WriteCursor);
+		const int64 Ticks = AtomicRead(&EndTimeTicks);
+		// The producer reserves before publishing the time, so a matching reservation means
+		// the time we read belongs to the committed position.
+		if (AtomicRead(&ReserveCursor) == Committed)
+		{
+			OutEndTime = FTimespan(Ticks);
+			return Committed;
+		}
+		FPlatformProcess::Sleep(0.0f);
+	}
+}
+
+bool FAudioRingBuffer::ReadFrames(uint64 EndFrame, uint32 NumFrames, float* Out, uint32 OutPlaneStride) const
+{
+	if (NumFrames == 0 || NumFrames > CapacityFrames || EndFrame < NumFrames)
+	{
+		return false;
+	}
+	const uint64 FirstFrame = EndFrame - NumFrames;
+	if (EndFrame > (uint64)AtomicRead(&WriteCursor) || (uint64)AtomicRead(&ReserveCursor) > FirstFrame + CapacityFrames)
+	{
+		return false;
+	}
+
+	const uint32 StartIndex = (uint32)FirstFrame & FrameMask;
+	const uint32 FirstPart = FMath::Min(NumFrames, CapacityFrames - StartIndex);
+	for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+	{
+		const float* Plane = Planes + ChannelIndex * CapacityFrames;
+		float* Dst = Out + ChannelIndex * OutPlaneStride;
+		FMemory::Memcpy(Dst, Plane + StartIndex, FirstPart * sizeof(float));
+		if (FirstPart < NumFrames)
+		{
+			FMemory::Memcpy(Dst + FirstPart, Plane, (NumFrames - FirstPart) * sizeof(float));
+		}
+	}
+
+	// If the producer started writing into our window while we copied it, the copy is torn
+	return (uint64)AtomicRead(&ReserveCursor) <= FirstFrame + CapacityFrames;
+}
+
+uint64 FAudioRingBuffer::GetReadCursor() const
+{
+	return AtomicRead(&ReadCursor);
+}
+
+void FAudioRingBuffer::SetReadCursor(uint64 Frame)
+{
+	FPlatformAtomics::InterlockedExchange(&ReadCursor, (int64)Frame);
+}
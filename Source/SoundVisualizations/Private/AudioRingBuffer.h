@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * History of the most recent PCM frames delivered to an audio sink, stored as one float plane per channel.
+ *
+ * There is exactly one producer (the media decoder thread calling PlayAudioSink) and one consumer
+ * (whoever analyzes the audio). Write() is wait-free: the producer never waits for the consumer, it
+ * simply overwrites the oldest frames. The consumer copies a window out with ReadFrames(), which
+ * reports failure if the producer lapped any part of the window while it was being copied.
+ *
+ * Positions are absolute frame counts since the ring was created, so they never wrap. Each plane
+ * is cache line aligned and samples keep their int16 scale.
+ */
+class FAudioRingBuffer
+{
+public:
+	FAudioRingBuffer(uint32 InNumChannels, uint32 InSampleRate, uint32 MinCapacityFrames);
+	~FAudioRingBuffer();
+
+	uint32 GetNumChannels() const { return NumChannels; }
+	uint32 GetSampleRate() const { return SampleRate; }
+	uint32 GetCapacity() const { return CapacityFrames; }
+
+	/** Deinterleaves and appends NumFrames frames. EndTime is the media time just past the last frame. Producer only. */
+	void Write(const int16* Samples, uint32 NumFrames, FTimespan EndTime);
+
+	/** Appends NumFrames unsigned 8 bit mono samples, centered on 128, to every channel. Producer only. */
+	void WriteUnsigned8(const uint8* Samples, uint32 NumFrames, FTimespan EndTime);
+
+	/** Returns the number of frames committed so far, and the media time just past the last of them. */
+	uint64 GetWritePosition(FTimespan& OutEndTime) const;
+
+	/**
+	 * Copies the NumFrames frames that precede EndFrame, channel c going to Out + c * OutPlaneStride.
+	 * Returns false if any of them is unavailable or was overwritten.
+	 */
+	bool ReadFrames(uint64 EndFrame, uint32 NumFrames, float* Out, uint32 OutPlaneStride) const;
+
+	/** Position up to which the consumer has read. Only the consumer advances it. */
+	uint64 GetReadCursor() const;
+	void SetReadCursor(uint64 Frame);
+
+private:
+	FAudioRingBuffer(const FAudioRingBuffer&);
+	FAudioRingBuffer& operator=(const FAudioRingBuffer&);
+
+	/** The body of the Write functions; Convert(FirstFrame, Count, Out) converts Count input frames into the planes at Out. */
+	template<typename ConvertType>
+	void WriteFrames(uint32 NumFrames, FTimespan EndTime, ConvertType Convert);
+
+	static int64 AtomicRead(volatile const int64* Src)
+	{
+		return FPlatformAtomics::InterlockedCompareExchange(const_cast<volatile int64*>(Src), 0, 0);
+	}
+
+	uint32 NumChannels;
+	uint32 SampleRate;
+	uint32 CapacityFrames;
+	uint32 FrameMask;
+	/** NumChannels planes of CapacityFrames samples each */
+	float* Planes;
+
+	/** Frames visible to the consumer. */
+	volatile int64 WriteCursor;
+	/** Frames the producer has started writing; runs ahead of WriteCursor while a Write() is in flight. */
+	volatile int64 ReserveCursor;
+	/** Media time at WriteCursor, in ticks. */
+	volatile int64 EndTimeTicks;
+	volatile int64 ReadCursor;
+};
@@ -0,0 +1,496 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "BakedSpectrogram.h"
+
+#define SOUNDVIS_POSIX_MAPPING (PLATFORM_ANDROID || PLATFORM_LINUX || PLATFORM_MAC || PLATFORM_IOS)
+
+#if PLATFORM_WINDOWS
+#include "AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "HideWindowsPlatformTypes.h"
+#elif SOUNDVIS_POSIX_MAPPING
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogBakedSpectrogram, Log, All);
+
+namespace
+{
+	/** "SVSG" */
+	const uint32 BakedSpectrogramMagic = 0x47535653;
+	const uint32 BakedSpectrogramVersion = 1;
+	/** Values quantized at a time while saving */
+	const int32 SaveBlockValues = 16384;
+	/** Values further than this below the loudest are stored as that; 16 bit audio has no detail down there anyway */
+	const float MaxRangeDecibels = 120.f;
+
+	uint64 AlignSection(uint64 Offset)
+	{
+		return (Offset + 15) & ~(uint64)15;
+	}
+
+	uint32 Quantize(float Value, float Min, float Step, uint32 MaxValue)
+	{
+		return Step > 0.f ? (uint32)FMath::Clamp(FMath::RoundToInt((Value - Min) / Step), 0, (int32)MaxValue) : 0;
+	}
+
+	/** Min and Max of levels that reached Min .. Max, clipped to MaxRangeDecibels below Max */
+	void ClipRange(float& InOutMin, float& InOutMax)
+	{
+		InOutMin = FMath::Max(InOutMin, InOutMax - MaxRangeDecibels);
+		if (InOutMin > InOutMax)
+		{
+			// Nothing reached any level
+			InOutMin = InOutMax = 0.f;
+		}
+	}
+}
+
+FSpectrogramLevels FSpectrogramLevels::Measure(const FSpectrogramFrames& Frames)
+{
+	FSpectrogramLevels Levels;
+	Levels.SpectrumMin = MAX_flt;
+	Levels.SpectrumMax = -MAX_flt;
+	for (int32 Index = 0; Index < Frames.Spectra.Num(); ++Index)
+	{
+		Levels.SpectrumMin = FMath::Min(Levels.SpectrumMin, Frames.Spectra[Index]);
+		Levels.SpectrumMax = FMath::Max(Levels.SpectrumMax, Frames.Spectra[Index]);
+	}
+	Levels.AmplitudeMin = MAX_flt;
+	Levels.AmplitudeMax = -MAX_flt;
+	for (int32 Index = 0; Index < Frames.Amplitudes.Num(); ++Index)
+	{
+		if (Frames.Amplitudes[Index] > 0.f)
+		{
+			const float Decibels = 20.f * FMath::LogX(10.f, Frames.Amplitudes[Index]);
+			Levels.AmplitudeMin = FMath::Min(Levels.AmplitudeMin, Decibels);
+			Levels.AmplitudeMax = FMath::Max(Levels.AmplitudeMax, Decibels);
+		}
+	}
+	ClipRange(Levels.SpectrumMin, Levels.SpectrumMax);
+	ClipRange(Levels.AmplitudeMin, Levels.AmplitudeMax);
+	return Levels;
+}
+
+FSpectrogramLevels FSpectrogramLevels::ForPeakSample(int32 PeakSample)
+{
+	// Windows never exceed 1, so no bin of an N point window exceeds N * Peak and, with the 2 / N
+	// scaling, no band exceeds 2 * Peak. An amplitude is a mean of absolute samples.
+	const float Peak = (float)FMath::Max(PeakSample, 1);
+	FSpectrogramLevels Levels;
+	Levels.SpectrumMax = 20.f * FMath::LogX(10.f, 2.f * Peak);
+	Levels.SpectrumMin = Levels.SpectrumMax - MaxRangeDecibels;
+	Levels.AmplitudeMax = 20.f * FMath::LogX(10.f, Peak);
+	Levels.AmplitudeMin = Levels.AmplitudeMax - MaxRangeDecibels;
+	return Levels;
+}
+
+FBakedSpectrogramWriter::FBakedSpectrogramWriter()
+	: Writer(nullptr)
+	, NumFramesWritten(0)
+	, bFailed(false)
+{
+	FMemory::Memzero(Header);
+}
+
+FBakedSpectrogramWriter::~FBakedSpectrogramWriter()
+{
+	if (Writer != nullptr)
+	{
+		// Never closed, so never finished
+		bFailed = true;
+		Close();
+	}
+}
+
+bool FBakedSpectrogramWriter::Open(const FSpectrumAnalysisSettings& Settings, const FSpectrogramFrames& Layout, int32 NumFrames, uint32 BytesPerValue, const FSpectrogramLevels& Levels, const FString& InPath)
+{
+	check(Writer == nullptr);
+	if (Layout.NumChannels == 0 || NumFrames <= 0 || (BytesPerValue != 1 && BytesPerValue != 2))
+	{
+		return false;
+	}
+	const uint32 MaxValue = BytesPerValue == 1 ? MAX_uint8 : MAX_uint16;
+
+	FMemory::Memzero(Header);
+	Header.Magic = BakedSpectrogramMagic;
+	Header.Version = BakedSpectrogramVersion;
+	Header.NumChannels = Layout.NumChannels;
+	Header.SampleRate = Layout.SampleRate;
+	Header.NumFrames = (uint32)NumFrames;
+	Header.SpectrumWidth = Layout.SpectrumWidth;
+	Header.AmplitudeBuckets = Layout.AmplitudeBuckets;
+	Header.BytesPerValue = BytesPerValue;
+	Header.WindowDurationInSeconds = Settings.WindowDurationInSeconds;
+	Header.WindowType = (uint32)Settings.WindowType;
+	Header.BandScale = (uint32)Settings.BandScale;
+	Header.MinFrequency = Settings.MinFrequency;
+	Header.OctaveFraction = Settings.OctaveFraction;
+	Header.HopFraction = Settings.HopFraction;
+	Header.SpectrumMin = Levels.SpectrumMin;
+	Header.SpectrumStep = Levels.SpectrumMin < Levels.SpectrumMax ? (Levels.SpectrumMax - Levels.SpectrumMin) / MaxValue : 0.f;
+	Header.AmplitudeMin = Levels.AmplitudeMin;
+	Header.AmplitudeStep = Levels.AmplitudeMin < Levels.AmplitudeMax ? (Levels.AmplitudeMax - Levels.AmplitudeMin) / (MaxValue - 1) : 0.f;
+	Header.TimesOffset = AlignSection(sizeof(Header));
+	Header.SpectraOffset = AlignSection(Header.TimesOffset + (uint64)NumFrames * sizeof(int64));
+	Header.AmplitudesOffset = AlignSection(Header.SpectraOffset + (uint64)NumFrames * Layout.GetSpectrumStride() * BytesPerValue);
+	Header.FileSize = Header.AmplitudesOffset + (uint64)NumFrames * Layout.GetAmplitudeStride() * BytesPerValue;
+
+	Path = InPath;
+	Writer = IFileManager::Get().CreateFileWriter(*Path);
+	if (Writer == nullptr)
+	{
+		UE_LOG(LogBakedSpectrogram, Error, TEXT("Cannot write %s"), *Path);
+		return false;
+	}
+	// Zeros in place of the header and every gap between sections, which runs never write
+	uint8 Zeros[sizeof(FBakedSpectrogramHeader) + 16] = { 0 };
+	const uint64 Gaps[][2] = {
+		{ 0, Header.TimesOffset },
+		{ Header.TimesOffset + (uint64)NumFrames * sizeof(int64), Header.SpectraOffset },
+		{ Header.SpectraOffset + (uint64)NumFrames * Layout.GetSpectrumStride() * BytesPerValue, Header.AmplitudesOffset },
+	};
+	for (const uint64* Gap : Gaps)
+	{
+		Writer->Seek(Gap[0]);
+		Writer->Serialize(Zeros, Gap[1] - Gap[0]);
+	}
+	NumFramesWritten = 0;
+	bFailed = Writer->IsError();
+	return !bFailed;
+}
+
+template <typename EncoderType>
+void FBakedSpectrogramWriter::WriteValues(uint64 Offset, const float* Values, int32 Num, EncoderType Encode)
+{
+	const uint32 BytesPerValue = Header.BytesPerValue;
+	TArray<uint8> Block;
+	for (int32 Start = 0; Start < Num; Start += SaveBlockValues)
+	{
+		const int32 BlockValues = FMath::Min(SaveBlockValues, Num - Start);
+		Block.SetNumUninitialized(BlockValues * BytesPerValue);
+		for (int32 Index = 0; Index < BlockValues; ++Index)
+		{
+			const uint32 Value = Encode(Values[Start + Index]);
+			if (BytesPerValue == 1)
+			{
+				Block[Index] = (uint8)Value;
+			}
+			else
+			{
+				((uint16*)Block.GetData())[Index] = (uint16)Value;
+			}
+		}
+		FScopeLock ScopeLock(&Lock);
+		Writer->Seek(Offset + (uint64)Start * BytesPerValue);
+		Writer->Serialize(Block.GetData(), Block.Num());
+	}
+}
+
+bool FBakedSpectrogramWriter::Write(int32 FirstFrame, const FSpectrogramFrames& Frames)
+{
+	const int32 NumFrames = Frames.GetNumFrames();
+	const int32 SpectrumStride = Frames.GetSpectrumStride();
+	const int32 AmplitudeStride = Frames.GetAmplitudeStride();
+	if (Writer == nullptr || FirstFrame < 0 || (int64)FirstFrame + NumFrames > Header.NumFrames || Frames.NumChannels != Header.NumChannels
+		|| Frames.SpectrumWidth != Header.SpectrumWidth || Frames.AmplitudeBuckets != Header.AmplitudeBuckets)
+	{
+		FScopeLock ScopeLock(&Lock);
+		bFailed = true;
+		return false;
+	}
+
+	const uint32 BytesPerValue = Header.BytesPerValue;
+	const uint32 MaxValue = BytesPerValue == 1 ? MAX_uint8 : MAX_uint16;
+	const float SpectrumMin = Header.SpectrumMin;
+	const float SpectrumStep = Header.SpectrumStep;
+	WriteValues(Header.SpectraOffset + (uint64)FirstFrame * SpectrumStride * BytesPerValue, Frames.Spectra.GetData(), NumFrames * SpectrumStride, [=](float Value)
+	{
+		return Quantize(Value, SpectrumMin, SpectrumStep, MaxValue);
+	});
+	const float AmplitudeMin = Header.AmplitudeMin;
+	const float AmplitudeStep = Header.AmplitudeStep;
+	WriteValues(Header.AmplitudesOffset + (uint64)FirstFrame * AmplitudeStride * BytesPerValue, Frames.Amplitudes.GetData(), NumFrames * AmplitudeStride, [=](float Value)
+	{
+		return Value > 0.f ? 1 + Quantize(20.f * FMath::LogX(10.f, Value), AmplitudeMin, AmplitudeStep, MaxValue - 1) : 0;
+	});
+
+	FScopeLock ScopeLock(&Lock);
+	Writer->Seek(Header.TimesOffset + (uint64)FirstFrame * sizeof(int64));
+	Writer->Serialize(const_cast<int64*>(Frames.Times.GetData()), NumFrames * sizeof(int64));
+	NumFramesWritten += NumFrames;
+	bFailed |= Writer->IsError();
+	return !bFailed;
+}
+
+bool FBakedSpectrogramWriter::Close()
+{
+	if (Writer == nullptr)
+	{
+		return false;
+	}
+	bool bWritten = !bFailed && NumFramesWritten == (int64)Header.NumFrames;
+	if (bWritten)
+	{
+		Writer->Seek(0);
+		Writer->Serialize(&Header, sizeof(Header));
+		bWritten = !Writer->IsError();
+	}
+	bWritten &= Writer->Close();
+	delete Writer;
+	Writer = nullptr;
+	if (!bWritten)
+	{
+		UE_LOG(LogBakedSpectrogram, Error, TEXT("Failed writing %s"), *Path);
+		IFileManager::Get().Delete(*Path);
+	}
+	return bWritten;
+}
+
+FString FBakedSpectrogram::GetPathForMedia(const FString& MediaUrl)
+{
+	FString Path = MediaUrl;
+	Path.RemoveFromStart(TEXT("file://"));
+	return Path + TEXT(".spectrogram");
+}
+
+bool FBakedSpectrogram::Save(const FSpectrumAnalysisSettings& Settings, const FSpectrogramFrames& Frames, uint32 BytesPerValue, const FString& Path)
+{
+	FBakedSpectrogramWriter Writer;
+	return Writer.Open(Settings, Frames, Frames.GetNumFrames(), BytesPerValue, FSpectrogramLevels::Measure(Frames), Path)
+		&& Writer.Write(0, Frames) && Writer.Close();
+}
+
+FBakedSpectrogram::FBakedSpectrogram()
+	: Data(nullptr)
+	, Size(0)
+	, MappedAddress(nullptr)
+	, MappingHandle(nullptr)
+	, Header(nullptr)
+	, Times(nullptr)
+	, Spectra(nullptr)
+	, Amplitudes(nullptr)
+{
+}
+
+FBakedSpectrogram::~FBakedSpectrogram()
+{
+	Unmap();
+}
+
+FBakedSpectrogramPtr FBakedSpectrogram::Open(const FString& Path)
+{
+	if (IFileManager::Get().FileSize(*Path) <= 0)
+	{
+		return nullptr;
+	}
+	FBakedSpectrogramPtr Baked = MakeShareable(new FBakedSpectrogram());
+	if (!Baked->Map(Path))
+	{
+		// Not a plain file, as inside a pak, or the platform cannot map files
+		if (!FFileHelper::LoadFileToArray(Baked->Loaded, *Path, FILEREAD_Silent))
+		{
+			return nullptr;
+		}
+		Baked->Data = Baked->Loaded.GetData();
+		Baked->Size = Baked->Loaded.Num();
+	}
+	if (!Baked->Initialize(Baked->Data, Baked->Size))
+	{
+		UE_LOG(LogBakedSpectrogram, Warning, TEXT("%s is not a baked spectrogram this version can read"), *Path);
+		return nullptr;
+	}
+	return Baked;
+}
+
+bool FBakedSpectrogram::Map(const FString& Path)
+{
+	const FString FullPath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*Path);
+#if PLATFORM_WINDOWS
+	HANDLE File = CreateFileW(*FullPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER FileSize;
+	HANDLE Mapping = nullptr;
+	if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0)
+	{
+		Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	// The mapping keeps the file open
+	CloseHandle(File);
+	if (Mapping == nullptr)
+	{
+		return false;
+	}
+	void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (View == nullptr)
+	{
+		CloseHandle(Mapping);
+		return false;
+	}
+	MappedAddress = View;
+	MappingHandle = Mapping;
+	Data = (const uint8*)View;
+	Size = FileSize.QuadPart;
+	return true;
+#elif SOUNDVIS_POSIX_MAPPING
+	const int File = open(TCHAR_TO_UTF8(*FullPath), O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+	struct stat FileStat;
+	void* View = MAP_FAILED;
+	if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+	{
+		View = mmap(nullptr, FileStat.st_size, PROT_READ, MAP_SHARED, File, 0);
+	}
+	// The mapping keeps the file open
+	close(File);
+	if (View == MAP_FAILED)
+	{
+		return false;
+	}
+	MappedAddress = View;
+	Data = (const uint8*)View;
+	Size = FileStat.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FBakedSpectrogram::Unmap()
+{
+	if (MappedAddress == nullptr)
+	{
+		return;
+	}
+#if PLATFORM_WINDOWS
+	UnmapViewOfFile(MappedAddress);
+	CloseHandle((HANDLE)MappingHandle);
+#elif SOUNDVIS_POSIX_MAPPING
+	munmap(MappedAddress, Size);
+#endif
+	MappedAddress = nullptr;
+	MappingHandle = nullptr;
+}
+
+bool FBakedSpectrogram::Initialize(const uint8* InData, uint64 InSize)
+{
+	if (InSize < sizeof(FBakedSpectrogramHeader))
+	{
+		return false;
+	}
+	const FBakedSpectrogramHeader* File = (const FBakedSpectrogramHeader*)InData;
+	if (File->Magic != BakedSpectrogramMagic || File->Version != BakedSpectrogramVersion || File->FileSize != InSize
+		|| File->NumChannels == 0 || File->SpectrumWidth < 0 || File->AmplitudeBuckets < 0
+		|| (File->BytesPerValue != 1 && File->BytesPerValue != 2))
+	{
+		return false;
+	}
+	const uint64 NumFrames = File->NumFrames;
+	const uint64 SpectraBytes = NumFrames * File->SpectrumWidth * (File->NumChannels + 1) * File->BytesPerValue;
+	const uint64 AmplitudeBytes = NumFrames * File->AmplitudeBuckets * (File->NumChannels + 1) * File->BytesPerValue;
+	if (File->TimesOffset % 16 != 0 || File->SpectraOffset % 16 != 0 || File->AmplitudesOffset % 16 != 0
+		|| File->TimesOffset < sizeof(FBakedSpectrogramHeader) || File->TimesOffset + NumFrames * sizeof(int64) > File->SpectraOffset
+		|| File->SpectraOffset + SpectraBytes > File->AmplitudesOffset || File->AmplitudesOffset + AmplitudeBytes > InSize)
+	{
+		return false;
+	}
+
+	Header = File;
+	Times = (const int64*)(InData + File->TimesOffset);
+	Spectra = InData + File->SpectraOffset;
+	Amplitudes = InData + File->AmplitudesOffset;
+
+	const uint32 MaxValue = File->BytesPerValue == 1 ? MAX_uint8 : MAX_uint16;
+	AmplitudeTable.SetNumUninitialized(MaxValue + 1);
+	AmplitudeTable[0] = 0.f;
+	for (uint32 Value = 1; Value <= MaxValue; ++Value)
+	{
+		AmplitudeTable[Value] = FMath::Pow(10.f, ((Value - 1) * File->AmplitudeStep + File->AmplitudeMin) / 20.f);
+	}
+	return true;
+}
+
+bool FBakedSpectrogram::Matches(const FSpectrumAnalysisSettings& Settings) const
+{
+	return Header->WindowDurationInSeconds == Settings.WindowDurationInSeconds && Header->SpectrumWidth == Settings.SpectrumWidth
+		&& Header->AmplitudeBuckets == Settings.AmplitudeBuckets && Header->WindowType == (uint32)Settings.WindowType
+		&& Header->BandScale == (uint32)Settings.BandScale && Header->MinFrequency == Settings.MinFrequency
+		&& Header->OctaveFraction == Settings.OctaveFraction;
+}
+
+int32 FBakedSpectrogram::FindFrame(FTimespan Time) const
+{
+	if (Header->NumFrames == 0)
+	{
+		return INDEX_NONE;
+	}
+	// The first frame after Time, found by bisection; frame times only ever increase
+	const int64 Ticks = Time.GetTicks();
+	int32 Low = 0;
+	int32 High = (int32)Header->NumFrames;
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (Times[Middle] <= Ticks)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+	return FMath::Max(Low - 1, 0);
+}
+
+void FBakedSpectrogram::GetFrame(int32 Frame, FSpectrumAnalysisResult& Out) const
+{
+	check(Frame >= 0 && Frame < GetNumFrames());
+	Out.NumChannels = Header->NumChannels;
+	Out.SpectrumWidth = Header->SpectrumWidth;
+	Out.AmplitudeBuckets = Header->AmplitudeBuckets;
+	Out.Time = FTimespan(Times[Frame]);
+
+	const int32 SpectrumStride = Header->SpectrumWidth * (Header->NumChannels + 1);
+	const int32 AmplitudeStride = Header->AmplitudeBuckets * (Header->NumChannels + 1);
+	Out.Spectrum.SetNumUninitialized(SpectrumStride);
+	Out.Amplitude.SetNumUninitialized(AmplitudeStride);
+	float* Spectrum = Out.Spectrum.GetData();
+	float* Amplitude = Out.Amplitude.GetData();
+	const float SpectrumMin = Header->SpectrumMin;
+	const float SpectrumStep = Header->SpectrumStep;
+	if (Header->BytesPerValue == 1)
+	{
+		const uint8* SpectrumValues = Spectra + (SIZE_T)Frame * SpectrumStride;
+		const uint8* AmplitudeValues = Amplitudes + (SIZE_T)Frame * AmplitudeStride;
+		for (int32 Index = 0; Index < SpectrumStride; ++Index)
+		{
+			Spectrum[Index] = SpectrumValues[Index] * SpectrumStep + SpectrumMin;
+		}
+		for (int32 Index = 0; Index < AmplitudeStride; ++Index)
+		{
+			Amplitude[Index] = AmplitudeTable[AmplitudeValues[Index]];
+		}
+	}
+	else
+	{
+		const uint16* SpectrumValues = (const uint16*)Spectra + (SIZE_T)Frame * SpectrumStride;
+		const uint16* AmplitudeValues = (const uint16*)Amplitudes + (SIZE_T)Frame * AmplitudeStride;
+		for (int32 Index = 0; Index < SpectrumStride; ++Index)
+		{
+			Spectrum[Index] = SpectrumValues[Index] * SpectrumStep + SpectrumMin;
+		}
+		for (int32 Index = 0; Index < AmplitudeStride; ++Index)
+		{
+			Amplitude[Index] = AmplitudeTable[AmplitudeValues[Index]];
+		}
+	}
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+
+/**
+ * Layout of a baked spectrogram file: this header, then the frame times as int64 ticks, then every
+ * frame's spectra, then every frame's amplitudes, each section starting on a 16 byte boundary. A
+ * frame's values are the NumChannels + 1 runs of an FSpectrumAnalysisResult, quantized to
+ * BytesPerValue unsigned integers. Everything is little endian and read in place.
+ */
+struct FBakedSpectrogramHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 NumChannels;
+	uint32 SampleRate;
+	uint32 NumFrames;
+	int32 SpectrumWidth;
+	int32 AmplitudeBuckets;
+	/** 1 or 2 */
+	uint32 BytesPerValue;
+
+	/** The settings the frames were analyzed with */
+	float WindowDurationInSeconds;
+	uint32 WindowType;
+	uint32 BandScale;
+	float MinFrequency;
+	int32 OctaveFraction;
+	float HopFraction;
+
+	/** A spectrum value V is V * SpectrumStep + SpectrumMin dB */
+	float SpectrumMin;
+	float SpectrumStep;
+	/** An amplitude value V > 0 is (V - 1) * AmplitudeStep + AmplitudeMin dB of the amplitude; 0 is silence */
+	float AmplitudeMin;
+	float AmplitudeStep;
+
+	/** Byte offsets of the sections from the start of the file */
+	uint64 TimesOffset;
+	uint64 SpectraOffset;
+	uint64 AmplitudesOffset;
+	uint64 FileSize;
+};
+
+/** Frames analyzed by the baker, before they are quantized */
+struct FSpectrogramFrames
+{
+	uint32 NumChannels;
+	uint32 SampleRate;
+	int32 SpectrumWidth;
+	int32 AmplitudeBuckets;
+	/** Media time each frame was heard at, in ticks */
+	TArray<int64> Times;
+	/** SpectrumWidth * (NumChannels + 1) values per frame */
+	TArray<float> Spectra;
+	/** AmplitudeBuckets * (NumChannels + 1) values per frame */
+	TArray<float> Amplitudes;
+
+	FSpectrogramFrames()
+		: NumChannels(0)
+		, SampleRate(0)
+		, SpectrumWidth(0)
+		, AmplitudeBuckets(0)
+	{
+	}
+
+	int32 GetNumFrames() const { return Times.Num(); }
+	int32 GetSpectrumStride() const { return SpectrumWidth * (NumChannels + 1); }
+	int32 GetAmplitudeStride() const { return AmplitudeBuckets * (NumChannels + 1); }
+};
+
+/** The levels a baked spectrogram's values span, in dB; values below the minimum are stored as it */
+struct FSpectrogramLevels
+{
+	float SpectrumMin;
+	float SpectrumMax;
+	/** In dB of the amplitude */
+	float AmplitudeMin;
+	float AmplitudeMax;
+
+	/** The levels Frames actually reach, down to at most 120 dB below the loudest */
+	static FSpectrogramLevels Measure(const FSpectrogramFrames& Frames);
+	/** The loudest levels audio whose samples never exceed PeakSample can produce, down to 120 dB below them */
+	static FSpectrogramLevels ForPeakSample(int32 PeakSample);
+};
+
+/**
+ * Writes a baked spectrogram a run of frames at a time, so a long sound never has to be held in
+ * memory analyzed. The quantization levels are fixed when the file is opened. The header goes in
+ * last, so until Close succeeds nothing will open the file.
+ */
+class FBakedSpectrogramWriter
+{
+public:
+	FBakedSpectrogramWriter();
+	~FBakedSpectrogramWriter();
+
+	/** Creates Path for NumFrames frames with the channels and widths of Layout, analyzed with Settings */
+	bool Open(const FSpectrumAnalysisSettings& Settings, const FSpectrogramFrames& Layout, int32 NumFrames, uint32 BytesPerValue, const FSpectrogramLevels& Levels, const FString& Path);
+
+	/** Quantizes Frames and writes them as frames FirstFrame onwards. Any thread, runs in any order. */
+	bool Write(int32 FirstFrame, const FSpectrogramFrames& Frames);
+
+	/** Finishes the file if every frame was written, else deletes it */
+	bool Close();
+
+private:
+	FBakedSpectrogramWriter(const FBakedSpectrogramWriter&);
+	FBakedSpectrogramWriter& operator=(const FBakedSpectrogramWriter&);
+
+	/** Quantizes Num values with Encode and writes them at Offset, a block at a time */
+	template <typename EncoderType>
+	void WriteValues(uint64 Offset, const float* Values, int32 Num, EncoderType Encode);
+
+	FBakedSpectrogramHeader Header;
+	FString Path;
+	FArchive* Writer;
+	/** Guards Writer, whose position every run moves, and NumFramesWritten */
+	FCriticalSection Lock;
+	int64 NumFramesWritten;
+	bool bFailed;
+};
+
+/**
+ * A whole media file analyzed ahead of time, mapped into memory.
+ *
+ * Looking a frame up by playback time and dequantizing it replaces the FFT entirely. The file is
+ * mapped where the platform allows it and read into memory otherwise, as for files inside a pak.
+ * Immutable once opened, so any thread can read it.
+ */
+class FBakedSpectrogram
+{
+public:
+	/** Where the baked spectrogram of the media at MediaUrl lives: next to it, with .spectrogram appended */
+	static FString GetPathForMedia(const FString& MediaUrl);
+
+	/** Quantizes Frames analyzed with Settings to BytesPerValue bytes a value, between the levels they reach, and writes them to Path. Fails if there are no frames. */
+	static bool Save(const FSpectrumAnalysisSettings& Settings, const FSpectrogramFrames& Frames, uint32 BytesPerValue, const FString& Path);
+
+	/** The spectrogram baked at Path, or null if there is none or it cannot be read. */
+	static TSharedPtr<FBakedSpectrogram, ESPMode::ThreadSafe> Open(const FString& Path);
+
+	~FBakedSpectrogram();
+
+	/** Whether the frames answer for Settings. The hop and backend only decide how often and how spectra are computed, so they are ignored. */
+	bool Matches(const FSpectrumAnalysisSettings& Settings) const;
+
+	int32 GetNumFrames() const { return (int32)Header->NumFrames; }
+	uint32 GetNumChannels() const { return Header->NumChannels; }
+
+	/** The last frame heard at or before Time, else the first one; INDEX_NONE if there are no frames. */
+	int32 FindFrame(FTimespan Time) const;
+
+	/** Dequantizes Frame into Out. */
+	void GetFrame(int32 Frame, FSpectrumAnalysisResult& Out) const;
+
+private:
+	FBakedSpectrogram();
+	FBakedSpectrogram(const FBakedSpectrogram&);
+	FBakedSpectrogram& operator=(const FBakedSpectrogram&);
+
+	/** Points the sections at Data, or returns false if it is not a valid file */
+	bool Initialize(const uint8* InData, uint64 InSize);
+	/** Maps Path, or returns false if the platform cannot */
+	bool Map(const FString& Path);
+	void Unmap();
+
+	const uint8* Data;
+	uint64 Size;
+	/** The file, where it could not be mapped */
+	TArray<uint8> Loaded;
+	/** Platform handles of the mapping */
+	void* MappedAddress;
+	void* MappingHandle;
+
+	const FBakedSpectrogramHeader* Header;
+	const int64* Times;
+	const uint8* Spectra;
+	const uint8* Amplitudes;
+	/** The amplitude of every value, so a lookup takes no pow */
+	TArray<float> AmplitudeTable;
+};
+
+typedef TSharedPtr<FBakedSpectrogram, ESPMode::ThreadSafe> FBakedSpectrogramPtr;
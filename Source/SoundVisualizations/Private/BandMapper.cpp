@@ -0,0 +1,223 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "BandMapper.h"
+
+namespace
+{
+	double HzToMel(double Hz) { return 2595.0 * log10(1.0 + Hz / 700.0); }
+	double MelToHz(double Mel) { return 700.0 * (pow(10.0, Mel / 2595.0) - 1.0); }
+
+	// Traunmueller's approximation of the Bark scale
+	double HzToBark(double Hz) { return 26.81 * Hz / (1960.0 + Hz) - 0.53; }
+	double BarkToHz(double Bark) { return 1960.0 * (Bark + 0.53) / (26.28 - Bark); }
+}
+
+FBandMap::FBandMap(const FBandMapSettings& InSettings)
+	: Settings(InSettings)
+{
+	const int32 NumBands = FMath::Max(Settings.NumBands, 0);
+	const int32 HalfSize = Settings.FFTSize / 2;
+	Bands.Reserve(NumBands);
+	Weights.Reserve(HalfSize + NumBands * 2);
+
+	if (Settings.Scale == ESpectrumBandScale::Linear || Settings.SampleRate <= 0)
+	{
+		// Split bins 1 .. FFTSize / 2 into equal runs, the first few bands taking one extra bin
+		const int32 BinsPerBand = NumBands > 0 ? HalfSize / NumBands : 0;
+		int32 ExcessBins = NumBands > 0 ? HalfSize % NumBands : 0;
+		int32 FirstBin = 1;
+		for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+		{
+			const int32 NumBins = BinsPerBand + (ExcessBins-- > 0 ? 1 : 0);
+			AddBand((FirstBin - 0.5) * Settings.SampleRate / Settings.FFTSize, (FirstBin + NumBins - 0.5) * Settings.SampleRate / Settings.FFTSize);
+			FirstBin += NumBins;
+		}
+		return;
+	}
+
+	const double Nyquist = Settings.SampleRate * 0.5;
+	const double Low = FMath::Clamp<double>(Settings.MinFrequency, 1.0, Nyquist);
+	for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+	{
+		const double A = (double)BandIndex / NumBands;
+		const double B = (double)(BandIndex + 1) / NumBands;
+		switch (Settings.Scale)
+		{
+		case ESpectrumBandScale::Logarithmic:
+			AddBand(Low * pow(Nyquist / Low, A), Low * pow(Nyquist / Low, B));
+			break;
+		case ESpectrumBandScale::Mel:
+			AddBand(MelToHz(FMath::Lerp(HzToMel(Low), HzToMel(Nyquist), A)), MelToHz(FMath::Lerp(HzToMel(Low), HzToMel(Nyquist), B)));
+			break;
+		case ESpectrumBandScale::Bark:
+			AddBand(BarkToHz(FMath::Lerp(HzToBark(Low), HzToBark(Nyquist), A)), BarkToHz(FMath::Lerp(HzToBark(Low), HzToBark(Nyquist), B)));
+			break;
+		case ESpectrumBandScale::Octave:
+		default:
+		{
+			const double Fraction = FMath::Max(Settings.OctaveFraction, 1);
+			AddBand(Low * pow(2.0, BandIndex / Fraction), Low * pow(2.0, (BandIndex + 1) / Fraction));
+			break;
+		}
+		}
+	}
+}
+
+void FBandMap::AddBand(double LowFrequency, double HighFrequency)
+{
+	FBand& Band = Bands[Bands.AddUninitialized()];
+	Band.FirstBin = 0;
+	Band.NumBins = 0;
+	Band.FirstWeight = Weights.Num();
+
+	const int32 LastBin = Settings.FFTSize / 2;
+	if (Settings.SampleRate <= 0 || LastBin <= 0 || HighFrequency <= LowFrequency)
+	{
+		return;
+	}
+
+	// Bin k covers frequencies (k - 0.5) * BinWidth .. (k + 0.5) * BinWidth
+	const double BinWidth = (double)Settings.SampleRate / Settings.FFTSize;
+	const double Lo = LowFrequency / BinWidth;
+	const double Hi = HighFrequency / BinWidth;
+	const int32 FirstBin = FMath::Clamp(FMath::FloorToInt(Lo + 0.5), 0, LastBin);
+	const int32 EndBin = FMath::Clamp(FMath::CeilToInt(Hi + 0.5), 0, LastBin + 1);
+
+	double TotalOverlap = 0.0;
+	for (int32 Bin = FirstBin; Bin < EndBin; ++Bin)
+	{
+		TotalOverlap += FMath::Max(0.0, FMath::Min(Hi, Bin + 0.5) - FMath::Max(Lo, Bin - 0.5));
+	}
+	if (TotalOverlap <= 0.0)
+	{
+		// Entirely above Nyquist
+		return;
+	}
+
+	// Mean over the band, and the 2 / N amplitude scaling squared
+	const double Scale = 4.0 / ((double)Settings.FFTSize * Settings.FFTSize) / TotalOverlap;
+	Band.FirstBin = FirstBin;
+	Band.NumBins = EndBin - FirstBin;
+	for (int32 Bin = FirstBin; Bin < EndBin; ++Bin)
+	{
+		const double Overlap = FMath::Max(0.0, FMath::Min(Hi, Bin + 0.5) - FMath::Max(Lo, Bin - 0.5));
+		Weights.Add((float)(Overlap * Scale));
+	}
+}
+
+void FBandMap::AccumulatePower(const kiss_fft_cpx* Bins, float* InOutPower) const
+{
+	const float* BandWeights = Weights.GetData();
+	for (int32 BandIndex = 0; BandIndex < Bands.Num(); ++BandIndex)
+	{
+		const FBand& Band = Bands[BandIndex];
+		const kiss_fft_cpx* Bin = Bins + Band.FirstBin;
+		const float* Weight = BandWeights + Band.FirstWeight;
+		float Power = 0.f;
+		for (int32 Index = 0; Index < Band.NumBins; ++Index)
+		{
+			Power += Weight[Index] * (Bin[Index].r * Bin[Index].r + Bin[Index].i * Bin[Index].i);
+		}
+		InOutPower[BandIndex] += Power;
+	}
+}
+
+void FBandMap::AccumulatePowerFixed(const kiss_fft_s16_cpx* Bins, float PowerScale, float* InOutPower) const
+{
+	const float* BandWeights = Weights.GetData();
+	for (int32 BandIndex = 0; BandIndex < Bands.Num(); ++BandIndex)
+	{
+		const FBand& Band = Bands[BandIndex];
+		const kiss_fft_s16_cpx* Bin = Bins + Band.FirstBin;
+		const float* Weight = BandWeights + Band.FirstWeight;
+		float Power = 0.f;
+		for (int32 Index = 0; Index < Band.NumBins; ++Index)
+		{
+			// Both squares of an int16 add up to at most 2^31, which only fits unsigned
+			const uint32 BinPower = (uint32)(Bin[Index].r * Bin[Index].r) + (uint32)(Bin[Index].i * Bin[Index].i);
+			Power += Weight[Index] * (float)BinPower;
+		}
+		InOutPower[BandIndex] += Power * PowerScale;
+	}
+}
+
+void FBandMap::AccumulatePowerPacked8(const int8* Packed, float PowerScale, float* InOutPower) const
+{
+	const float* BandWeights = Weights.GetData();
+	const int32 LastBin = Settings.FFTSize / 2;
+	for (int32 BandIndex = 0; BandIndex < Bands.Num(); ++BandIndex)
+	{
+		const FBand& Band = Bands[BandIndex];
+		const float* Weight = BandWeights + Band.FirstWeight;
+		float Power = 0.f;
+		for (int32 Index = 0; Index < Band.NumBins; ++Index)
+		{
+			// DC and Nyquist have no imaginary part, so their real parts share the first pair
+			const int32 Bin = Band.FirstBin + Index;
+			const int32 Real = Bin == 0 ? Packed[0] : Bin == LastBin ? Packed[1] : Packed[2 * Bin];
+			const int32 Imag = Bin == 0 || Bin == LastBin ? 0 : Packed[2 * Bin + 1];
+			Power += Weight[Index] * (float)(Real * Real + Imag * Imag);
+		}
+		InOutPower[BandIndex] += Power * PowerScale;
+	}
+}
+
+void FBandMap::ComputeDecibels(const kiss_fft_cpx* Bins, float* OutBands) const
+{
+	FMemory::Memzero(OutBands, sizeof(float) * Bands.Num());
+	AccumulatePower(Bins, OutBands);
+	PowerToDecibels(OutBands, Bands.Num());
+}
+
+void FBandMap::PowerToDecibels(float* InOut, int32 Num, float PowerScale)
+{
+	// 10 * log10(x) == (10 / ln 10) * ln(x)
+	const float DecibelsPerNeper = 4.342944819f;
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const float Decibels = DecibelsPerNeper * FMath::Loge(InOut[Index] * PowerScale);
+		InOut[Index] = FMath::IsFinite(Decibels) ? Decibels : 0.f;
+	}
+}
+
+FBandMapCache& FBandMapCache::Get()
+{
+	static FBandMapCache Cache;
+	return Cache;
+}
+
+FBandMapPtr FBandMapCache::FindOrCreate(const FBandMapSettings& Settings)
+{
+	if (Settings.FFTSize < 2 || Settings.NumBands <= 0)
+	{
+		return nullptr;
+	}
+
+	Lock.ReadLock();
+	const FBandMapPtr* Found = Maps.Find(Settings);
+	FBandMapPtr Map = Found != nullptr ? *Found : nullptr;
+	Lock.ReadUnlock();
+	if (Map.IsValid())
+	{
+		return Map;
+	}
+
+	Map = MakeShareable(new FBandMap(Settings));
+	Lock.WriteLock();
+	if (const FBandMapPtr* Existing = Maps.Find(Settings))
+	{
+		Map = *Existing;
+	}
+	else
+	{
+		Maps.Add(Settings, Map);
+	}
+	Lock.WriteUnlock();
+	return Map;
+}
+
+void FBandMapCache::Empty()
+{
+	Lock.WriteLock();
+	Maps.Empty();
+	Lock.WriteUnlock();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "SpectrumAnalyzer.h"
+#include "kiss_fft.h"
+#include "kiss_fft_s16.h"
+
+struct FBandMapSettings
+{
+	int32 FFTSize;
+	int32 SampleRate;
+	int32 NumBands;
+	ESpectrumBandScale Scale;
+	int32 OctaveFraction;
+	float MinFrequency;
+
+	bool operator==(const FBandMapSettings& Other) const
+	{
+		return FFTSize == Other.FFTSize && SampleRate == Other.SampleRate && NumBands == Other.NumBands
+			&& Scale == Other.Scale && OctaveFraction == Other.OctaveFraction && MinFrequency == Other.MinFrequency;
+	}
+	friend uint32 GetTypeHash(const FBandMapSettings& Settings)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Settings.FFTSize), GetTypeHash(Settings.SampleRate));
+		Hash = HashCombine(Hash, GetTypeHash(Settings.NumBands));
+		Hash = HashCombine(Hash, (uint32)Settings.Scale | ((uint32)Settings.OctaveFraction << 8));
+		return HashCombine(Hash, GetTypeHash(Settings.MinFrequency));
+	}
+};
+
+/**
+ * Sparse matrix mapping the FFTSize / 2 + 1 bins of a real FFT onto output bands.
+ *
+ * Every band covers a contiguous run of bins, each weighted by how much of the bin lies inside the
+ * band, so bands narrower than a bin still pick up a share of it. Weights also fold in the mean and
+ * the 2 / FFTSize amplitude scaling, so band power is a single weighted sum of |X|^2 and decibels
+ * cost one log per band instead of one per bin.
+ */
+class FBandMap
+{
+public:
+	explicit FBandMap(const FBandMapSettings& InSettings);
+
+	const FBandMapSettings& GetSettings() const { return Settings; }
+	int32 GetNumBands() const { return Settings.NumBands; }
+
+	/** Adds each band's power to InOutPower. Bins holds FFTSize / 2 + 1 values. */
+	void AccumulatePower(const kiss_fft_cpx* Bins, float* InOutPower) const;
+
+	/** AccumulatePower for fixed point bins; each band's power is multiplied by PowerScale. */
+	void AccumulatePowerFixed(const kiss_fft_s16_cpx* Bins, float PowerScale, float* InOutPower) const;
+
+	/**
+	 * AccumulatePower for the packed 8 bit spectrum of Android's Visualizer: Packed[0] and Packed[1] are
+	 * the real parts of DC and Nyquist, then Packed[2k], Packed[2k + 1] are bin k. FFTSize bytes in all.
+	 */
+	void AccumulatePowerPacked8(const int8* Packed, float PowerScale, float* InOutPower) const;
+
+	/** Writes each band's level in dB. */
+	void ComputeDecibels(const kiss_fft_cpx* Bins, float* OutBands) const;
+
+	/** Converts Num power values, each multiplied by PowerScale, to dB in place. Silent bands come out as 0 rather than -inf. */
+	static void PowerToDecibels(float* InOut, int32 Num, float PowerScale = 1.f);
+
+private:
+	struct FBand
+	{
+		int32 FirstBin;
+		int32 NumBins;
+		/** Index of the band's first weight in Weights */
+		int32 FirstWeight;
+	};
+
+	void AddBand(double LowFrequency, double HighFrequency);
+
+	FBandMapSettings Settings;
+	TArray<FBand> Bands;
+	TArray<float> Weights;
+};
+
+typedef TSharedPtr<const FBandMap, ESPMode::ThreadSafe> FBandMapPtr;
+
+/** Band maps shared by all analyzers with the same FFT size, sample rate and band layout. */
+class FBandMapCache
+{
+public:
+	static FBandMapCache& Get();
+
+	FBandMapPtr FindOrCreate(const FBandMapSettings& Settings);
+	void Empty();
+
+private:
+	FBandMapCache() {}
+
+	mutable FRWLock Lock;
+	TMap<FBandMapSettings, FBandMapPtr> Maps;
+};
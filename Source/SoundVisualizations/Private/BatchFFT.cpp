@@ -0,0 +1,260 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "BatchFFT.h"
+
+#if defined(__AVX2__)
+#define SOUNDVIS_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUNDVIS_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOUNDVIS_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// One value from each signal of a batch
+#if SOUNDVIS_SIMD_AVX2
+	typedef __m256 FLanes;
+	const int32 NumLanes = 8;
+	FORCEINLINE FLanes LoadLanes(const float* Src) { return _mm256_loadu_ps(Src); }
+	FORCEINLINE void StoreLanes(float* Dst, FLanes Value) { _mm256_storeu_ps(Dst, Value); }
+	FORCEINLINE FLanes SplatLanes(float Value) { return _mm256_set1_ps(Value); }
+	FORCEINLINE FLanes AddLanes(FLanes A, FLanes B) { return _mm256_add_ps(A, B); }
+	FORCEINLINE FLanes SubLanes(FLanes A, FLanes B) { return _mm256_sub_ps(A, B); }
+	FORCEINLINE FLanes MulLanes(FLanes A, FLanes B) { return _mm256_mul_ps(A, B); }
+#elif SOUNDVIS_SIMD_SSE2
+	typedef __m128 FLanes;
+	const int32 NumLanes = 4;
+	FORCEINLINE FLanes LoadLanes(const float* Src) { return _mm_loadu_ps(Src); }
+	FORCEINLINE void StoreLanes(float* Dst, FLanes Value) { _mm_storeu_ps(Dst, Value); }
+	FORCEINLINE FLanes SplatLanes(float Value) { return _mm_set1_ps(Value); }
+	FORCEINLINE FLanes AddLanes(FLanes A, FLanes B) { return _mm_add_ps(A, B); }
+	FORCEINLINE FLanes SubLanes(FLanes A, FLanes B) { return _mm_sub_ps(A, B); }
+	FORCEINLINE FLanes MulLanes(FLanes A, FLanes B) { return _mm_mul_ps(A, B); }
+#elif SOUNDVIS_SIMD_NEON
+	typedef float32x4_t FLanes;
+	const int32 NumLanes = 4;
+	FORCEINLINE FLanes LoadLanes(const float* Src) { return vld1q_f32(Src); }
+	FORCEINLINE void StoreLanes(float* Dst, FLanes Value) { vst1q_f32(Dst, Value); }
+	FORCEINLINE FLanes SplatLanes(float Value) { return vdupq_n_f32(Value); }
+	FORCEINLINE FLanes AddLanes(FLanes A, FLanes B) { return vaddq_f32(A, B); }
+	FORCEINLINE FLanes SubLanes(FLanes A, FLanes B) { return vsubq_f32(A, B); }
+	FORCEINLINE FLanes MulLanes(FLanes A, FLanes B) { return vmulq_f32(A, B); }
+#else
+	typedef float FLanes;
+	const int32 NumLanes = 1;
+	FORCEINLINE FLanes LoadLanes(const float* Src) { return *Src; }
+	FORCEINLINE void StoreLanes(float* Dst, FLanes Value) { *Dst = Value; }
+	FORCEINLINE FLanes SplatLanes(float Value) { return Value; }
+	FORCEINLINE FLanes AddLanes(FLanes A, FLanes B) { return A + B; }
+	FORCEINLINE FLanes SubLanes(FLanes A, FLanes B) { return A - B; }
+	FORCEINLINE FLanes MulLanes(FLanes A, FLanes B) { return A * B; }
+#endif
+
+	/** A complex value per signal, kept as separate real and imaginary registers */
+	struct FComplexLanes
+	{
+		FLanes R;
+		FLanes I;
+	};
+
+	/** Element Index of the transposed buffer: NumLanes real parts followed by NumLanes imaginary parts */
+	FORCEINLINE FComplexLanes LoadElement(const float* Data, int32 Index)
+	{
+		FComplexLanes Value;
+		Value.R = LoadLanes(Data + Index * 2 * NumLanes);
+		Value.I = LoadLanes(Data + Index * 2 * NumLanes + NumLanes);
+		return Value;
+	}
+
+	FORCEINLINE void StoreElement(float* Data, int32 Index, const FComplexLanes& Value)
+	{
+		StoreLanes(Data + Index * 2 * NumLanes, Value.R);
+		StoreLanes(Data + Index * 2 * NumLanes + NumLanes, Value.I);
+	}
+
+	FORCEINLINE FComplexLanes Add(const FComplexLanes& A, const FComplexLanes& B)
+	{
+		FComplexLanes Value = { AddLanes(A.R, B.R), AddLanes(A.I, B.I) };
+		return Value;
+	}
+
+	FORCEINLINE FComplexLanes Sub(const FComplexLanes& A, const FComplexLanes& B)
+	{
+		FComplexLanes Value = { SubLanes(A.R, B.R), SubLanes(A.I, B.I) };
+		return Value;
+	}
+
+	/** A times the same complex number W in every lane */
+	FORCEINLINE FComplexLanes Mul(const FComplexLanes& A, const FComplexLanes& W)
+	{
+		FComplexLanes Value = { SubLanes(MulLanes(A.R, W.R), MulLanes(A.I, W.I)), AddLanes(MulLanes(A.R, W.I), MulLanes(A.I, W.R)) };
+		return Value;
+	}
+
+	/** A times -i */
+	FORCEINLINE FComplexLanes MulMinusI(const FComplexLanes& A)
+	{
+		FComplexLanes Value = { A.I, SubLanes(SplatLanes(0.f), A.R) };
+		return Value;
+	}
+
+	FORCEINLINE FComplexLanes SplatTwiddle(const float* Twiddle)
+	{
+		FComplexLanes Value = { SplatLanes(Twiddle[0]), SplatLanes(Twiddle[1]) };
+		return Value;
+	}
+}
+
+int32 FBatchRealFFT::GetNumLanes()
+{
+	return NumLanes;
+}
+
+FBatchRealFFT::FBatchRealFFT(int32 InSize)
+	: Size(InSize)
+	, NumComplex(InSize / 2)
+{
+	check(IsSupportedSize(Size));
+
+	int32 NumBits = 0;
+	while ((1 << NumBits) < NumComplex)
+	{
+		++NumBits;
+	}
+	BitReverse.SetNumUninitialized(NumComplex);
+	for (int32 Index = 0; Index < NumComplex; ++Index)
+	{
+		int32 Reversed = 0;
+		for (int32 Bit = 0; Bit < NumBits; ++Bit)
+		{
+			Reversed |= ((Index >> Bit) & 1) << (NumBits - 1 - Bit);
+		}
+		BitReverse[Index] = Reversed;
+	}
+
+	// Computed in double so the tables are as accurate as kiss_fft's
+	Twiddles.SetNumUninitialized(FMath::Max(NumComplex / 2, 1) * 2);
+	for (int32 Index = 0; Index < Twiddles.Num() / 2; ++Index)
+	{
+		const double Phase = -2.0 * PI * Index / NumComplex;
+		Twiddles[Index * 2] = (float)cos(Phase);
+		Twiddles[Index * 2 + 1] = (float)sin(Phase);
+	}
+	SplitTwiddles.SetNumUninitialized(NumComplex / 2 * 2);
+	for (int32 Index = 1; Index <= NumComplex / 2; ++Index)
+	{
+		const double Phase = -PI * ((double)Index / NumComplex + 0.5);
+		SplitTwiddles[(Index - 1) * 2] = (float)cos(Phase);
+		SplitTwiddles[(Index - 1) * 2 + 1] = (float)sin(Phase);
+	}
+}
+
+void FBatchRealFFT::Transform(const float* const* In, kiss_fft_cpx* const* Out, int32 NumSignals, float* Scratch) const
+{
+	check(NumSignals > 0 && NumSignals <= NumLanes);
+	const int32 N = NumComplex;
+	float* Data = Scratch;
+
+	// Pack each signal as N complex values, even samples real and odd ones imaginary, in bit
+	// reversed order. Unused lanes repeat the last signal; their results are dropped.
+	const float* Signals[NumLanes];
+	for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+	{
+		Signals[Lane] = In[FMath::Min(Lane, NumSignals - 1)];
+	}
+	for (int32 Index = 0; Index < N; ++Index)
+	{
+		float* Element = Data + BitReverse[Index] * 2 * NumLanes;
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			Element[Lane] = Signals[Lane][2 * Index];
+			Element[NumLanes + Lane] = Signals[Lane][2 * Index + 1];
+		}
+	}
+
+	// Decimation in time, two radix-2 stages per pass over the data. An odd stage count starts
+	// with a single twiddle-free stage.
+	int32 Half = 1;
+	int32 NumStages = 0;
+	while ((1 << NumStages) < N)
+	{
+		++NumStages;
+	}
+	if (NumStages & 1)
+	{
+		for (int32 Index = 0; Index < N; Index += 2)
+		{
+			const FComplexLanes A = LoadElement(Data, Index);
+			const FComplexLanes B = LoadElement(Data, Index + 1);
+			StoreElement(Data, Index, Add(A, B));
+			StoreElement(Data, Index + 1, Sub(A, B));
+		}
+		Half = 2;
+	}
+	for (; Half * 4 <= N; Half *= 4)
+	{
+		// Stage of length 2 * Half pairs (j, j + Half); the next one, of length 4 * Half, pairs
+		// (j, j + 2 * Half) with twiddle W and (j + Half, j + 3 * Half) with twiddle -i * W
+		const int32 InnerStride = N / (2 * Half);
+		const int32 OuterStride = N / (4 * Half);
+		for (int32 Column = 0; Column < Half; ++Column)
+		{
+			const FComplexLanes Inner = SplatTwiddle(Twiddles.GetData() + Column * InnerStride * 2);
+			const FComplexLanes Outer = SplatTwiddle(Twiddles.GetData() + Column * OuterStride * 2);
+			for (int32 Block = Column; Block < N; Block += 4 * Half)
+			{
+				const FComplexLanes A = LoadElement(Data, Block);
+				const FComplexLanes B = Mul(LoadElement(Data, Block + Half), Inner);
+				const FComplexLanes C = LoadElement(Data, Block + 2 * Half);
+				const FComplexLanes D = Mul(LoadElement(Data, Block + 3 * Half), Inner);
+
+				const FComplexLanes A1 = Add(A, B);
+				const FComplexLanes B1 = Sub(A, B);
+				const FComplexLanes C1 = Mul(Add(C, D), Outer);
+				const FComplexLanes D1 = MulMinusI(Mul(Sub(C, D), Outer));
+
+				StoreElement(Data, Block, Add(A1, C1));
+				StoreElement(Data, Block + 2 * Half, Sub(A1, C1));
+				StoreElement(Data, Block + Half, Add(B1, D1));
+				StoreElement(Data, Block + 3 * Half, Sub(B1, D1));
+			}
+		}
+	}
+
+	// Untangle the complex transform into bins 1 to N - 1 of the real one, as kiss_fftr does.
+	// Element 0 is left alone; DC and Nyquist are taken from it below.
+	const FLanes OneHalf = SplatLanes(0.5f);
+	for (int32 Bin = 1; Bin <= N / 2; ++Bin)
+	{
+		const FComplexLanes Fpk = LoadElement(Data, Bin);
+		const FComplexLanes Fpnk = LoadElement(Data, N - Bin);
+		// f1 = fpk + conj(fpnk), f2 = fpk - conj(fpnk)
+		const FComplexLanes F1 = { AddLanes(Fpk.R, Fpnk.R), SubLanes(Fpk.I, Fpnk.I) };
+		const FComplexLanes F2 = { SubLanes(Fpk.R, Fpnk.R), AddLanes(Fpk.I, Fpnk.I) };
+		const FComplexLanes Tw = Mul(F2, SplatTwiddle(SplitTwiddles.GetData() + (Bin - 1) * 2));
+
+		const FComplexLanes Low = { MulLanes(AddLanes(F1.R, Tw.R), OneHalf), MulLanes(AddLanes(F1.I, Tw.I), OneHalf) };
+		const FComplexLanes High = { MulLanes(SubLanes(F1.R, Tw.R), OneHalf), MulLanes(SubLanes(Tw.I, F1.I), OneHalf) };
+		StoreElement(Data, Bin, Low);
+		StoreElement(Data, N - Bin, High);
+	}
+
+	for (int32 Lane = 0; Lane < NumSignals; ++Lane)
+	{
+		kiss_fft_cpx* Bins = Out[Lane];
+		const float DCR = Data[Lane];
+		const float DCI = Data[NumLanes + Lane];
+		Bins[0].r = DCR + DCI;
+		Bins[0].i = 0.f;
+		Bins[N].r = DCR - DCI;
+		Bins[N].i = 0.f;
+		for (int32 Bin = 1; Bin < N; ++Bin)
+		{
+			Bins[Bin].r = Data[Bin * 2 * NumLanes + Lane];
+			Bins[Bin].i = Data[Bin * 2 * NumLanes + NumLanes + Lane];
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "kiss_fft.h"
+
+/**
+ * Forward real FFT of several signals at once, one signal per SIMD lane: 8 with AVX2, 4 with SSE2
+ * or NEON. Signals are transposed into lanes on the way in, so every butterfly runs on all of them
+ * with the same instructions, and transposed back into kiss_fftr's output layout on the way out.
+ *
+ * Only power of two sizes up to MaxSize are supported: past that the lanes no longer fit in L1 and
+ * kiss_fftr, one signal at a time, is faster. Tables are immutable and the caller supplies the scratch
+ * space, so one instance can be used by any number of threads at once.
+ */
+class FBatchRealFFT
+{
+public:
+	/** Signals transformed together; 1 when there is no vector unit to spread them over. */
+	static int32 GetNumLanes();
+
+	static const int32 MaxSize = 1024;
+
+	static bool IsSupportedSize(int32 Size) { return Size >= 4 && Size <= MaxSize && (Size & (Size - 1)) == 0; }
+
+	explicit FBatchRealFFT(int32 InSize);
+
+	int32 GetSize() const { return Size; }
+
+	/** Number of floats of scratch Transform needs. */
+	int32 GetScratchSize() const { return NumComplex * 2 * GetNumLanes(); }
+
+	/** Transforms NumSignals <= GetNumLanes() signals of GetSize() samples into GetSize() / 2 + 1 bins each. */
+	void Transform(const float* const* In, kiss_fft_cpx* const* Out, int32 NumSignals, float* Scratch) const;
+
+private:
+	/** The real transform runs as a complex one of half the size */
+	int32 Size;
+	int32 NumComplex;
+	/** Bit reversal permutation of NumComplex indices */
+	TArray<int32> BitReverse;
+	/** exp(-2 pi i k / NumComplex) for k < NumComplex / 2, as (r, i) pairs */
+	TArray<float> Twiddles;
+	/** exp(-pi i (k / NumComplex + 1/2)) for k in [1, NumComplex / 2], as (r, i) pairs */
+	TArray<float> SplitTwiddles;
+};
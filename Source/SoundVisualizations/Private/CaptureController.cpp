@@ -0,0 +1,149 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "CaptureController.h"
+
+const double FCaptureController::PeriodSeconds = 1.0;
+const double FCaptureController::IdleSeconds = 0.5;
+
+namespace
+{
+	/** The Visualizer offers no minimum rate; one capture a second is enough to tell when reads pick up */
+	const int32 MinRateMilliHz = 1000;
+	/** A measured rate has to move this far from the current one before the capture is reconfigured */
+	const float RateHysteresis = 0.25f;
+}
+
+FCaptureController::FCaptureController()
+	: MinSize(0)
+	, MaxSize(0)
+	, MaxRateMilliHz(0)
+	, ReadPeriodStart(0.0)
+	, LastReadSeconds(0.0)
+	, LastReadFrame(0)
+	, PeriodReads(0)
+	, PeriodFramesNeeded(0)
+	, ReadsPerSecond(0.f)
+	, FramesNeeded(0)
+	, LastReadMillis(0)
+	, bPaused(0)
+	, bIdle(0)
+	, TotalCallbacks(0)
+	, TotalBytes(0)
+	, CountPeriodStart(0.0)
+	, PeriodStartCallbacks(0)
+	, PeriodStartBytes(0)
+	, CallbacksPerSecond(0.f)
+	, BytesPerSecond(0.f)
+{
+}
+
+void FCaptureController::SetLimits(int32 InMinSize, int32 InMaxSize, int32 InMaxRateMilliHz)
+{
+	MinSize = FMath::Max(InMinSize, 0);
+	MaxSize = FMath::Max(InMaxSize, MinSize);
+	MaxRateMilliHz = FMath::Max(InMaxRateMilliHz, 0);
+	UpdateFormat();
+}
+
+bool FCaptureController::NoteRead(double Now, uint64 Frame, int32 InFramesNeeded)
+{
+	const FCaptureFormat OldFormat = GetFormat();
+	FPlatformAtomics::InterlockedExchange(&LastReadMillis, (int64)(Now * 1000.0));
+	FPlatformAtomics::InterlockedExchange(&bIdle, 0);
+
+	// Reads are counted between the one starting the period and the one ending it. A gap in reading,
+	// as while hidden, says nothing about how often the visual reads when shown, so it starts afresh.
+	if (Now - LastReadSeconds >= IdleSeconds)
+	{
+		ReadPeriodStart = Now;
+		PeriodReads = 0;
+		PeriodFramesNeeded = 0;
+		LastReadFrame = Frame;
+	}
+	else if (Frame != LastReadFrame)
+	{
+		++PeriodReads;
+		LastReadFrame = Frame;
+	}
+	LastReadSeconds = Now;
+	PeriodFramesNeeded = FMath::Max(PeriodFramesNeeded, InFramesNeeded);
+	// Until a period completes, size captures for the reads seen so far
+	FramesNeeded = FMath::Max(FramesNeeded, InFramesNeeded);
+
+	const double Elapsed = Now - ReadPeriodStart;
+	if (Elapsed >= PeriodSeconds)
+	{
+		ReadsPerSecond = (float)(PeriodReads / Elapsed);
+		FramesNeeded = PeriodFramesNeeded;
+		ReadPeriodStart = Now;
+		PeriodReads = 0;
+		PeriodFramesNeeded = 0;
+	}
+	UpdateFormat();
+	return GetFormat() != OldFormat;
+}
+
+bool FCaptureController::SetPaused(bool bInPaused)
+{
+	const FCaptureFormat OldFormat = GetFormat();
+	FPlatformAtomics::InterlockedExchange(&bPaused, bInPaused ? 1 : 0);
+	return GetFormat() != OldFormat;
+}
+
+bool FCaptureController::NoteCapture(double Now, uint32 NumBytes)
+{
+	FPlatformAtomics::InterlockedIncrement(&TotalCallbacks);
+	FPlatformAtomics::InterlockedAdd(&TotalBytes, (int64)NumBytes);
+	const double SinceRead = Now - AtomicRead(&LastReadMillis) / 1000.0;
+	return SinceRead >= IdleSeconds && FPlatformAtomics::InterlockedCompareExchange(&bIdle, 1, 0) == 0;
+}
+
+void FCaptureController::UpdateFormat()
+{
+	Format.Size = MaxSize;
+	if (FramesNeeded > 0)
+	{
+		Format.Size = FMath::Clamp((int32)FMath::RoundUpToPowerOfTwo(FramesNeeded), MinSize, MaxSize);
+	}
+
+	if (ReadsPerSecond <= 0.f || Format.RateMilliHz <= 0)
+	{
+		Format.RateMilliHz = MaxRateMilliHz;
+	}
+	// Capturing faster than the game reads only delivers captures that are overwritten unread
+	const int32 Wanted = FMath::Clamp(FMath::CeilToInt(ReadsPerSecond * 1000.f), FMath::Min(MinRateMilliHz, MaxRateMilliHz), MaxRateMilliHz);
+	if (ReadsPerSecond > 0.f && FMath::Abs(Wanted - Format.RateMilliHz) > Format.RateMilliHz * RateHysteresis)
+	{
+		Format.RateMilliHz = Wanted;
+	}
+	Format.bEnabled = MaxSize > 0;
+}
+
+FCaptureFormat FCaptureController::GetFormat() const
+{
+	FCaptureFormat Current = Format;
+	Current.bEnabled = Current.bEnabled && !bPaused && !bIdle;
+	return Current;
+}
+
+void FCaptureController::GetCaptureRates(double Now, float& OutCallbacksPerSecond, float& OutBytesPerSecond)
+{
+	const int64 Callbacks = AtomicRead(&TotalCallbacks);
+	const int64 Bytes = AtomicRead(&TotalBytes);
+	if (CountPeriodStart == 0.0)
+	{
+		CountPeriodStart = Now;
+		PeriodStartCallbacks = Callbacks;
+		PeriodStartBytes = Bytes;
+	}
+	const double Elapsed = Now - CountPeriodStart;
+	if (Elapsed >= PeriodSeconds)
+	{
+		CallbacksPerSecond = (float)((Callbacks - PeriodStartCallbacks) / Elapsed);
+		BytesPerSecond = (float)((Bytes - PeriodStartBytes) / Elapsed);
+		CountPeriodStart = Now;
+		PeriodStartCallbacks = Callbacks;
+		PeriodStartBytes = Bytes;
+	}
+	OutCallbacksPerSecond = CallbacksPerSecond;
+	OutBytesPerSecond = BytesPerSecond;
+}
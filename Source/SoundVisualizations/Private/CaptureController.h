@@ -0,0 +1,111 @@
+#pragma once
+
+/** What the platform capture should be doing */
+struct FCaptureFormat
+{
+	bool bEnabled;
+	/** Bytes per capture */
+	int32 Size;
+	/** Captures per second, in milliHertz as the Android Visualizer takes it */
+	int32 RateMilliHz;
+
+	FCaptureFormat()
+		: bEnabled(false)
+		, Size(0)
+		, RateMilliHz(0)
+	{
+	}
+
+	bool operator==(const FCaptureFormat& Other) const
+	{
+		return bEnabled == Other.bEnabled && Size == Other.Size && RateMilliHz == Other.RateMilliHz;
+	}
+	bool operator!=(const FCaptureFormat& Other) const { return !(*this == Other); }
+};
+
+/**
+ * Decides how much audio a platform capture such as the Android Visualizer should deliver.
+ *
+ * Captures are as large as the biggest FFT any reader needed over the last period, and come about
+ * as often as the game reads results, since captures nobody reads in between are wasted. Capture
+ * stops when playback pauses or when nobody has read for IdleSeconds, as when the visual is hidden,
+ * and restarts with the next read. Also counts the callbacks and bytes each capture delivers.
+ *
+ * Reads are noted on the game thread and captures on the capture thread. NoteCapture is safe
+ * alongside anything; SetLimits, NoteRead, SetPaused and GetFormat all share the format, so when
+ * they are called from more than one thread the caller serializes them.
+ */
+class FCaptureController
+{
+public:
+	/** Seconds over which reads and captures are counted */
+	static const double PeriodSeconds;
+	/** Seconds without a read after which capture stops */
+	static const double IdleSeconds;
+
+	FCaptureController();
+
+	/** What the platform supports; set before the first read. The largest size and the fastest rate are requested until reads have been measured. */
+	void SetLimits(int32 InMinSize, int32 InMaxSize, int32 InMaxRateMilliHz);
+
+	/**
+	 * Game thread: results needing windows of FramesNeeded frames were read during game frame Frame.
+	 * Reads within the same frame count once. Returns true if the format changed.
+	 */
+	bool NoteRead(double Now, uint64 Frame, int32 FramesNeeded);
+
+	/** Playback paused or resumed. Returns true if the format changed. */
+	bool SetPaused(bool bInPaused);
+
+	/**
+	 * Capture thread: a callback delivered NumBytes. Returns true, once, if nobody has read for
+	 * IdleSeconds, from when GetFormat reports capture disabled until the next NoteRead.
+	 */
+	bool NoteCapture(double Now, uint32 NumBytes);
+
+	/** The format to request */
+	FCaptureFormat GetFormat() const;
+
+	/** Game thread: callbacks and bytes per second over the last complete period */
+	void GetCaptureRates(double Now, float& OutCallbacksPerSecond, float& OutBytesPerSecond);
+
+private:
+	/** Sets Format from the limits and what the last period measured */
+	void UpdateFormat();
+
+	static int64 AtomicRead(volatile const int64* Src)
+	{
+		return FPlatformAtomics::InterlockedCompareExchange(const_cast<volatile int64*>(Src), 0, 0);
+	}
+
+	int32 MinSize;
+	int32 MaxSize;
+	int32 MaxRateMilliHz;
+	FCaptureFormat Format;
+
+	/** Game thread only: reads during the current period */
+	double ReadPeriodStart;
+	double LastReadSeconds;
+	uint64 LastReadFrame;
+	int32 PeriodReads;
+	int32 PeriodFramesNeeded;
+	/** Game thread only: what the last complete period measured; 0 until one completes */
+	float ReadsPerSecond;
+	int32 FramesNeeded;
+
+	/** Last read, in milliseconds of FPlatformTime::Seconds, for the capture thread to compare against */
+	volatile int64 LastReadMillis;
+	volatile int32 bPaused;
+	/** Set by the capture thread when nobody reads, cleared by the next read */
+	volatile int32 bIdle;
+
+	/** Every callback and byte delivered so far */
+	volatile int64 TotalCallbacks;
+	volatile int64 TotalBytes;
+	/** Game thread only: the totals at the start of the current counting period, and what the last one counted */
+	double CountPeriodStart;
+	int64 PeriodStartCallbacks;
+	int64 PeriodStartBytes;
+	float CallbacksPerSecond;
+	float BytesPerSecond;
+};
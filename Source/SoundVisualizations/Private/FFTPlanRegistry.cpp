@@ -0,0 +1,231 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "FFTPlanRegistry.h"
+#include "BatchFFT.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFFTPlanRegistry, Log, All);
+
+#define FFT_PLAN_REGISTRY_DEFAULT_CAPACITY 32
+
+FFFTPlan::FFFTPlan(int32 InSize, bool bInInverse, bool bInReal)
+	: Size(InSize)
+	, bInverse(bInInverse)
+	, bReal(bInReal)
+	, Cfg(nullptr)
+	, RealCfg(nullptr)
+	, FixedRealCfg(nullptr)
+	, BatchFFT(nullptr)
+{
+	if (bReal)
+	{
+		// kiss_fftr only implements the forward real transform for even sizes
+		if (!bInverse && Size >= 2 && (Size & 1) == 0)
+		{
+			RealCfg = kiss_fftr_alloc(Size, 0, nullptr, nullptr);
+			if (FBatchRealFFT::GetNumLanes() > 1 && FBatchRealFFT::IsSupportedSize(Size))
+			{
+				BatchFFT = new FBatchRealFFT(Size);
+			}
+		}
+	}
+	else if (Size > 0)
+	{
+		Cfg = kiss_fft_alloc(Size, bInverse ? 1 : 0, nullptr, nullptr);
+	}
+}
+
+FFFTPlan::~FFFTPlan()
+{
+	if (Cfg != nullptr)
+	{
+		kiss_fft_free(Cfg);
+	}
+	if (RealCfg != nullptr)
+	{
+		kiss_fftr_free(RealCfg);
+	}
+	if (FixedRealCfg != nullptr)
+	{
+		kiss_fftr_s16_free(FixedRealCfg);
+	}
+	delete BatchFFT;
+}
+
+void FFFTPlan::Transform(const kiss_fft_cpx* In, kiss_fft_cpx* Out) const
+{
+	check(Cfg != nullptr);
+	kiss_fft(Cfg, In, Out);
+}
+
+void FFFTPlan::TransformReal(const float* In, kiss_fft_cpx* Out, kiss_fft_cpx* Scratch) const
+{
+	check(RealCfg != nullptr);
+	kiss_fftr_scratch(RealCfg, In, Out, Scratch);
+}
+
+void FFFTPlan::TransformRealFixed(const int16* In, kiss_fft_s16_cpx* Out, kiss_fft_s16_cpx* Scratch) const
+{
+	const kiss_fftr_s16_cfg FixedCfg = GetFixedRealCfg();
+	check(FixedCfg != nullptr);
+	kiss_fftr_s16_scratch(FixedCfg, In, Out, Scratch);
+}
+
+kiss_fftr_s16_cfg FFFTPlan::GetFixedRealCfg() const
+{
+	void** Slot = (void**)&FixedRealCfg;
+	kiss_fftr_s16_cfg Existing = (kiss_fftr_s16_cfg)FPlatformAtomics::InterlockedCompareExchangePointer(Slot, nullptr, nullptr);
+	if (Existing != nullptr)
+	{
+		return Existing;
+	}
+	// Threads racing to build it each allocate one; the first to publish wins and the rest free theirs
+	kiss_fftr_s16_cfg NewCfg = kiss_fftr_s16_alloc(Size, 0, nullptr, nullptr);
+	Existing = (kiss_fftr_s16_cfg)FPlatformAtomics::InterlockedCompareExchangePointer(Slot, NewCfg, nullptr);
+	if (Existing != nullptr)
+	{
+		kiss_fftr_s16_free(NewCfg);
+		return Existing;
+	}
+	return NewCfg;
+}
+
+int32 FFFTPlan::GetRealBatchScratchSize() const
+{
+	return BatchFFT != nullptr ? FMath::Max(GetRealScratchSize(), BatchFFT->GetScratchSize() / 2) : GetRealScratchSize();
+}
+
+void FFFTPlan::TransformRealBatch(const float* const* In, kiss_fft_cpx* const* Out, int32 NumSignals, kiss_fft_cpx* Scratch) const
+{
+	check(RealCfg != nullptr);
+	int32 Signal = 0;
+	if (BatchFFT != nullptr)
+	{
+		// A partial batch costs as much as a full one, which only beats one by one when full
+		const int32 NumLanes = FBatchRealFFT::GetNumLanes();
+		for (; Signal + NumLanes <= NumSignals; Signal += NumLanes)
+		{
+			BatchFFT->Transform(In + Signal, Out + Signal, NumLanes, (float*)Scratch);
+		}
+	}
+	for (; Signal < NumSignals; ++Signal)
+	{
+		kiss_fftr_scratch(RealCfg, In[Signal], Out[Signal], Scratch);
+	}
+}
+
+FFFTPlanRegistry& FFFTPlanRegistry::Get()
+{
+	static FFFTPlanRegistry Registry;
+	return Registry;
+}
+
+FFFTPlanRegistry::FFFTPlanRegistry()
+	: Capacity(FFT_PLAN_REGISTRY_DEFAULT_CAPACITY)
+	, UseClock(0)
+	, Hits(0)
+	, Misses(0)
+	, Evictions(0)
+{
+}
+
+FFFTPlanPtr FFFTPlanRegistry::FindOrCreate(int32 Size, bool bInverse, bool bReal)
+{
+	if (Size <= 0)
+	{
+		return nullptr;
+	}
+	const FKey Key = { Size, bInverse, bReal };
+	const int64 Now = FPlatformAtomics::InterlockedIncrement(&UseClock);
+
+	Lock.ReadLock();
+	FEntry* Found = Plans.Find(Key);
+	if (Found != nullptr)
+	{
+		FFFTPlanPtr Plan = Found->Plan;
+		FPlatformAtomics::InterlockedExchange(&Found->LastUsed, Now);
+		Lock.ReadUnlock();
+		FPlatformAtomics::InterlockedIncrement(&Hits);
+		return Plan;
+	}
+	Lock.ReadUnlock();
+
+	// Computing twiddles is the expensive part, so do it without holding the lock
+	FFFTPlanPtr NewPlan = MakeShareable(new FFFTPlan(Size, bInverse, bReal));
+	if (!NewPlan->IsValid())
+	{
+		return nullptr;
+	}
+
+	Lock.WriteLock();
+	Found = Plans.Find(Key);
+	if (Found != nullptr)
+	{
+		// Another thread created the same plan first; share theirs
+		NewPlan = Found->Plan;
+		Found->LastUsed = Now;
+		FPlatformAtomics::InterlockedIncrement(&Hits);
+	}
+	else
+	{
+		if (Plans.Num() >= Capacity)
+		{
+			EvictLeastRecentlyUsed();
+		}
+		FEntry& Entry = Plans.Add(Key);
+		Entry.Plan = NewPlan;
+		Entry.LastUsed = Now;
+		FPlatformAtomics::InterlockedIncrement(&Misses);
+	}
+	Lock.WriteUnlock();
+	return NewPlan;
+}
+
+void FFFTPlanRegistry::EvictLeastRecentlyUsed()
+{
+	const FKey* Oldest = nullptr;
+	int64 OldestUse = MAX_int64;
+	for (TMap<FKey, FEntry>::TConstIterator It(Plans); It; ++It)
+	{
+		if (It.Value().LastUsed < OldestUse)
+		{
+			OldestUse = It.Value().LastUsed;
+			Oldest = &It.Key();
+		}
+	}
+	if (Oldest != nullptr)
+	{
+		UE_LOG(LogFFTPlanRegistry, Verbose, TEXT("Evicting %s%s FFT plan of size %d"), Oldest->bReal ? TEXT("real") : TEXT("complex"), Oldest->bInverse ? TEXT(" inverse") : TEXT(""), Oldest->Size);
+		const FKey Key = *Oldest;
+		Plans.Remove(Key);
+		FPlatformAtomics::InterlockedIncrement(&Evictions);
+	}
+}
+
+FFFTPlanRegistry::FStats FFFTPlanRegistry::GetStats() const
+{
+	FStats Stats;
+	Lock.ReadLock();
+	Stats.NumPlans = Plans.Num();
+	Lock.ReadUnlock();
+	Stats.Hits = Hits;
+	Stats.Misses = Misses;
+	Stats.Evictions = Evictions;
+	return Stats;
+}
+
+void FFFTPlanRegistry::SetCapacity(int32 NewCapacity)
+{
+	Lock.WriteLock();
+	Capacity = FMath::Max(NewCapacity, 1);
+	while (Plans.Num() > Capacity)
+	{
+		EvictLeastRecentlyUsed();
+	}
+	Lock.WriteUnlock();
+}
+
+void FFFTPlanRegistry::Empty()
+{
+	Lock.WriteLock();
+	Plans.Empty();
+	Lock.WriteUnlock();
+}
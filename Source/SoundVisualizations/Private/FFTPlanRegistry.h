@@ -0,0 +1,133 @@
+#pragma once
+
+#include "kiss_fft.h"
+#include "tools/kiss_fftr.h"
+#include "kiss_fft_s16.h"
+
+class FBatchRealFFT;
+
+/**
+ * An immutable kiss_fft configuration (twiddles and factorization) for one transform size.
+ *
+ * Plans hold no per-call state, so a single plan can be used by any number of threads at once;
+ * real transforms take their scratch space from the caller for that reason.
+ */
+class FFFTPlan
+{
+public:
+	FFFTPlan(int32 InSize, bool bInInverse, bool bInReal);
+	~FFFTPlan();
+
+	int32 GetSize() const { return Size; }
+	bool IsInverse() const { return bInverse; }
+	bool IsReal() const { return bReal; }
+	bool IsValid() const { return bReal ? RealCfg != nullptr : Cfg != nullptr; }
+
+	/** Complex transform of GetSize() points. */
+	void Transform(const kiss_fft_cpx* In, kiss_fft_cpx* Out) const;
+
+	/** Number of complex values of scratch TransformReal needs. */
+	int32 GetRealScratchSize() const { return Size / 2; }
+
+	/** Forward real transform: GetSize() samples in, GetSize() / 2 + 1 bins out. */
+	void TransformReal(const float* In, kiss_fft_cpx* Out, kiss_fft_cpx* Scratch) const;
+
+	/** Number of complex values of scratch TransformRealBatch needs; also enough for TransformReal. */
+	int32 GetRealBatchScratchSize() const;
+
+	/**
+	 * Forward real transform of NumSignals signals, In[s] to Out[s]. Power of two sizes run up to
+	 * FBatchRealFFT::GetNumLanes() signals at a time in SIMD lanes; anything else goes one by one.
+	 */
+	void TransformRealBatch(const float* const* In, kiss_fft_cpx* const* Out, int32 NumSignals, kiss_fft_cpx* Scratch) const;
+
+	/**
+	 * TransformReal in 16 bit fixed point: Q15 samples in, bins divided by GetSize() out. Scratch holds
+	 * GetRealScratchSize() complex values.
+	 */
+	void TransformRealFixed(const int16* In, kiss_fft_s16_cpx* Out, kiss_fft_s16_cpx* Scratch) const;
+
+private:
+	FFFTPlan(const FFFTPlan&);
+	FFFTPlan& operator=(const FFFTPlan&);
+
+	int32 Size;
+	bool bInverse;
+	bool bReal;
+	kiss_fft_cfg Cfg;
+	kiss_fftr_cfg RealCfg;
+	/** Fixed point version of RealCfg, built by the first TransformRealFixed */
+	kiss_fftr_s16_cfg GetFixedRealCfg() const;
+
+	/** Fixed point version of RealCfg; null until GetFixedRealCfg first builds it */
+	mutable kiss_fftr_s16_cfg FixedRealCfg;
+	/** Lane batched version of RealCfg, if the size and platform allow it */
+	FBatchRealFFT* BatchFFT;
+};
+
+typedef TSharedPtr<const FFFTPlan, ESPMode::ThreadSafe> FFFTPlanPtr;
+
+/**
+ * Process wide cache of FFT plans shared by every analyzer.
+ *
+ * Lookups only take a read lock, so analyzers on different threads asking for plans that already
+ * exist never serialize. The registry keeps at most GetCapacity() plans and evicts the least recently
+ * used one when full; callers still holding an evicted plan keep it alive until they let it go.
+ */
+class FFFTPlanRegistry
+{
+public:
+	struct FStats
+	{
+		int32 NumPlans;
+		int64 Hits;
+		int64 Misses;
+		int64 Evictions;
+	};
+
+	static FFFTPlanRegistry& Get();
+
+	/** Returns the plan for the given transform, creating it on first use. Null if Size is unsupported. */
+	FFFTPlanPtr FindOrCreate(int32 Size, bool bInverse, bool bReal);
+
+	FStats GetStats() const;
+	int32 GetCapacity() const { return Capacity; }
+	void SetCapacity(int32 NewCapacity);
+	void Empty();
+
+private:
+	FFFTPlanRegistry();
+
+	struct FKey
+	{
+		int32 Size;
+		bool bInverse;
+		bool bReal;
+
+		bool operator==(const FKey& Other) const
+		{
+			return Size == Other.Size && bInverse == Other.bInverse && bReal == Other.bReal;
+		}
+		friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return HashCombine(GetTypeHash(Key.Size), (Key.bInverse ? 1u : 0u) | (Key.bReal ? 2u : 0u));
+		}
+	};
+
+	struct FEntry
+	{
+		FFFTPlanPtr Plan;
+		/** Value of UseClock at the last lookup; bumped under the read lock, so it is atomic */
+		volatile int64 LastUsed;
+	};
+
+	void EvictLeastRecentlyUsed();
+
+	mutable FRWLock Lock;
+	TMap<FKey, FEntry> Plans;
+	int32 Capacity;
+	volatile int64 UseClock;
+	volatile int64 Hits;
+	volatile int64 Misses;
+	volatile int64 Evictions;
+};
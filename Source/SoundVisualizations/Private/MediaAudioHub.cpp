@@ -0,0 +1,554 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "MediaAudioHub.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMediaAudioHub, Log, All);
+
+// Android has degenerate support for IMediaPlayer audio; the Epic AndroidMediaPlayer ultimately
+// depends on the java MediaPlayer. Our workaround is to use the android Visualizer to obtain
+// 8-bit periodic samples of the output mix.
+
+#if PLATFORM_ANDROID
+#include "Android/AndroidJNI.h"
+#include "Android/AndroidApplication.h"
+#include <android_native_app_glue.h>
+
+jmethodID FMediaAudioHub::CreateVisualizer = 0;
+jmethodID FMediaAudioHub::DestroyVisualizer = 0;
+jmethodID FMediaAudioHub::EnableFFTCapture = 0;
+jmethodID FMediaAudioHub::SetCaptureFormat = 0;
+jclass FMediaAudioHub::VisualizerClass = 0;
+
+void FMediaAudioHub::InitMethodIds()
+{
+	if (CreateVisualizer == 0)
+	{
+		if (JNIEnv* Env = FAndroidApplication::GetJavaEnv())
+		{
+			jmethodID method = FJavaWrapper::FindStaticMethod(Env, FJavaWrapper::GameActivityClassID, "AndroidThunkJava_SoundVisualizationsNonEngineGetVisualizerClass", "()Ljava/lang/Class;", false);
+			VisualizerClass = (jclass)Env->CallStaticObjectMethod(FJavaWrapper::GameActivityClassID, method);
+			CreateVisualizer = FJavaWrapper::FindStaticMethod(Env, VisualizerClass, "createSoundVisualizer", "(JI)Lcom/soundVisualizationsNonEngine/SoundVisualizer;", false);
+			DestroyVisualizer = FJavaWrapper::FindMethod(Env, VisualizerClass, "release", "()V", false);
+			EnableFFTCapture = FJavaWrapper::FindMethod(Env, VisualizerClass, "setFftCaptureEnabled", "(Z)V", false);
+			SetCaptureFormat = FJavaWrapper::FindMethod(Env, VisualizerClass, "setCaptureFormat", "(ZII)V", false);
+		}
+	}
+}
+#endif
+
+FSharedSpectrumAnalysis::FSharedSpectrumAnalysis(const FSharedSpectrumAnalysisKey& InKey, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& History)
+	: Spectrogram(new FSpectrogramHistory())
+	, Key(InKey)
+{
+	Spectrogram->SetCapacity(Key.SpectrogramFrames);
+	Task = MakeShareable(new FSpectrumAnalysisTask(Spectrogram));
+	Task->SetHistory(History);
+	Task->SetStreaming(Key.bStreaming);
+	if (Key.bWorkerThread)
+	{
+		FSpectrumAnalysisWorker::Get().Register(Task);
+	}
+}
+
+FSharedSpectrumAnalysis::~FSharedSpectrumAnalysis()
+{
+	// The hub may still hold the task for a moment; make sure it no longer runs
+	FSpectrumAnalysisWorker::Get().Unregister(Task);
+	Task->SetStreaming(false);
+}
+
+/** Game thread only */
+static TMap<TWeakObjectPtr<UMediaPlayer>, TWeakPtr<FMediaAudioHub, ESPMode::ThreadSafe>> MediaAudioHubs;
+
+TSharedRef<FMediaAudioHub, ESPMode::ThreadSafe> FMediaAudioHub::FindOrCreate(UMediaPlayer* Player)
+{
+	check(IsInGameThread());
+	TWeakPtr<FMediaAudioHub, ESPMode::ThreadSafe>* Found = MediaAudioHubs.Find(Player);
+	if (Found != nullptr)
+	{
+		FMediaAudioHubPtr Hub = Found->Pin();
+		if (Hub.IsValid())
+		{
+			return Hub.ToSharedRef();
+		}
+	}
+
+	for (auto It = MediaAudioHubs.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || !It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	TSharedRef<FMediaAudioHub, ESPMode::ThreadSafe> Hub = MakeShareable(new FMediaAudioHub(Player));
+	MediaAudioHubs.Add(Player, Hub);
+	return Hub;
+}
+
+FMediaAudioHub::FMediaAudioHub(UMediaPlayer* InMediaPlayer)
+	: MediaPlayer(InMediaPlayer)
+	, Channels(0)
+	, SampleRate(0)
+{
+#if PLATFORM_ANDROID
+	PlaybackTicks = 0;
+	CaptureBuffer = nullptr;
+	CaptureBufferSize = 0;
+	FFTCaptureBuffer = nullptr;
+	FFTCaptureBufferSize = 0;
+	NumCaptures = 0;
+	bFFTCapture = 0;
+	Visualizer = 0;
+	CaptureTicker = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMediaAudioHub::TickCapture), (float)FCaptureController::IdleSeconds * 0.5f);
+#endif
+}
+
+FMediaAudioHub::~FMediaAudioHub()
+{
+	Disconnect();
+#if PLATFORM_ANDROID
+	FTicker::GetCoreTicker().RemoveTicker(CaptureTicker);
+	ReleaseVisualizer();
+#endif
+}
+
+void FMediaAudioHub::Connect()
+{
+	UMediaPlayer* Player = MediaPlayer.Get();
+	if (Player == nullptr)
+	{
+		return;
+	}
+	TSharedPtr<IMediaPlayer> Current = Player->GetPlayer();
+	if (Current.IsValid() && Current != ConnectedPlayer.Pin())
+	{
+		Current->GetOutput().SetAudioSink(this);
+		ConnectedPlayer = Current;
+	}
+	if (Player->GetUrl() != BakedUrl)
+	{
+		ReloadBakedSpectrogram();
+	}
+}
+
+void FMediaAudioHub::Disconnect()
+{
+	TSharedPtr<IMediaPlayer> Connected = ConnectedPlayer.Pin();
+	if (Connected.IsValid())
+	{
+		Connected->GetOutput().SetAudioSink(nullptr);
+	}
+	ConnectedPlayer.Reset();
+	CloseBakedSpectrogram();
+}
+
+void FMediaAudioHub::ReloadBakedSpectrogram()
+{
+	check(IsInGameThread());
+	UMediaPlayer* Player = MediaPlayer.Get();
+	BakedUrl = Player != nullptr ? Player->GetUrl() : FString();
+	Baked.Reset();
+	if (!BakedUrl.IsEmpty())
+	{
+		Baked = FBakedSpectrogram::Open(FBakedSpectrogram::GetPathForMedia(BakedUrl));
+	}
+}
+
+void FMediaAudioHub::CloseBakedSpectrogram()
+{
+	Baked.Reset();
+	BakedUrl.Empty();
+}
+
+FSharedSpectrumAnalysisPtr FMediaAudioHub::FindOrAddAnalysis(const FSharedSpectrumAnalysisKey& Key)
+{
+	check(IsInGameThread());
+	FScopeLock ScopeLock(&SubscribersLock);
+	FSharedSpectrumAnalysisPtr Found;
+	for (int32 Index = Analyses.Num() - 1; Index >= 0; --Index)
+	{
+		FSharedSpectrumAnalysisPtr Analysis = Analyses[Index].Analysis.Pin();
+		if (!Analysis.IsValid())
+		{
+			Analyses.RemoveAtSwap(Index);
+		}
+		else if (Analysis->GetKey() == Key)
+		{
+			Found = Analysis;
+		}
+	}
+
+	if (!Found.IsValid())
+	{
+		Found = MakeShareable(new FSharedSpectrumAnalysis(Key, GetHistory()));
+		FAnalysisEntry& Entry = Analyses[Analyses.AddDefaulted()];
+		Entry.Analysis = Found;
+		Entry.Task = Found->Task;
+	}
+#if PLATFORM_ANDROID
+	UpdateFFTCapture();
+#endif
+	return Found;
+}
+
+void FMediaAudioHub::AddSoundWave(UMediaSoundWave* SoundWave)
+{
+#if PLATFORM_ANDROID
+	// no support for this on android yet
+#else
+	if (SoundWave != nullptr)
+	{
+		FScopeLock ScopeLock(&SubscribersLock);
+		SoundWaves.Add(SoundWave);
+	}
+#endif
+}
+
+void FMediaAudioHub::RemoveSoundWave(UMediaSoundWave* SoundWave)
+{
+	FScopeLock ScopeLock(&SubscribersLock);
+	SoundWaves.RemoveSingle(SoundWave);
+}
+
+void FMediaAudioHub::GetSoundWaves(TArray<UMediaSoundWave*, TInlineAllocator<4>>& Out) const
+{
+	FScopeLock ScopeLock(&SubscribersLock);
+	for (int32 Index = 0; Index < SoundWaves.Num(); ++Index)
+	{
+		Out.AddUnique(SoundWaves[Index]);
+	}
+}
+
+TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> FMediaAudioHub::GetHistory() const
+{
+	FScopeLock ScopeLock(&HistoryLock);
+	return History;
+}
+
+const FVisualizerCapture* FMediaAudioHub::GetLatestCapture()
+{
+#if PLATFORM_ANDROID
+	const FVisualizerCapture& Latest = Captures.GetReadBuffer();
+	return Latest.Sequence > 0 ? &Latest : nullptr;
+#else
+	return nullptr;
+#endif
+}
+
+void FMediaAudioHub::GetCaptureRates(float& OutCallbacksPerSecond, float& OutBytesPerSecond)
+{
+#if PLATFORM_ANDROID
+	CaptureController.GetCaptureRates(FPlatformTime::Seconds(), OutCallbacksPerSecond, OutBytesPerSecond);
+#else
+	OutCallbacksPerSecond = 0.f;
+	OutBytesPerSecond = 0.f;
+#endif
+}
+
+FAudioRingBuffer* FMediaAudioHub::PrepareHistory(bool& bOutNewHistory)
+{
+	bOutNewHistory = false;
+	if (Channels <= 0 || SampleRate <= 0)
+	{
+		return nullptr;
+	}
+	// buffer a few seconds
+	if (!History.IsValid() || History->GetNumChannels() != (uint32)Channels || History->GetSampleRate() != (uint32)SampleRate)
+	{
+		TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> NewHistory = MakeShareable(new FAudioRingBuffer(Channels, SampleRate, SampleRate * 3));
+		FScopeLock ScopeLock(&HistoryLock);
+		History = NewHistory;
+		bOutNewHistory = true;
+	}
+	return History.Get();
+}
+
+void FMediaAudioHub::NotifyAnalyses(bool bNewHistory)
+{
+	// Notify outside the lock: streaming tasks not on the worker analyze right here
+	NotifyTasks.Reset();
+	{
+		FScopeLock ScopeLock(&SubscribersLock);
+		for (int32 Index = 0; Index < Analyses.Num(); ++Index)
+		{
+			if (Analyses[Index].Analysis.IsValid())
+			{
+				NotifyTasks.Add(Analyses[Index].Task);
+			}
+		}
+	}
+	for (int32 Index = 0; Index < NotifyTasks.Num(); ++Index)
+	{
+		if (bNewHistory)
+		{
+			NotifyTasks[Index]->SetHistory(History);
+		}
+		NotifyTasks[Index]->NotifyAudio();
+	}
+}
+
+void FMediaAudioHub::PlayAudioSink(const uint8* Buffer, uint32 BufferSize, FTimespan Time)
+{
+	bool bNewHistory;
+	FAudioRingBuffer* Ring = PrepareHistory(bNewHistory);
+	if (Ring == nullptr)
+	{
+		return;
+	}
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		Waves[Index]->PlayAudioSink(Buffer, BufferSize, Time);
+	}
+
+	const uint32 FramesAvailable = BufferSize / (sizeof(int16) * Channels);
+	const FTimespan Duration = FTimespan::FromSeconds((double)FramesAvailable / (double)SampleRate);
+	Ring->Write((const int16*)Buffer, FramesAvailable, Time + Duration);
+	NotifyAnalyses(bNewHistory);
+}
+
+bool FMediaAudioHub::InitializeAudioSink(uint32 InChannels, uint32 InSampleRate)
+{
+	Channels = InChannels;
+	SampleRate = InSampleRate;
+	bool bSoundWaveResult = true;
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		bSoundWaveResult &= Waves[Index]->InitializeAudioSink(InChannels, InSampleRate);
+	}
+#if PLATFORM_ANDROID
+	// Created under the lock, so a second sink initialization can never create another Visualizer that
+	// takes over the capture buffers and holds an audio session of its own. The constructor calls back into
+	// SetCaptureLimits on this thread, which FCriticalSection allows.
+	FScopeLock ScopeLock(&CaptureLock);
+	if (Visualizer == 0)
+	{
+		InitMethodIds();
+		JNIEnv* Env = FAndroidApplication::GetJavaEnv();
+		jobject Obj = Env->CallStaticObjectMethod(VisualizerClass, CreateVisualizer, (jlong)this, (int32)SampleRate);
+		Visualizer = Env->NewGlobalRef(Obj);
+		Env->DeleteLocalRef(Obj);
+		AppliedFormat = FCaptureFormat();
+		UE_LOG(LogMediaAudioHub, Log, TEXT("Created Android Sound Visualizer %p, sample rate: %d"), Visualizer, SampleRate);
+		if (bFFTCapture)
+		{
+			FJavaWrapper::CallVoidMethod(Env, Visualizer, EnableFFTCapture, true);
+		}
+	}
+	ApplyCaptureFormat();
+#endif
+	return bSoundWaveResult && Channels > 0 && SampleRate > 0;
+}
+
+void FMediaAudioHub::FlushAudioSink()
+{
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		Waves[Index]->FlushAudioSink();
+	}
+}
+
+void FMediaAudioHub::PauseAudioSink()
+{
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		Waves[Index]->PauseAudioSink();
+	}
+#if PLATFORM_ANDROID
+	FScopeLock ScopeLock(&CaptureLock);
+	CaptureController.SetPaused(true);
+	ApplyCaptureFormat();
+#endif
+}
+
+void FMediaAudioHub::ResumeAudioSink()
+{
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		Waves[Index]->ResumeAudioSink();
+	}
+#if PLATFORM_ANDROID
+	FScopeLock ScopeLock(&CaptureLock);
+	CaptureController.SetPaused(false);
+	ApplyCaptureFormat();
+#endif
+}
+
+void FMediaAudioHub::ShutdownAudioSink()
+{
+	TArray<UMediaSoundWave*, TInlineAllocator<4>> Waves;
+	GetSoundWaves(Waves);
+	for (int32 Index = 0; Index < Waves.Num(); ++Index)
+	{
+		Waves[Index]->ShutdownAudioSink();
+	}
+#if PLATFORM_ANDROID
+	ReleaseVisualizer();
+#endif
+}
+
+#if PLATFORM_ANDROID
+
+void FMediaAudioHub::SetCaptureBuffers(const uint8* InCaptureBuffer, uint32 InCaptureBufferSize, const int8* InFFTCaptureBuffer, uint32 InFFTCaptureBufferSize)
+{
+	CaptureBuffer = InCaptureBuffer;
+	CaptureBufferSize = InCaptureBufferSize;
+	FFTCaptureBuffer = InFFTCaptureBuffer;
+	FFTCaptureBufferSize = InFFTCaptureBufferSize;
+}
+
+void FMediaAudioHub::UpdateFFTCapture()
+{
+	bool bWanted = false;
+	for (int32 Index = 0; Index < Analyses.Num() && !bWanted; ++Index)
+	{
+		FSharedSpectrumAnalysisPtr Analysis = Analyses[Index].Analysis.Pin();
+		bWanted = Analysis.IsValid() && Analysis->GetKey().Settings.Backend == ESpectrumAnalysisBackend::PlatformFFT;
+	}
+	if ((bFFTCapture != 0) != bWanted)
+	{
+		FPlatformAtomics::InterlockedExchange(&bFFTCapture, bWanted ? 1 : 0);
+		FScopeLock ScopeLock(&CaptureLock);
+		if (Visualizer != 0)
+		{
+			FJavaWrapper::CallVoidMethod(FAndroidApplication::GetJavaEnv(), Visualizer, EnableFFTCapture, bWanted);
+		}
+	}
+}
+
+void FMediaAudioHub::SetCaptureLimits(int32 MinSize, int32 MaxSize, int32 MaxRateMilliHz)
+{
+	// The creator applies the format once the Visualizer is stored
+	FScopeLock ScopeLock(&CaptureLock);
+	CaptureController.SetLimits(MinSize, MaxSize, MaxRateMilliHz);
+}
+
+void FMediaAudioHub::NoteRead(const FSpectrumAnalysisSettings& Settings)
+{
+	const int32 FramesNeeded = SampleRate > 0 ? Settings.GetFFTSize(SampleRate) : 0;
+	FScopeLock ScopeLock(&CaptureLock);
+	CaptureController.NoteRead(FPlatformTime::Seconds(), GFrameCounter, FramesNeeded);
+	ApplyCaptureFormat();
+}
+
+void FMediaAudioHub::ApplyCaptureFormat()
+{
+	// The whole format goes over at once, so a stale enable or disable can never land after a newer one
+	const FCaptureFormat Format = CaptureController.GetFormat();
+	if (Visualizer != 0 && Format != AppliedFormat)
+	{
+		FJavaWrapper::CallVoidMethod(FAndroidApplication::GetJavaEnv(), Visualizer, SetCaptureFormat, Format.bEnabled, Format.Size, Format.RateMilliHz);
+		AppliedFormat = Format;
+	}
+}
+
+bool FMediaAudioHub::TickCapture(float DeltaTime)
+{
+	FScopeLock ScopeLock(&CaptureLock);
+	ApplyCaptureFormat();
+	return true;
+}
+
+void FMediaAudioHub::ReleaseVisualizer()
+{
+	jobject Released;
+	{
+		FScopeLock ScopeLock(&CaptureLock);
+		Released = Visualizer;
+		Visualizer = 0;
+		AppliedFormat = FCaptureFormat();
+	}
+	if (Released != 0)
+	{
+		// Blocks until a callback already in native code has returned, so none can reach the hub after this.
+		// Outside CaptureLock, and never called with SubscribersLock or HistoryLock held, which that callback may take.
+		JNIEnv* Env = FAndroidApplication::GetJavaEnv();
+		FJavaWrapper::CallVoidMethod(Env, Released, DestroyVisualizer);
+		Env->DeleteGlobalRef(Released);
+		SetCaptureBuffers(nullptr, 0, nullptr, 0);
+	}
+}
+
+void FMediaAudioHub::NoteCapture(uint32 NumBytes)
+{
+	// Nobody is looking, as when the visual is hidden; the game thread stops capture on its next tick,
+	// and the next read starts it again
+	CaptureController.NoteCapture(FPlatformTime::Seconds(), NumBytes);
+}
+
+void FMediaAudioHub::HandleCapture(uint32 NumBytes)
+{
+	NoteCapture(NumBytes);
+	bool bNewHistory;
+	FAudioRingBuffer* Ring = PrepareHistory(bNewHistory);
+	if (Ring == nullptr || CaptureBuffer == nullptr)
+	{
+		return;
+	}
+	// Each byte is one mono frame; the ring widens it and copies it to every channel in one pass
+	const uint32 NumFrames = FMath::Min(NumBytes, CaptureBufferSize);
+	const FTimespan Duration = FTimespan::FromSeconds(NumFrames / (double)SampleRate);
+	Ring->WriteUnsigned8(CaptureBuffer, NumFrames, GetPlaybackTime() + Duration);
+	NotifyAnalyses(bNewHistory);
+}
+
+void FMediaAudioHub::HandleFFTCapture(uint32 NumBytes, uint32 CaptureSampleRate)
+{
+	NoteCapture(NumBytes);
+	if (FFTCaptureBuffer == nullptr)
+	{
+		return;
+	}
+	// Mapping onto bands is cheap, so the game thread does it for each analyzer; this only hands the bytes over
+	FVisualizerCapture& Capture = Captures.GetWriteBuffer();
+	Capture.Bins.SetNumUninitialized(FMath::Min(NumBytes, FFTCaptureBufferSize));
+	FMemory::Memcpy(Capture.Bins.GetData(), FFTCaptureBuffer, Capture.Bins.Num());
+	Capture.SampleRate = CaptureSampleRate;
+	Capture.Time = GetPlaybackTime();
+	Capture.Sequence = ++NumCaptures;
+	Captures.Publish();
+}
+
+extern "C"
+{
+
+	JNIEXPORT void JNICALL
+		Java_com_soundVisualizationsNonEngine_SoundVisualizer_nativeSetCaptureBuffers(JNIEnv* Env, jclass clazz, jlong callbackObject, jobject waveBuffer, jobject fftBuffer)
+	{
+		// The SoundVisualizer keeps the buffers alive for as long as the hub holds the visualizer
+		const uint8* WaveAddress = waveBuffer != NULL ? (const uint8*)Env->GetDirectBufferAddress(waveBuffer) : nullptr;
+		const jlong WaveCapacity = WaveAddress != nullptr ? Env->GetDirectBufferCapacity(waveBuffer) : 0;
+		const int8* FFTAddress = fftBuffer != NULL ? (const int8*)Env->GetDirectBufferAddress(fftBuffer) : nullptr;
+		const jlong FFTCapacity = FFTAddress != nullptr ? Env->GetDirectBufferCapacity(fftBuffer) : 0;
+		((FMediaAudioHub*)callbackObject)->SetCaptureBuffers(WaveAddress, (uint32)FMath::Max<jlong>(WaveCapacity, 0), FFTAddress, (uint32)FMath::Max<jlong>(FFTCapacity, 0));
+	}
+
+	JNIEXPORT void JNICALL
+		Java_com_soundVisualizationsNonEngine_SoundVisualizer_nativeSetCaptureLimits(JNIEnv* Env, jclass clazz, jlong callbackObject, jint minSize, jint maxSize, jint maxRate)
+	{
+		((FMediaAudioHub*)callbackObject)->SetCaptureLimits(minSize, maxSize, maxRate);
+	}
+
+	JNIEXPORT void JNICALL
+		Java_com_soundVisualizationsNonEngine_SoundVisualizer_nativeSendWaveForm(JNIEnv* Env, jclass clazz, jlong callbackObject, jint length, jint sampleRate)
+	{
+		((FMediaAudioHub*)callbackObject)->HandleCapture((uint32)FMath::Max(length, 0));
+	}
+
+	JNIEXPORT void JNICALL
+		Java_com_soundVisualizationsNonEngine_SoundVisualizer_nativeSendFft(JNIEnv* Env, jclass clazz, jlong callbackObject, jint length, jint samplingRate)
+	{
+		// The Visualizer reports its sampling rate in milliHertz
+		((FMediaAudioHub*)callbackObject)->HandleFFTCapture((uint32)FMath::Max(length, 0), (uint32)FMath::Max(samplingRate, 0) / 1000);
+	}
+}
+
+#endif
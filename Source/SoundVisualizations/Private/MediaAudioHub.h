@@ -0,0 +1,208 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+#include "SpectrumAnalysisWorker.h"
+#include "SpectrogramHistory.h"
+#include "VisualizerSpectrum.h"
+#include "CaptureController.h"
+#include "BakedSpectrogram.h"
+#if PLATFORM_ANDROID
+#include <jni.h>
+#endif
+
+/** Everything about an analyzer's configuration that decides whether it can share another's analysis */
+struct FSharedSpectrumAnalysisKey
+{
+	FSpectrumAnalysisSettings Settings;
+	bool bWorkerThread;
+	bool bStreaming;
+	int32 SpectrogramFrames;
+
+	bool operator==(const FSharedSpectrumAnalysisKey& Other) const
+	{
+		return Settings == Other.Settings && bWorkerThread == Other.bWorkerThread && bStreaming == Other.bStreaming
+			&& SpectrogramFrames == Other.SpectrogramFrames;
+	}
+	bool operator!=(const FSharedSpectrumAnalysisKey& Other) const { return !(*this == Other); }
+};
+
+/**
+ * The analysis of one player's audio for one configuration: the game thread cache, the worker task
+ * and the spectrogram they record into. Every analyzer of the player configured the same way holds
+ * the same instance, so a window is analyzed once however many analyzers ask for it.
+ */
+class FSharedSpectrumAnalysis
+{
+public:
+	FSharedSpectrumAnalysis(const FSharedSpectrumAnalysisKey& InKey, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& History);
+	~FSharedSpectrumAnalysis();
+
+	const FSharedSpectrumAnalysisKey& GetKey() const { return Key; }
+
+	/** Game thread only */
+	FSpectrumAnalysisCache Cache;
+	TSharedPtr<FSpectrogramHistory, ESPMode::ThreadSafe> Spectrogram;
+	/** Runs the analysis when Key.bWorkerThread or Key.bStreaming is set */
+	FSpectrumAnalysisTaskPtr Task;
+
+private:
+	FSharedSpectrumAnalysisKey Key;
+};
+
+typedef TSharedPtr<FSharedSpectrumAnalysis, ESPMode::ThreadSafe> FSharedSpectrumAnalysisPtr;
+
+/**
+ * The audio sink of one UMediaPlayer, shared by every USpectrumAnalyzer playing from it.
+ *
+ * A player has a single audio sink, so analyzers subscribe to the hub rather than to the player.
+ * Each buffer is written once into the hub's ring, forwarded once to each subscribed sound wave,
+ * and the task of every live shared analysis is told about it. Analyzers hold the hub; it
+ * disconnects from the player when the last one lets go. Created and looked up on the game thread;
+ * the sink interface is called from whichever thread the player delivers audio on.
+ */
+class FMediaAudioHub : public IMediaAudioSink
+{
+public:
+	/** The hub of Player, created on first use. Game thread only. */
+	static TSharedRef<FMediaAudioHub, ESPMode::ThreadSafe> FindOrCreate(UMediaPlayer* Player);
+
+	virtual ~FMediaAudioHub();
+
+	UMediaPlayer* GetMediaPlayer() const { return MediaPlayer.Get(); }
+
+	/** Makes the hub the sink of the player's current media if it is not already. Game thread only. */
+	void Connect();
+	/** Game thread only */
+	void Disconnect();
+
+	/** The shared analysis for Key, created on first use. Game thread only. */
+	FSharedSpectrumAnalysisPtr FindOrAddAnalysis(const FSharedSpectrumAnalysisKey& Key);
+
+	/** Sound waves that play the audio; adding one twice forwards to it once. */
+	void AddSoundWave(UMediaSoundWave* SoundWave);
+	void RemoveSoundWave(UMediaSoundWave* SoundWave);
+
+	/** The ring audio is written to, if any has arrived yet */
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> GetHistory() const;
+
+	/** The baked spectrogram of the player's media, if there was one when it was opened. Game thread only. */
+	const FBakedSpectrogramPtr& GetBakedSpectrogram() const { return Baked; }
+	/** Looks for the baked spectrogram of the player's current media again, as after baking it. Game thread only. */
+	void ReloadBakedSpectrogram();
+	/** Lets go of the baked spectrogram, so it can be overwritten. Game thread only. */
+	void CloseBakedSpectrogram();
+
+	/** Whether this platform can capture spectra for the PlatformFFT backend */
+	static bool HasPlatformFFT() { return !!PLATFORM_ANDROID; }
+	/** The newest platform FFT capture, or null if there has been none. Game thread only. */
+	const FVisualizerCapture* GetLatestCapture();
+	/** Platform capture callbacks and bytes handed over per second; 0 where audio is not captured. Game thread only. */
+	void GetCaptureRates(float& OutCallbacksPerSecond, float& OutBytesPerSecond);
+
+	// IMediaAudioSink interface
+	virtual void FlushAudioSink() override;
+	virtual bool InitializeAudioSink(uint32 InChannels, uint32 InSampleRate) override;
+	virtual int32 GetAudioSinkChannels() const override { return Channels; }
+	virtual int32 GetAudioSinkSampleRate() const override { return SampleRate; }
+	virtual void PauseAudioSink() override;
+	virtual void PlayAudioSink(const uint8* Buffer, uint32 BufferSize, FTimespan Time) override;
+	virtual void ResumeAudioSink() override;
+	virtual void ShutdownAudioSink() override;
+
+private:
+	explicit FMediaAudioHub(UMediaPlayer* InMediaPlayer);
+
+	/** Copies the subscribed sound waves into Out */
+	void GetSoundWaves(TArray<UMediaSoundWave*, TInlineAllocator<4>>& Out) const;
+
+	/** Audio thread: the ring to write to, replaced first if the sink's format changed. Null until the sink is initialized. */
+	FAudioRingBuffer* PrepareHistory(bool& bOutNewHistory);
+	/** Audio thread: tells every live analysis that new audio is in History. */
+	void NotifyAnalyses(bool bNewHistory);
+
+	TWeakObjectPtr<UMediaPlayer> MediaPlayer;
+	/** Player the hub is the sink of */
+	TWeakPtr<IMediaPlayer> ConnectedPlayer;
+	int32 Channels;
+	int32 SampleRate;
+
+	/** Game thread only: the baked spectrogram of the media at BakedUrl */
+	FBakedSpectrogramPtr Baked;
+	FString BakedUrl;
+
+	/** Written only by the thread delivering audio; the lock just guards swapping in a new ring. */
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> History;
+	mutable FCriticalSection HistoryLock;
+
+	struct FAnalysisEntry
+	{
+		TWeakPtr<FSharedSpectrumAnalysis, ESPMode::ThreadSafe> Analysis;
+		/** Kept apart from Analysis so the audio thread never ends up destroying one */
+		FSpectrumAnalysisTaskPtr Task;
+	};
+	/** Guards Analyses and SoundWaves */
+	mutable FCriticalSection SubscribersLock;
+	TArray<FAnalysisEntry> Analyses;
+	TArray<UMediaSoundWave*> SoundWaves;
+	/** Audio thread only: tasks to notify of the buffer being delivered */
+	TArray<FSpectrumAnalysisTaskPtr> NotifyTasks;
+
+#if PLATFORM_ANDROID
+public:
+	/** Game thread: the playback position captured waveforms are stamped relative to */
+	void SetPlaybackTime(FTimespan InPlaybackTime) { FPlatformAtomics::InterlockedExchange(&PlaybackTicks, InPlaybackTime.GetTicks()); }
+	/** Game thread: an analyzer read results analyzed with Settings, so capture is needed and sized for them */
+	void NoteRead(const FSpectrumAnalysisSettings& Settings);
+	/** Capture sizes and rate the Visualizer supports; called from the Visualizer's constructor on the sink thread */
+	void SetCaptureLimits(int32 MinSize, int32 MaxSize, int32 MaxRateMilliHz);
+	/** Capture thread: the direct buffers the Visualizer copies each waveform and spectrum into */
+	void SetCaptureBuffers(const uint8* InCaptureBuffer, uint32 InCaptureBufferSize, const int8* InFFTCaptureBuffer, uint32 InFFTCaptureBufferSize);
+	/** Capture thread: the capture buffer holds a new waveform of NumBytes 8 bit samples */
+	void HandleCapture(uint32 NumBytes);
+	/** Capture thread: the FFT capture buffer holds a new spectrum of NumBytes packed bytes */
+	void HandleFFTCapture(uint32 NumBytes, uint32 CaptureSampleRate);
+	static void InitMethodIds();
+
+private:
+	/** Game thread: captures spectra while any live analysis uses the PlatformFFT backend. Called with SubscribersLock held. */
+	void UpdateFFTCapture();
+	/** Hands the controller's current format to the Visualizer if it differs from the last one handed over. Called with CaptureLock held. */
+	void ApplyCaptureFormat();
+	/** Game thread: applies the format every so often, which is how capture stops once nobody reads */
+	bool TickCapture(float DeltaTime);
+	/** Releases the Visualizer and its audio session, returning once no capture callback can reach the hub. Must not be called with SubscribersLock held. */
+	void ReleaseVisualizer();
+	/** Capture thread: counts a callback, which marks capture idle if nobody reads */
+	void NoteCapture(uint32 NumBytes);
+	/** Capture thread: the last playback time the game thread set, read whole even where 64 bit loads can tear */
+	FTimespan GetPlaybackTime() const { return FTimespan(FPlatformAtomics::InterlockedCompareExchange(const_cast<volatile int64*>(&PlaybackTicks), 0, 0)); }
+
+	/** Ticks of the playback time; written by the game thread and read by the capture thread */
+	volatile int64 PlaybackTicks;
+	const uint8* CaptureBuffer;
+	uint32 CaptureBufferSize;
+	const int8* FFTCaptureBuffer;
+	uint32 FFTCaptureBufferSize;
+	TTripleBuffer<FVisualizerCapture> Captures;
+	/** Capture thread only */
+	uint64 NumCaptures;
+	volatile int32 bFFTCapture;
+	FCaptureController CaptureController;
+	FDelegateHandle CaptureTicker;
+	/**
+	 * Guards Visualizer, AppliedFormat and every CaptureController call but NoteCapture, so the
+	 * Visualizer is only told what to do by one thread at a time and always with the controller's
+	 * latest format. Taken after SubscribersLock.
+	 */
+	FCriticalSection CaptureLock;
+	jobject Visualizer;
+	FCaptureFormat AppliedFormat;
+	static jclass VisualizerClass;
+	static jmethodID CreateVisualizer;
+	static jmethodID DestroyVisualizer;
+	static jmethodID EnableFFTCapture;
+	static jmethodID SetCaptureFormat;
+#endif
+};
+
+typedef TSharedPtr<FMediaAudioHub, ESPMode::ThreadSafe> FMediaAudioHubPtr;
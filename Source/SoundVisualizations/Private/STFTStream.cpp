@@ -0,0 +1,102 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "STFTStream.h"
+
+FSTFTStream::FSTFTStream()
+	: NextEndFrame(0)
+	, NewestSlot(0)
+	, NumFrames(0)
+{
+}
+
+void FSTFTStream::Reset()
+{
+	Ring.Reset();
+	NextEndFrame = 0;
+	NewestSlot = 0;
+	NumFrames = 0;
+}
+
+int32 FSTFTStream::Process(const FSpectrumAnalysisSettings& InSettings, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& InRing)
+{
+	if (!InRing.IsValid())
+	{
+		return 0;
+	}
+	const uint32 SampleRate = InRing->GetSampleRate();
+	const int32 WindowFrames = InSettings.GetWindowFrames(SampleRate);
+	const int32 FFTSize = InSettings.GetFFTSize(SampleRate);
+	const int32 HopFrames = InSettings.GetHopFrames(SampleRate);
+	if (WindowFrames <= 0 || FFTSize > (int32)InRing->GetCapacity())
+	{
+		return 0;
+	}
+
+	if (Ring != InRing || Settings != InSettings)
+	{
+		Reset();
+		Ring = InRing;
+		Settings = InSettings;
+		NextEndFrame = (uint64)((FFTSize + HopFrames - 1) / HopFrames) * HopFrames;
+		// Enough frames to cover everything the ring holds, which bounds how far the decoder can run ahead
+		Frames.SetNum(FMath::Min<int32>(Ring->GetCapacity() / HopFrames + 1, 1024));
+		// Size every slot now so filling the ring for the first time does not allocate a frame per hop
+		const int32 NumPlanes = Ring->GetNumChannels() + 1;
+		for (FSpectrumAnalysisResult& Frame : Frames)
+		{
+			Frame.Spectrum.Reserve(FMath::Max(Settings.SpectrumWidth, 0) * NumPlanes);
+			Frame.Amplitude.Reserve(FMath::Max(Settings.AmplitudeBuckets, 0) * NumPlanes);
+		}
+	}
+
+	FTimespan WriteTime;
+	const uint64 WriteFrame = Ring->GetWritePosition(WriteTime);
+
+	// Skip hops the producer has already overwritten
+	const uint64 Capacity = Ring->GetCapacity();
+	if (WriteFrame > Capacity && NextEndFrame < WriteFrame - Capacity + FFTSize)
+	{
+		const uint64 Behind = WriteFrame - Capacity + FFTSize - NextEndFrame;
+		NextEndFrame += (Behind + HopFrames - 1) / HopFrames * HopFrames;
+	}
+
+	// The nominal window sits in the middle of the FFT window
+	FSpectrumAnalysisWindow Window;
+	Window.AmplitudeOffset = (FFTSize - WindowFrames) - (FFTSize - WindowFrames) / 2;
+	const int32 HeardBeforeEnd = (FFTSize - WindowFrames) / 2;
+
+	int32 NumNewFrames = 0;
+	for (; NextEndFrame <= WriteFrame; NextEndFrame += HopFrames)
+	{
+		Window.EndFrame = NextEndFrame;
+		const FTimespan FrameTime = WriteTime - FTimespan::FromSeconds((double)(WriteFrame - NextEndFrame + HeardBeforeEnd) / SampleRate);
+
+		const int32 Slot = (NewestSlot + 1) % Frames.Num();
+		if (!Engine.AnalyzeWindow(Settings, *Ring, Window, FrameTime, Frames[Slot]))
+		{
+			// The oldest frame lived in that slot and may be half overwritten
+			NumFrames = FMath::Min(NumFrames, Frames.Num() - 1);
+			continue;
+		}
+		NewestSlot = Slot;
+		NumFrames = FMath::Min(NumFrames + 1, Frames.Num());
+		++NumNewFrames;
+	}
+	return NumNewFrames;
+}
+
+const FSpectrumAnalysisResult* FSTFTStream::FindFrame(FTimespan Time) const
+{
+	if (NumFrames == 0)
+	{
+		return nullptr;
+	}
+	for (int32 Age = 0; Age < NumFrames; ++Age)
+	{
+		const FSpectrumAnalysisResult& Frame = GetFrame(Age);
+		if (Frame.Time <= Time)
+		{
+			return &Frame;
+		}
+	}
+	return &GetFrame(NumFrames - 1);
+}
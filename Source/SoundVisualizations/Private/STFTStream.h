@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+
+/**
+ * Short-time Fourier transform of an FAudioRingBuffer at a fixed hop.
+ *
+ * Frame k covers the FFT window ending at frame k * Hop of the ring, so every hop of audio is
+ * windowed and transformed exactly once no matter how often anyone asks for results. Frames are
+ * stamped with the media time heard at the end of their nominal window, and the most recent ones
+ * are kept so a consumer can pick the frame matching playback, which lags behind the decoder.
+ *
+ * Not thread safe; one thread at a time drives a stream.
+ */
+class FSTFTStream
+{
+public:
+	FSTFTStream();
+
+	/** Analyzes every hop completed in Ring since the last call and returns the number of new frames. Starts over if Ring or Settings changed. */
+	int32 Process(const FSpectrumAnalysisSettings& Settings, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& Ring);
+
+	/** The newest retained frame heard at or before Time, else the oldest one; null if there are none. */
+	const FSpectrumAnalysisResult* FindFrame(FTimespan Time) const;
+
+	/** Drops every frame and forgets the ring. */
+	void Reset();
+
+	/** Number of frames retained */
+	int32 GetNumFrames() const { return NumFrames; }
+	/** A retained frame; Age 0 is the newest. */
+	const FSpectrumAnalysisResult& GetFrame(int32 Age) const { return Frames[(NewestSlot - Age + Frames.Num()) % Frames.Num()]; }
+
+private:
+	FSpectrumAnalysisEngine Engine;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring;
+	FSpectrumAnalysisSettings Settings;
+	/** Ring end frame of the next FFT window to analyze */
+	uint64 NextEndFrame;
+
+	/** Recent frames, oldest overwritten first */
+	TArray<FSpectrumAnalysisResult> Frames;
+	int32 NewestSlot;
+	int32 NumFrames;
+};
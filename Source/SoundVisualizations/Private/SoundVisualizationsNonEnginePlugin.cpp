@@ -1,6 +1,12 @@
 // Copyright 1998-2015 Epic Games, Inc. All Rights Reserved.
 
 #include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "FFTPlanRegistry.h"
+#include "WindowFunctions.h"
+#include "BandMapper.h"
+#include "SpectrumAnalysisWorker.h"
+#include "kiss_fft.h"
+#include "Async/ParallelFor.h"
 
 
 
@@ -16,11 +22,23 @@ public:
 
 IMPLEMENT_MODULE( FSoundVisualizationsNonEnginePlugin, SoundVisualizationsNonEngine )
 
+/** Transforms this large are split across the task graph */
+static const int32 ParallelFFTMinSize = 65536;
+
+static void ParallelForFFT(void* Context, int Count, kiss_fft_parallel_fn Fn, void* Arg)
+{
+	ParallelFor(Count, [Fn, Arg](int32 Index)
+	{
+		Fn(Arg, Index);
+	});
+}
+
 
 
 void FSoundVisualizationsNonEnginePlugin::StartupModule()
 {
 	// This code will execute after your module is loaded into memory (but after global variables are initialized, of course.)
+	kiss_fft_set_parallel_for(&ParallelForFFT, nullptr, ParallelFFTMinSize);
 }
 
 
@@ -28,6 +46,11 @@ void FSoundVisualizationsNonEnginePlugin::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FSpectrumAnalysisWorker::Get().Shutdown();
+	kiss_fft_set_parallel_for(nullptr, nullptr, 0);
+	FFFTPlanRegistry::Get().Empty();
+	FWindowTableCache::Get().Empty();
+	FBandMapCache::Get().Empty();
 }
 
 
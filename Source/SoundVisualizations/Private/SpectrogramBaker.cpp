@@ -0,0 +1,299 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "SpectrogramBaker.h"
+#include "AudioConversion.h"
+#include "Audio.h"
+#include "Async/ParallelFor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSpectrogramBaker, Log, All);
+
+namespace
+{
+	/** Frames a worker pushes through the FFT together, so their channels share SIMD lanes */
+	const int32 FramesPerBatch = 4;
+	/** Frames a worker takes at a time; fixed, so the batches, and with them the results, do not depend on the number of workers */
+	const int32 SegmentFrames = 64 * FramesPerBatch;
+
+	/** Where the frames of a sound lie */
+	struct FBakePlan
+	{
+		uint32 SampleRate;
+		uint32 NumChannels;
+		int32 WindowFrames;
+		int32 FFTSize;
+		int32 HopFrames;
+		/** Source frame just past the FFT window of the first frame */
+		int64 FirstEndFrame;
+		int32 NumFrames;
+		int32 AmplitudeOffset;
+		int32 HeardBeforeEnd;
+	};
+
+	/** Where the frames of Source analyzed with Settings lie. False if there are none, or too many to count in an int32. */
+	bool MakePlan(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, FBakePlan& Plan)
+	{
+		Plan.SampleRate = Source.SampleRate;
+		Plan.NumChannels = Source.NumChannels;
+		Plan.WindowFrames = Settings.GetWindowFrames(Source.SampleRate);
+		Plan.FFTSize = Settings.GetFFTSize(Source.SampleRate);
+		Plan.HopFrames = Settings.GetHopFrames(Source.SampleRate);
+		if (Source.Samples == nullptr || Plan.NumChannels == 0 || Plan.WindowFrames <= 0)
+		{
+			return false;
+		}
+		// The hops FSTFTStream would analyze if it was handed the whole sound at once
+		Plan.FirstEndFrame = (int64)((Plan.FFTSize + Plan.HopFrames - 1) / Plan.HopFrames) * Plan.HopFrames;
+		const int64 NumFrames = Source.NumFrames >= Plan.FirstEndFrame ? (Source.NumFrames - Plan.FirstEndFrame) / Plan.HopFrames + 1 : 0;
+		if (NumFrames == 0 || NumFrames > MAX_int32)
+		{
+			// Shorter than one FFT window: a bake without frames would only hide the live analysis
+			return false;
+		}
+		Plan.NumFrames = (int32)NumFrames;
+		Plan.AmplitudeOffset = (Plan.FFTSize - Plan.WindowFrames) - (Plan.FFTSize - Plan.WindowFrames) / 2;
+		Plan.HeardBeforeEnd = (Plan.FFTSize - Plan.WindowFrames) / 2;
+		return true;
+	}
+
+	/** Frames with the channels and widths of Plan analyzed with Settings, and no frames yet */
+	void InitFrames(const FSpectrumAnalysisSettings& Settings, const FBakePlan& Plan, FSpectrogramFrames& Frames)
+	{
+		Frames.NumChannels = Plan.NumChannels;
+		Frames.SampleRate = Plan.SampleRate;
+		Frames.SpectrumWidth = FMath::Max(Settings.SpectrumWidth, 0);
+		Frames.AmplitudeBuckets = FMath::Max(Settings.AmplitudeBuckets, 0);
+		Frames.Times.Reset();
+		Frames.Spectra.Reset();
+		Frames.Amplitudes.Reset();
+	}
+
+	/** One worker's engines and scratch, one of each per frame of a batch, and the segment it analyzed last */
+	struct FBakeWorker
+	{
+		FSpectrumAnalysisEngine Engines[FramesPerBatch];
+		TArray<float> Windows[FramesPerBatch];
+		FSpectrumAnalysisResult Results[FramesPerBatch];
+		FSpectrogramFrames Segment;
+
+		FBakeWorker()
+		{
+			for (int32 Index = 0; Index < FramesPerBatch; ++Index)
+			{
+				Engines[Index].SetFixedPoint(false);
+			}
+		}
+	};
+
+	/** Analyzes NumFrames frames from FirstFrame into Worker.Segment */
+	bool AnalyzeSegment(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, const FBakePlan& Plan, int32 FirstFrame, int32 NumFrames, FBakeWorker& Worker)
+	{
+		FSpectrogramFrames& Out = Worker.Segment;
+		InitFrames(Settings, Plan, Out);
+		const int32 SpectrumStride = Out.GetSpectrumStride();
+		const int32 AmplitudeStride = Out.GetAmplitudeStride();
+		Out.Times.SetNumUninitialized(NumFrames);
+		Out.Spectra.SetNumUninitialized(NumFrames * SpectrumStride);
+		Out.Amplitudes.SetNumUninitialized(NumFrames * AmplitudeStride);
+
+		FSpectrumAnalysisEngine* Engines[FramesPerBatch];
+		for (int32 BatchStart = 0; BatchStart < NumFrames; BatchStart += FramesPerBatch)
+		{
+			const int32 BatchFrames = FMath::Min(FramesPerBatch, NumFrames - BatchStart);
+			for (int32 Index = 0; Index < BatchFrames; ++Index)
+			{
+				const int64 EndFrame = Plan.FirstEndFrame + (int64)(FirstFrame + BatchStart + Index) * Plan.HopFrames;
+				TArray<float>& Window = Worker.Windows[Index];
+				Window.SetNumUninitialized(Plan.FFTSize * Plan.NumChannels);
+				AudioConversion::DeinterleaveToFloat(Source.Samples + (EndFrame - Plan.FFTSize) * Plan.NumChannels, Plan.NumChannels, Plan.FFTSize, Window.GetData(), Plan.FFTSize);
+				if (!Worker.Engines[Index].BeginAnalyze(Settings, Window.GetData(), Plan.NumChannels, Plan.SampleRate, Plan.AmplitudeOffset, Worker.Results[Index]))
+				{
+					return false;
+				}
+				Engines[Index] = &Worker.Engines[Index];
+				Out.Times[BatchStart + Index] = (EndFrame - Plan.HeardBeforeEnd) * ETimespan::TicksPerSecond / Plan.SampleRate;
+			}
+			FSpectrumAnalysisEngine::TransformPending(Engines, BatchFrames);
+			for (int32 Index = 0; Index < BatchFrames; ++Index)
+			{
+				FSpectrumAnalysisResult& Result = Worker.Results[Index];
+				Worker.Engines[Index].EndAnalyze(Result);
+				FMemory::Memcpy(Out.Spectra.GetData() + (BatchStart + Index) * SpectrumStride, Result.Spectrum.GetData(), SpectrumStride * sizeof(float));
+				FMemory::Memcpy(Out.Amplitudes.GetData() + (BatchStart + Index) * AmplitudeStride, Result.Amplitude.GetData(), AmplitudeStride * sizeof(float));
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Analyzes every segment of Plan on NumWorkers threads, or GetMaxWorkers() if 0, handing each to
+	 * Consume(FirstFrame, Segment) on the worker that analyzed it, in no particular order. Stops at the
+	 * first segment that fails or that Consume returns false for.
+	 */
+	template <typename ConsumerType>
+	bool AnalyzeSegments(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, const FBakePlan& Plan, int32 NumWorkers, ConsumerType Consume)
+	{
+		const int32 NumSegments = (Plan.NumFrames + SegmentFrames - 1) / SegmentFrames;
+		NumWorkers = FMath::Clamp(NumWorkers > 0 ? NumWorkers : SpectrogramBaker::GetMaxWorkers(), 1, FMath::Max(NumSegments, 1));
+		TArray<FBakeWorker> Workers;
+		Workers.SetNum(NumWorkers);
+		volatile int32 NextSegment = 0;
+		volatile int32 bFailed = 0;
+
+		// Segments cost the same, so workers taking the next one as they finish stay evenly loaded
+		ParallelFor(NumWorkers, [&](int32 WorkerIndex)
+		{
+			FBakeWorker& Worker = Workers[WorkerIndex];
+			for (int32 Segment = FPlatformAtomics::InterlockedIncrement(&NextSegment) - 1; Segment < NumSegments && !bFailed; Segment = FPlatformAtomics::InterlockedIncrement(&NextSegment) - 1)
+			{
+				const int32 FirstFrame = Segment * SegmentFrames;
+				if (!AnalyzeSegment(Settings, Source, Plan, FirstFrame, FMath::Min(SegmentFrames, Plan.NumFrames - FirstFrame), Worker)
+					|| !Consume(FirstFrame, Worker.Segment))
+				{
+					FPlatformAtomics::InterlockedExchange(&bFailed, 1);
+				}
+			}
+		}, NumWorkers == 1);
+		return !bFailed;
+	}
+
+	/** The loudest sample of Source, as a magnitude */
+	int32 GetPeakSample(const FBakeSource& Source)
+	{
+		int32 Peak = 0;
+		const int64 NumSamples = Source.NumFrames * Source.NumChannels;
+		for (int64 Index = 0; Index < NumSamples; ++Index)
+		{
+			Peak = FMath::Max(Peak, FMath::Abs((int32)Source.Samples[Index]));
+		}
+		return Peak;
+	}
+
+	bool BakeWave(const FSpectrumAnalysisSettings& Settings, const FWaveModInfo& WaveInfo, uint32 BytesPerValue, const FString& Path)
+	{
+		if (*WaveInfo.pFormatTag != 1 || *WaveInfo.pBitsPerSample != 16)
+		{
+			UE_LOG(LogSpectrogramBaker, Error, TEXT("Only 16 bit PCM can be baked into %s"), *Path);
+			return false;
+		}
+		FBakeSource Source;
+		Source.Samples = (const int16*)WaveInfo.SampleDataStart;
+		Source.NumChannels = *WaveInfo.pChannels;
+		Source.SampleRate = *WaveInfo.pSamplesPerSec;
+		Source.NumFrames = Source.NumChannels > 0 ? WaveInfo.SampleDataSize / (Source.NumChannels * sizeof(int16)) : 0;
+		return SpectrogramBaker::Bake(Settings, Source, BytesPerValue, Path);
+	}
+}
+
+int32 SpectrogramBaker::GetMaxWorkers()
+{
+	return FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+}
+
+bool SpectrogramBaker::Analyze(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, FSpectrogramFrames& OutFrames, int32 NumWorkers)
+{
+	FBakePlan Plan;
+	if (!MakePlan(Settings, Source, Plan))
+	{
+		return false;
+	}
+	InitFrames(Settings, Plan, OutFrames);
+	const int32 SpectrumStride = OutFrames.GetSpectrumStride();
+	const int32 AmplitudeStride = OutFrames.GetAmplitudeStride();
+	if ((int64)Plan.NumFrames * FMath::Max(SpectrumStride, AmplitudeStride) > MAX_int32)
+	{
+		// More values than a TArray holds; Bake streams sounds this long to disk instead
+		return false;
+	}
+	OutFrames.Times.SetNumUninitialized(Plan.NumFrames);
+	OutFrames.Spectra.SetNumUninitialized(Plan.NumFrames * SpectrumStride);
+	OutFrames.Amplitudes.SetNumUninitialized(Plan.NumFrames * AmplitudeStride);
+
+	return AnalyzeSegments(Settings, Source, Plan, NumWorkers, [&](int32 FirstFrame, const FSpectrogramFrames& Segment)
+	{
+		const int32 NumFrames = Segment.GetNumFrames();
+		FMemory::Memcpy(OutFrames.Times.GetData() + FirstFrame, Segment.Times.GetData(), NumFrames * sizeof(int64));
+		FMemory::Memcpy(OutFrames.Spectra.GetData() + (int64)FirstFrame * SpectrumStride, Segment.Spectra.GetData(), (SIZE_T)NumFrames * SpectrumStride * sizeof(float));
+		FMemory::Memcpy(OutFrames.Amplitudes.GetData() + (int64)FirstFrame * AmplitudeStride, Segment.Amplitudes.GetData(), (SIZE_T)NumFrames * AmplitudeStride * sizeof(float));
+		return true;
+	});
+}
+
+bool SpectrogramBaker::Bake(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, uint32 BytesPerValue, const FString& Path, int32 NumWorkers)
+{
+	FBakePlan Plan;
+	if (!MakePlan(Settings, Source, Plan))
+	{
+		UE_LOG(LogSpectrogramBaker, Error, TEXT("Nothing to bake into %s"), *Path);
+		return false;
+	}
+	NumWorkers = NumWorkers > 0 ? NumWorkers : GetMaxWorkers();
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	// Segments are quantized as they finish, so the levels have to be known before any is analyzed
+	FSpectrogramFrames Layout;
+	InitFrames(Settings, Plan, Layout);
+	FBakedSpectrogramWriter Writer;
+	if (!Writer.Open(Settings, Layout, Plan.NumFrames, BytesPerValue, FSpectrogramLevels::ForPeakSample(GetPeakSample(Source)), Path))
+	{
+		return false;
+	}
+	const bool bAnalyzed = AnalyzeSegments(Settings, Source, Plan, NumWorkers, [&](int32 FirstFrame, const FSpectrogramFrames& Segment)
+	{
+		return Writer.Write(FirstFrame, Segment);
+	});
+	if (!Writer.Close() || !bAnalyzed)
+	{
+		return false;
+	}
+	const double AudioSeconds = (double)Source.NumFrames / Source.SampleRate;
+	const double BakeSeconds = FMath::Max(FPlatformTime::Seconds() - StartSeconds, 1e-6);
+	UE_LOG(LogSpectrogramBaker, Log, TEXT("Baked %.1f s of audio into %s in %.2f s on %d workers: %.0f s of audio per second"),
+		AudioSeconds, *Path, BakeSeconds, NumWorkers, AudioSeconds / BakeSeconds);
+	return true;
+}
+
+bool SpectrogramBaker::BakeSoundWave(const FSpectrumAnalysisSettings& Settings, USoundWave* SoundWave, uint32 BytesPerValue, const FString& Path)
+{
+	if (SoundWave == nullptr)
+	{
+		return false;
+	}
+#if WITH_EDITORONLY_DATA
+	const int32 RawDataSize = SoundWave->RawData.GetBulkDataSize();
+	if (RawDataSize > 0)
+	{
+		const uint8* RawData = (const uint8*)SoundWave->RawData.LockReadOnly();
+		FWaveModInfo WaveInfo;
+		const bool bBaked = WaveInfo.ReadWaveInfo(const_cast<uint8*>(RawData), RawDataSize) && BakeWave(Settings, WaveInfo, BytesPerValue, Path);
+		SoundWave->RawData.Unlock();
+		return bBaked;
+	}
+#endif
+	if (SoundWave->RawPCMData == nullptr || SoundWave->RawPCMDataSize <= 0 || SoundWave->NumChannels <= 0)
+	{
+		UE_LOG(LogSpectrogramBaker, Error, TEXT("%s has no PCM to bake"), *SoundWave->GetName());
+		return false;
+	}
+	FBakeSource Source;
+	Source.Samples = (const int16*)SoundWave->RawPCMData;
+	Source.NumChannels = SoundWave->NumChannels;
+	Source.SampleRate = SoundWave->SampleRate;
+	Source.NumFrames = SoundWave->RawPCMDataSize / (SoundWave->NumChannels * sizeof(int16));
+	return Bake(Settings, Source, BytesPerValue, Path);
+}
+
+bool SpectrogramBaker::BakeWaveFile(const FSpectrumAnalysisSettings& Settings, const FString& WavePath, uint32 BytesPerValue, const FString& Path)
+{
+	TArray<uint8> Wave;
+	if (!FFileHelper::LoadFileToArray(Wave, *WavePath))
+	{
+		return false;
+	}
+	FWaveModInfo WaveInfo;
+	FString Error;
+	if (!WaveInfo.ReadWaveInfo(Wave.GetData(), Wave.Num(), &Error))
+	{
+		UE_LOG(LogSpectrogramBaker, Error, TEXT("Only WAV files can be baked; %s: %s"), *WavePath, *Error);
+		return false;
+	}
+	return BakeWave(Settings, WaveInfo, BytesPerValue, Path);
+}
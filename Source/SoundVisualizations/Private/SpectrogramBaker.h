@@ -0,0 +1,60 @@
+#pragma once
+
+#include "BakedSpectrogram.h"
+
+/** 16 bit interleaved PCM to bake */
+struct FBakeSource
+{
+	const int16* Samples;
+	uint32 NumChannels;
+	uint32 SampleRate;
+	/** Frames of NumChannels samples */
+	int64 NumFrames;
+
+	FBakeSource()
+		: Samples(nullptr)
+		, NumChannels(0)
+		, SampleRate(0)
+		, NumFrames(0)
+	{
+	}
+};
+
+/**
+ * Analyzes whole sounds ahead of time into baked spectrograms.
+ *
+ * Frames are analyzed exactly as FSTFTStream analyzes a stream: frame k is the FFT window ending at
+ * frame k * Hop of the sound, stamped with the time heard at the end of its nominal window. Always
+ * transforms in float, whatever the platform default.
+ *
+ * The frames are split into segments of a fixed number of hops. Each segment reads the audio its
+ * windows overlap straight from the source, so segments are independent and are analyzed on every
+ * core at once, each worker with its own engines and scratch. A segment's frames land at their own
+ * place in the output, and every frame is computed the same way whichever worker takes it, so the
+ * result is bit for bit the same however many workers run.
+ */
+namespace SpectrogramBaker
+{
+	/** Workers Analyze runs on when not told otherwise: one per task graph worker, plus the calling thread */
+	int32 GetMaxWorkers();
+
+	/**
+	 * Analyzes every hop of Source with Settings into OutFrames on NumWorkers threads, or GetMaxWorkers()
+	 * if 0. Returns false if Settings give no window, Source is shorter than one FFT window, or the
+	 * frames hold more values than an array can.
+	 */
+	bool Analyze(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, FSpectrogramFrames& OutFrames, int32 NumWorkers = 0);
+
+	/**
+	 * Analyzes Source and saves it at Path with BytesPerValue bytes per value. Each segment is
+	 * quantized and written as it is analyzed, between levels fixed by the loudest sample of Source,
+	 * so only the segments in flight are ever held in memory. Runs on NumWorkers threads as Analyze does.
+	 */
+	bool Bake(const FSpectrumAnalysisSettings& Settings, const FBakeSource& Source, uint32 BytesPerValue, const FString& Path, int32 NumWorkers = 0);
+
+	/** Bake for the PCM of SoundWave: its source WAV in the editor, its decompressed PCM elsewhere. */
+	bool BakeSoundWave(const FSpectrumAnalysisSettings& Settings, USoundWave* SoundWave, uint32 BytesPerValue, const FString& Path);
+
+	/** Bake for the 16 bit PCM WAV file at WavePath. */
+	bool BakeWaveFile(const FSpectrumAnalysisSettings& Settings, const FString& WavePath, uint32 BytesPerValue, const FString& Path);
+}
@@ -0,0 +1,118 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "SpectrogramHistory.h"
+
+FSpectrogram::FSpectrogram(uint32 InNumChannels, int32 InSpectrumWidth, int32 InCapacity)
+	: NumChannels(InNumChannels)
+	, SpectrumWidth(InSpectrumWidth)
+	, Capacity(InCapacity)
+	, RowStride((InNumChannels + 1) * InSpectrumWidth)
+	, WriteCursor(0)
+	, ReserveCursor(0)
+{
+	Rows.AddZeroed(Capacity * RowStride);
+	Times.AddZeroed(Capacity);
+}
+
+void FSpectrogram::Push(const FSpectrumAnalysisResult& Frame)
+{
+	const int64 Row = WriteCursor;
+	const int32 Slot = (int32)(Row % Capacity);
+	FPlatformAtomics::InterlockedExchange(&ReserveCursor, Row + 1);
+	FMemory::Memcpy(Rows.GetData() + Slot * RowStride, Frame.Spectrum.GetData(), sizeof(float) * FMath::Min(RowStride, Frame.Spectrum.Num()));
+	Times[Slot] = Frame.Time.GetTicks();
+	FPlatformAtomics::InterlockedExchange(&WriteCursor, Row + 1);
+}
+
+bool FSpectrogram::GetNewestTime(FTimespan& OutTime) const
+{
+	// Only used by the producer, so the newest row cannot change underneath us
+	const int64 Written = AtomicRead(&WriteCursor);
+	if (Written == 0)
+	{
+		return false;
+	}
+	OutTime = FTimespan(Times[(int32)((Written - 1) % Capacity)]);
+	return true;
+}
+
+int32 FSpectrogram::CopyFrames(int32 Channel, FTimespan StartTime, FTimespan EndTime, int32 MaxFrames, float* Out) const
+{
+	if (Channel < 0 || Channel > (int32)NumChannels || MaxFrames <= 0)
+	{
+		return 0;
+	}
+	const int64 StartTicks = StartTime.GetTicks();
+	const int64 EndTicks = EndTime.GetTicks();
+
+	// Retry a few times if the producer laps us; it only does that when the reader is very slow
+	for (int32 Attempt = 0; Attempt < 3; ++Attempt)
+	{
+		const int64 Written = AtomicRead(&WriteCursor);
+		const int64 Oldest = FMath::Max<int64>(0, Written - Capacity);
+
+		int64 Last = Written - 1;
+		while (Last >= Oldest && Times[(int32)(Last % Capacity)] > EndTicks)
+		{
+			--Last;
+		}
+		int64 First = Last + 1;
+		while (First > Oldest && Last + 1 - First < MaxFrames && Times[(int32)((First - 1) % Capacity)] >= StartTicks)
+		{
+			--First;
+		}
+
+		for (int64 Row = First; Row <= Last; ++Row)
+		{
+			const float* Source = Rows.GetData() + (int32)(Row % Capacity) * RowStride + Channel * SpectrumWidth;
+			FMemory::Memcpy(Out + (Row - First) * SpectrumWidth, Source, sizeof(float) * SpectrumWidth);
+		}
+
+		// Nothing from First on was overwritten while we looked
+		if (AtomicRead(&ReserveCursor) <= First + Capacity)
+		{
+			return (int32)(Last + 1 - First);
+		}
+	}
+	return 0;
+}
+
+FSpectrogramHistory::FSpectrogramHistory()
+	: Capacity(0)
+{
+}
+
+void FSpectrogramHistory::Push(const FSpectrumAnalysisResult& Frame)
+{
+	const int32 CurrentCapacity = Capacity;
+	FScopeLock ScopeLock(&Lock);
+	if (CurrentCapacity <= 0 || Frame.SpectrumWidth <= 0 || Frame.NumChannels == 0)
+	{
+		Current.Reset();
+		return;
+	}
+
+	bool bStartOver = !Current.IsValid() || Current->GetCapacity() != CurrentCapacity
+		|| Current->GetNumChannels() != Frame.NumChannels || Current->GetSpectrumWidth() != Frame.SpectrumWidth;
+	FTimespan NewestTime;
+	if (!bStartOver && Current->GetNewestTime(NewestTime))
+	{
+		if (Frame.Time == NewestTime)
+		{
+			// Already recorded
+			return;
+		}
+		bStartOver = Frame.Time < NewestTime;
+	}
+	if (bStartOver)
+	{
+		// Readers holding the old spectrogram keep it alive until they are done with it
+		Current = MakeShareable(new FSpectrogram(Frame.NumChannels, Frame.SpectrumWidth, CurrentCapacity));
+	}
+	Current->Push(Frame);
+}
+
+TSharedPtr<const FSpectrogram, ESPMode::ThreadSafe> FSpectrogramHistory::Get() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Current;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+
+/**
+ * Fixed-shape ring of recent spectra, frames by bands in one contiguous block.
+ *
+ * Each row holds the NumChannels + 1 spectrum runs of one FSpectrumAnalysisResult. Like
+ * FAudioRingBuffer there is one producer, which never waits, and readers, which copy rows out
+ * and then check the producer did not lap them while they were copying.
+ */
+class FSpectrogram
+{
+public:
+	FSpectrogram(uint32 InNumChannels, int32 InSpectrumWidth, int32 InCapacity);
+
+	uint32 GetNumChannels() const { return NumChannels; }
+	int32 GetSpectrumWidth() const { return SpectrumWidth; }
+	int32 GetCapacity() const { return Capacity; }
+
+	/** Appends Frame's spectra. Producer only. */
+	void Push(const FSpectrumAnalysisResult& Frame);
+
+	/** Time of the newest frame, or false if there is none. */
+	bool GetNewestTime(FTimespan& OutTime) const;
+
+	/**
+	 * Copies the spectrum of Channel for up to MaxFrames of the most recent frames heard in
+	 * [StartTime, EndTime], oldest first, each SpectrumWidth floats after the previous one.
+	 * Out must have room for MaxFrames rows. Returns the number of frames copied.
+	 */
+	int32 CopyFrames(int32 Channel, FTimespan StartTime, FTimespan EndTime, int32 MaxFrames, float* Out) const;
+
+private:
+	FSpectrogram(const FSpectrogram&);
+	FSpectrogram& operator=(const FSpectrogram&);
+
+	static int64 AtomicRead(volatile const int64* Src)
+	{
+		return FPlatformAtomics::InterlockedCompareExchange(const_cast<volatile int64*>(Src), 0, 0);
+	}
+
+	uint32 NumChannels;
+	int32 SpectrumWidth;
+	int32 Capacity;
+	int32 RowStride;
+	/** Capacity rows of RowStride floats */
+	TArray<float> Rows;
+	/** Frame times in ticks, one per row */
+	TArray<int64> Times;
+
+	/** Rows visible to readers */
+	volatile int64 WriteCursor;
+	/** Rows the producer has started writing */
+	volatile int64 ReserveCursor;
+};
+
+/**
+ * The spectrogram of one FSharedSpectrumAnalysis. Pushing a frame whose shape differs from the current
+ * spectrogram, or that is older than its newest frame, as after a seek, starts a new one.
+ */
+class FSpectrogramHistory
+{
+public:
+	FSpectrogramHistory();
+
+	/** Frames to keep; 0 turns recording off. Takes effect at the next push. */
+	void SetCapacity(int32 InCapacity) { FPlatformAtomics::InterlockedExchange(&Capacity, InCapacity); }
+
+	/** Records Frame. Safe to call from any thread, though only one thread at a time is expected to. */
+	void Push(const FSpectrumAnalysisResult& Frame);
+
+	/** The spectrogram being recorded into, if any. */
+	TSharedPtr<const FSpectrogram, ESPMode::ThreadSafe> Get() const;
+
+private:
+	volatile int32 Capacity;
+	/** Serializes producers and guards swapping in a new spectrogram */
+	mutable FCriticalSection Lock;
+	TSharedPtr<FSpectrogram, ESPMode::ThreadSafe> Current;
+};
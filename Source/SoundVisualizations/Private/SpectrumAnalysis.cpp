@@ -0,0 +1,301 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "SpectrumAnalysis.h"
+#include "WindowFunctions.h"
+#include "AudioConversion.h"
+
+int32 FSpectrumAnalysisResult::CopyValues(const float* Source, int32 Num, TArrayView<float> Out)
+{
+	const int32 NumCopied = FMath::Min(Num, Out.Num());
+	FMemory::Memcpy(Out.GetData(), Source, NumCopied * sizeof(float));
+	FMemory::Memzero(Out.GetData() + NumCopied, (Out.Num() - NumCopied) * sizeof(float));
+	return Num;
+}
+
+FSpectrumAnalysisEngine::FSpectrumAnalysisEngine()
+	: bFixedPoint(!!SOUNDVIS_FIXED_POINT_FFT)
+	, PendingChannels(0)
+	, bPendingFixedPoint(false)
+	, bTransformPending(false)
+{
+}
+
+bool FSpectrumAnalysisEngine::FindWindow(const FSpectrumAnalysisSettings& Settings, const FAudioRingBuffer& Ring, FTimespan PlaybackTime, FSpectrumAnalysisWindow& OutWindow)
+{
+	const uint32 SampleRate = Ring.GetSampleRate();
+	const int32 WindowFrames = Settings.GetWindowFrames(SampleRate);
+	const int32 FramesToRead = Settings.GetFFTSize(SampleRate);
+	if (WindowFrames <= 0)
+	{
+		return false;
+	}
+
+	FTimespan CurrentTime;
+	const uint64 WriteFrame = Ring.GetWritePosition(CurrentTime);
+	//UE_LOG(LogSpectrumAnalyzer, Log, TEXT("PlaybackTime %f, CurrentTime %f"), PlaybackTime.GetTotalSeconds(), CurrentTime.GetTotalSeconds());
+
+	const int64 DeltaFrames = FMath::Max<int64>(0, (int64)((CurrentTime - PlaybackTime).GetTotalSeconds() * SampleRate));
+	const int64 PlaybackFrame = (int64)WriteFrame - DeltaFrames;
+	const int64 EndFrame = FMath::Min<int64>(PlaybackFrame + (FramesToRead - WindowFrames) / 2, WriteFrame);
+	if (EndFrame < FramesToRead)
+	{
+		// If we get to this point we can't create a reasonable window so just give up
+		return false;
+	}
+	OutWindow.EndFrame = EndFrame;
+	OutWindow.AmplitudeOffset = (int32)((PlaybackFrame - WindowFrames) - (EndFrame - FramesToRead));
+	return true;
+}
+
+bool FSpectrumAnalysisEngine::AnalyzeWindow(const FSpectrumAnalysisSettings& Settings, FAudioRingBuffer& Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out)
+{
+	if (!BeginAnalyzeWindow(Settings, Ring, Window, PlaybackTime, Out))
+	{
+		return false;
+	}
+	FSpectrumAnalysisEngine* Engine = this;
+	TransformPending(&Engine, 1);
+	EndAnalyze(Out);
+	return true;
+}
+
+bool FSpectrumAnalysisEngine::BeginAnalyzeWindow(const FSpectrumAnalysisSettings& Settings, FAudioRingBuffer& Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out)
+{
+	const uint32 NumChannels = Ring.GetNumChannels();
+	const int32 FramesToRead = Settings.GetFFTSize(Ring.GetSampleRate());
+	WindowSamples.SetNumUninitialized(FramesToRead * NumChannels);
+	if (!Ring.ReadFrames(Window.EndFrame, FramesToRead, WindowSamples.GetData(), FramesToRead))
+	{
+		return false;
+	}
+	Ring.SetReadCursor(Window.EndFrame);
+
+	if (!BeginAnalyze(Settings, WindowSamples.GetData(), NumChannels, Ring.GetSampleRate(), Window.AmplitudeOffset, Out))
+	{
+		return false;
+	}
+	Out.Time = PlaybackTime;
+	return true;
+}
+
+bool FSpectrumAnalysisEngine::Analyze(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out)
+{
+	if (!BeginAnalyze(Settings, Samples, NumChannels, SampleRate, AmplitudeOffset, Out))
+	{
+		return false;
+	}
+	FSpectrumAnalysisEngine* Engine = this;
+	TransformPending(&Engine, 1);
+	EndAnalyze(Out);
+	return true;
+}
+
+bool FSpectrumAnalysisEngine::BeginAnalyze(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out)
+{
+	PendingPlan.Reset();
+	PendingBandMap.Reset();
+	bTransformPending = false;
+	if (NumChannels == 0 || SampleRate == 0 || Settings.GetWindowFrames(SampleRate) <= 0)
+	{
+		return false;
+	}
+
+	Out.NumChannels = NumChannels;
+	Out.SpectrumWidth = FMath::Max(Settings.SpectrumWidth, 0);
+	Out.AmplitudeBuckets = FMath::Max(Settings.AmplitudeBuckets, 0);
+	Out.Spectrum.Reset();
+	Out.Spectrum.AddZeroed(Out.SpectrumWidth * (NumChannels + 1));
+	Out.Amplitude.Reset();
+	Out.Amplitude.AddZeroed(Out.AmplitudeBuckets * (NumChannels + 1));
+
+	if (!BeginSpectrum(Settings, Samples, NumChannels, SampleRate, Out))
+	{
+		return false;
+	}
+	AnalyzeAmplitude(Settings, Samples, NumChannels, SampleRate, AmplitudeOffset, Out);
+	return true;
+}
+
+bool FSpectrumAnalysisEngine::BeginSpectrum(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, FSpectrumAnalysisResult& Out)
+{
+	if (Out.SpectrumWidth == 0)
+	{
+		return true;
+	}
+	const int32 SamplesToRead = Settings.GetFFTSize(SampleRate);
+
+	// The input is purely real, so a packed real transform gives the bins we need at half the cost
+	FFFTPlanPtr Plan = FFFTPlanRegistry::Get().FindOrCreate(SamplesToRead, false, true);
+	if (!Plan.IsValid())
+	{
+		return false;
+	}
+
+	FWindowTablePtr Window = FWindowTableCache::Get().FindOrCreate(Settings.WindowType, SamplesToRead);
+	if (!Window.IsValid())
+	{
+		return false;
+	}
+
+	FBandMapSettings BandSettings;
+	BandSettings.FFTSize = SamplesToRead;
+	BandSettings.SampleRate = SampleRate;
+	BandSettings.NumBands = Out.SpectrumWidth;
+	BandSettings.Scale = Settings.BandScale;
+	BandSettings.OctaveFraction = Settings.OctaveFraction;
+	BandSettings.MinFrequency = Settings.MinFrequency;
+	FBandMapPtr BandMap = FBandMapCache::Get().FindOrCreate(BandSettings);
+	if (!BandMap.IsValid())
+	{
+		return false;
+	}
+
+	// Every channel of the window goes through each stage as one batch, channel after channel in
+	// contiguous buffers, so the window table, twiddles and band weights stay hot across channels
+	if (bFixedPoint)
+	{
+		FixedInput.SetNumUninitialized(SamplesToRead * NumChannels);
+		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+		{
+			AudioConversion::ApplyWindowQ15(Samples + ChannelIndex * SamplesToRead, Window->GetFixedData(), FixedInput.GetData() + ChannelIndex * SamplesToRead, SamplesToRead);
+		}
+		FixedOutput.SetNumUninitialized((SamplesToRead / 2 + 1) * NumChannels);
+	}
+	else
+	{
+		FFTInput.SetNumUninitialized(SamplesToRead * NumChannels);
+		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+		{
+			AudioConversion::ApplyWindow(Samples + ChannelIndex * SamplesToRead, Window->GetData(), FFTInput.GetData() + ChannelIndex * SamplesToRead, SamplesToRead);
+		}
+		FFTOutput.SetNumUninitialized((SamplesToRead / 2 + 1) * 2 * NumChannels);
+	}
+
+	PendingPlan = Plan;
+	PendingBandMap = BandMap;
+	PendingChannels = NumChannels;
+	bPendingFixedPoint = bFixedPoint;
+	bTransformPending = true;
+	return true;
+}
+
+void FSpectrumAnalysisEngine::TransformPending(FSpectrumAnalysisEngine* const* Engines, int32 NumEngines)
+{
+	TArray<const float*, TInlineAllocator<16>> Inputs;
+	TArray<kiss_fft_cpx*, TInlineAllocator<16>> Outputs;
+	for (int32 LeadIndex = 0; LeadIndex < NumEngines; ++LeadIndex)
+	{
+		FSpectrumAnalysisEngine* Lead = Engines[LeadIndex];
+		if (!Lead->bTransformPending)
+		{
+			continue;
+		}
+		if (Lead->bPendingFixedPoint)
+		{
+			// No lane batching in fixed point; the channels go one by one
+			const FFFTPlan& FixedPlan = *Lead->PendingPlan;
+			const int32 NumBins = FixedPlan.GetSize() / 2 + 1;
+			Lead->FFTScratch.SetNumUninitialized(FixedPlan.GetRealScratchSize());
+			for (uint32 ChannelIndex = 0; ChannelIndex < Lead->PendingChannels; ++ChannelIndex)
+			{
+				FixedPlan.TransformRealFixed(Lead->FixedInput.GetData() + ChannelIndex * FixedPlan.GetSize(), Lead->FixedOutput.GetData() + ChannelIndex * NumBins, (kiss_fft_s16_cpx*)Lead->FFTScratch.GetData());
+			}
+			Lead->bTransformPending = false;
+			continue;
+		}
+
+		// Gather the channels of every engine with the same FFT size so they fill the SIMD lanes
+		const FFFTPlan& Plan = *Lead->PendingPlan;
+		const int32 Size = Plan.GetSize();
+		const int32 NumBins = Size / 2 + 1;
+		Inputs.Reset();
+		Outputs.Reset();
+		for (int32 EngineIndex = LeadIndex; EngineIndex < NumEngines; ++EngineIndex)
+		{
+			FSpectrumAnalysisEngine* Engine = Engines[EngineIndex];
+			if (!Engine->bTransformPending || Engine->bPendingFixedPoint || Engine->PendingPlan->GetSize() != Size)
+			{
+				continue;
+			}
+			for (uint32 ChannelIndex = 0; ChannelIndex < Engine->PendingChannels; ++ChannelIndex)
+			{
+				Inputs.Add(Engine->FFTInput.GetData() + ChannelIndex * Size);
+				Outputs.Add((kiss_fft_cpx*)Engine->FFTOutput.GetData() + ChannelIndex * NumBins);
+			}
+			Engine->bTransformPending = false;
+		}
+
+		Lead->FFTScratch.SetNumUninitialized(Plan.GetRealBatchScratchSize() * 2);
+		Plan.TransformRealBatch(Inputs.GetData(), Outputs.GetData(), Inputs.Num(), (kiss_fft_cpx*)Lead->FFTScratch.GetData());
+	}
+}
+
+void FSpectrumAnalysisEngine::EndAnalyze(FSpectrumAnalysisResult& Out)
+{
+	if (!PendingBandMap.IsValid())
+	{
+		return;
+	}
+	check(!bTransformPending);
+	const uint32 NumChannels = PendingChannels;
+	const int32 Size = PendingPlan->GetSize();
+	const int32 NumBins = Size / 2 + 1;
+	const kiss_fft_cpx* Bins = (const kiss_fft_cpx*)FFTOutput.GetData();
+	// Fixed point bins come out divided by the FFT size
+	const float FixedPowerScale = (float)Size * (float)Size;
+
+	float* MixPower = Out.Spectrum.GetData();
+	for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+	{
+		// Mix down in the power domain, then take one log per band
+		float* ChannelPower = Out.Spectrum.GetData() + (ChannelIndex + 1) * Out.SpectrumWidth;
+		if (bPendingFixedPoint)
+		{
+			PendingBandMap->AccumulatePowerFixed(FixedOutput.GetData() + ChannelIndex * NumBins, FixedPowerScale, ChannelPower);
+		}
+		else
+		{
+			PendingBandMap->AccumulatePower(Bins + ChannelIndex * NumBins, ChannelPower);
+		}
+		for (int32 BandIndex = 0; BandIndex < Out.SpectrumWidth; ++BandIndex)
+		{
+			MixPower[BandIndex] += ChannelPower[BandIndex];
+		}
+		FBandMap::PowerToDecibels(ChannelPower, Out.SpectrumWidth);
+	}
+	FBandMap::PowerToDecibels(MixPower, Out.SpectrumWidth, 1.f / NumChannels);
+
+	PendingPlan.Reset();
+	PendingBandMap.Reset();
+}
+
+void FSpectrumAnalysisEngine::AnalyzeAmplitude(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out)
+{
+	if (Out.AmplitudeBuckets == 0)
+	{
+		return;
+	}
+	const int32 WindowFrames = Settings.GetWindowFrames(SampleRate);
+	const int32 ChannelStride = Settings.GetFFTSize(SampleRate);
+
+	float* Mix = Out.Amplitude.GetData();
+	for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+	{
+		const float* Sampler = Samples + ChannelIndex * ChannelStride + AmplitudeOffset;
+		float* Amplitudes = Out.Amplitude.GetData() + (ChannelIndex + 1) * Out.AmplitudeBuckets;
+
+		int32 SamplesPerAmplitude = WindowFrames / Out.AmplitudeBuckets;
+		int32 ExcessSamples = WindowFrames % Out.AmplitudeBuckets;
+		for (int32 AmplitudeIndex = 0; AmplitudeIndex < Out.AmplitudeBuckets; ++AmplitudeIndex)
+		{
+			const int32 SamplesToRead = SamplesPerAmplitude + (ExcessSamples-- > 0 ? 1 : 0);
+			double SampleSum = 0;
+			for (int32 SampleIndex = 0; SampleIndex < SamplesToRead; ++SampleIndex)
+			{
+				SampleSum += FMath::Abs(Sampler[SampleIndex]);
+			}
+			Sampler += SamplesToRead;
+			Amplitudes[AmplitudeIndex] = SamplesToRead > 0 ? SampleSum / (float)SamplesToRead : 0.f;
+			Mix[AmplitudeIndex] += Amplitudes[AmplitudeIndex] / NumChannels;
+		}
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "SpectrumAnalyzer.h"
+#include "FFTPlanRegistry.h"
+#include "BandMapper.h"
+#include "AudioRingBuffer.h"
+
+/** Whether engines run their FFTs in 16 bit fixed point by default; float FFTs are the main per-frame cost on low end ARM cores */
+#ifndef SOUNDVIS_FIXED_POINT_FFT
+#define SOUNDVIS_FIXED_POINT_FFT PLATFORM_ANDROID
+#endif
+
+/** Everything about a USpectrumAnalyzer's configuration that affects its results */
+struct FSpectrumAnalysisSettings
+{
+	float WindowDurationInSeconds;
+	int32 SpectrumWidth;
+	int32 AmplitudeBuckets;
+	ESpectrumWindowType WindowType;
+	ESpectrumBandScale BandScale;
+	float MinFrequency;
+	int32 OctaveFraction;
+	/** Streaming hop as a fraction of the FFT size */
+	float HopFraction;
+	ESpectrumAnalysisBackend Backend;
+
+	bool operator==(const FSpectrumAnalysisSettings& Other) const
+	{
+		return WindowDurationInSeconds == Other.WindowDurationInSeconds && SpectrumWidth == Other.SpectrumWidth
+			&& AmplitudeBuckets == Other.AmplitudeBuckets && WindowType == Other.WindowType && BandScale == Other.BandScale
+			&& MinFrequency == Other.MinFrequency && OctaveFraction == Other.OctaveFraction && HopFraction == Other.HopFraction
+			&& Backend == Other.Backend;
+	}
+	bool operator!=(const FSpectrumAnalysisSettings& Other) const { return !(*this == Other); }
+
+	/** Frames in the nominal analysis window */
+	int32 GetWindowFrames(uint32 SampleRate) const { return (int32)(SampleRate * WindowDurationInSeconds); }
+	/** The window widened to a power of two for the FFT */
+	int32 GetFFTSize(uint32 SampleRate) const { return (int32)FMath::RoundUpToPowerOfTwo(FMath::Max(GetWindowFrames(SampleRate), 2)); }
+	/** Frames between the starts of consecutive streaming frames. HopFraction's ClampMin only binds in the editor, so Blueprints that set it lower are clamped here. */
+	int32 GetHopFrames(uint32 SampleRate) const { return FMath::Max(FMath::RoundToInt(GetFFTSize(SampleRate) * FMath::Clamp(HopFraction, 0.05f, 1.f)), 1); }
+};
+
+/**
+ * Spectra and amplitudes of every channel for one analysis window.
+ *
+ * Each array holds NumChannels + 1 runs laid out back to back: run 0 mixes all channels and run c
+ * holds channel c, matching the Channel argument of the Blueprint API. Every value is finite;
+ * silent bands read 0 dB rather than -inf.
+ */
+struct FSpectrumAnalysisResult
+{
+	uint32 NumChannels;
+	int32 SpectrumWidth;
+	int32 AmplitudeBuckets;
+	TArray<float> Spectrum;
+	TArray<float> Amplitude;
+	/** Playback time the window was analyzed for */
+	FTimespan Time;
+
+	FSpectrumAnalysisResult()
+		: NumChannels(0)
+		, SpectrumWidth(0)
+		, AmplitudeBuckets(0)
+		, Time(0)
+	{
+	}
+
+	const float* GetSpectrum(int32 Channel) const { return Spectrum.GetData() + Channel * SpectrumWidth; }
+	const float* GetAmplitude(int32 Channel) const { return Amplitude.GetData() + Channel * AmplitudeBuckets; }
+
+	/** Copies what fits of a channel's spectrum into Out, zeroes the rest of Out and returns SpectrumWidth */
+	int32 CopySpectrum(int32 Channel, TArrayView<float> Out) const { return CopyValues(GetSpectrum(Channel), SpectrumWidth, Out); }
+	/** Copies what fits of a channel's amplitudes into Out, zeroes the rest of Out and returns AmplitudeBuckets */
+	int32 CopyAmplitude(int32 Channel, TArrayView<float> Out) const { return CopyValues(GetAmplitude(Channel), AmplitudeBuckets, Out); }
+
+	/** Copies what fits of Num values into Out and zeroes the rest of it; returns Num */
+	static int32 CopyValues(const float* Source, int32 Num, TArrayView<float> Out);
+};
+
+/** The frames of an FAudioRingBuffer to analyze for one playback time */
+struct FSpectrumAnalysisWindow
+{
+	/** Frame just past the FFT window */
+	uint64 EndFrame;
+	/** Start of the nominal window within the FFT window */
+	int32 AmplitudeOffset;
+};
+
+/**
+ * Turns a planar window of audio into an FSpectrumAnalysisResult.
+ *
+ * Holds the window and FFT scratch buffers, so each thread analyzing audio needs its own engine.
+ * Analysis can also run in three steps, BeginAnalyze, TransformPending and EndAnalyze, which lets the
+ * FFTs of several engines with the same FFT size share SIMD batches.
+ */
+class FSpectrumAnalysisEngine
+{
+public:
+	FSpectrumAnalysisEngine();
+
+	/**
+	 * Picks the window heard at PlaybackTime. The decoder runs ahead of playback, so the nominal window
+	 * ends that far behind the newest frame in Ring; the FFT window is widened symmetrically around it.
+	 * Returns false until Ring holds enough audio.
+	 */
+	static bool FindWindow(const FSpectrumAnalysisSettings& Settings, const FAudioRingBuffer& Ring, FTimespan PlaybackTime, FSpectrumAnalysisWindow& OutWindow);
+
+	/** Copies Window out of Ring, marks it read and analyzes it. */
+	bool AnalyzeWindow(const FSpectrumAnalysisSettings& Settings, FAudioRingBuffer& Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out);
+
+	/**
+	 * Analyzes NumChannels runs of Settings.GetFFTSize(SampleRate) frames starting at Samples.
+	 * Amplitudes cover the Settings.GetWindowFrames(SampleRate) frames starting at AmplitudeOffset in each run.
+	 */
+	bool Analyze(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out);
+
+	/** First step of Analyze: windows every channel for the FFT and measures amplitudes. Samples are not needed afterwards. */
+	bool BeginAnalyze(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out);
+
+	/** First step of AnalyzeWindow */
+	bool BeginAnalyzeWindow(const FSpectrumAnalysisSettings& Settings, FAudioRingBuffer& Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out);
+
+	/** Runs the FFTs of every engine between BeginAnalyze and EndAnalyze, channels of all engines with the same FFT size together. */
+	static void TransformPending(FSpectrumAnalysisEngine* const* Engines, int32 NumEngines);
+
+	/** Last step: turns the transformed channels into the spectra of Out, which must be the result given to BeginAnalyze. */
+	void EndAnalyze(FSpectrumAnalysisResult& Out);
+
+	/**
+	 * Windows are quantized to Q15 and transformed in 16 bit fixed point rather than float. Bands within
+	 * 30 dB of full scale match float to about 0.1 dB; bands near 60 dB below it are off by 0.5 to 1 dB
+	 * on average, more at larger FFT sizes.
+	 */
+	bool IsFixedPoint() const { return bFixedPoint; }
+	void SetFixedPoint(bool bInFixedPoint) { bFixedPoint = bInFixedPoint; }
+
+private:
+	bool BeginSpectrum(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, FSpectrumAnalysisResult& Out);
+	void AnalyzeAmplitude(const FSpectrumAnalysisSettings& Settings, const float* Samples, uint32 NumChannels, uint32 SampleRate, int32 AmplitudeOffset, FSpectrumAnalysisResult& Out);
+
+	/** Planar copy of the window, one FFT-sized run per channel */
+	TArray<float> WindowSamples;
+	/** Real FFT buffers; complex values are stored as (r, i) float pairs */
+	TArray<float> FFTInput;
+	TArray<float> FFTOutput;
+	TArray<float> FFTScratch;
+	/** Fixed point versions of FFTInput and FFTOutput */
+	TArray<int16> FixedInput;
+	TArray<kiss_fft_s16_cpx> FixedOutput;
+	bool bFixedPoint;
+
+	/** State of an analysis between BeginAnalyze and EndAnalyze */
+	FFFTPlanPtr PendingPlan;
+	FBandMapPtr PendingBandMap;
+	uint32 PendingChannels;
+	bool bPendingFixedPoint;
+	bool bTransformPending;
+};
+
+/** A USpectrumAnalyzer's last analysis and the window and settings it was computed from */
+struct FSpectrumAnalysisCache
+{
+	FSpectrumAnalysisEngine Engine;
+	FSpectrumAnalysisResult Result;
+
+	bool bValid;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring;
+	uint64 EndFrame;
+	/** FVisualizerCapture::Sequence of the capture the spectra were mapped from; 0 if they came from our own FFT */
+	uint64 CaptureSequence;
+	/** Baked spectrogram the result was looked up in, EndFrame then being the frame's index; unset if it was analyzed */
+	TWeakPtr<FBakedSpectrogram, ESPMode::ThreadSafe> Baked;
+	FSpectrumAnalysisSettings Settings;
+
+	FSpectrumAnalysisCache()
+		: bValid(false)
+		, EndFrame(0)
+		, CaptureSequence(0)
+	{
+	}
+};
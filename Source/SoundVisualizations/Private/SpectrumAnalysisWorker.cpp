@@ -0,0 +1,262 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "SpectrumAnalysisWorker.h"
+
+FSpectrumAnalysisTask::FSpectrumAnalysisTask(const TSharedPtr<FSpectrogramHistory, ESPMode::ThreadSafe>& InSpectrogram)
+	: bHasPlayback(false)
+	, AnchorPlaybackTime(0)
+	, AnchorSeconds(0.0)
+	, bRegistered(0)
+	, bPending(0)
+	, bStreaming(0)
+	, bRunning(0)
+	, LastEndFrame(0)
+	, PendingEndFrame(0)
+	, LastStreamFrame(nullptr)
+	, LastStreamFrameTime(0)
+	, Spectrogram(InSpectrogram)
+{
+}
+
+void FSpectrumAnalysisTask::SetPlayback(const FSpectrumAnalysisSettings& InSettings, FTimespan PlaybackTime)
+{
+	FScopeLock ScopeLock(&Lock);
+	Settings = InSettings;
+	AnchorPlaybackTime = PlaybackTime;
+	AnchorSeconds = FPlatformTime::Seconds();
+	bHasPlayback = true;
+}
+
+void FSpectrumAnalysisTask::SetHistory(const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& InHistory)
+{
+	FScopeLock ScopeLock(&Lock);
+	History = InHistory;
+}
+
+void FSpectrumAnalysisTask::NotifyAudio()
+{
+	if (bRegistered)
+	{
+		FPlatformAtomics::InterlockedExchange(&bPending, 1);
+		FSpectrumAnalysisWorker::Get().Wake();
+	}
+	else if (bStreaming)
+	{
+		Run();
+	}
+}
+
+void FSpectrumAnalysisTask::Run()
+{
+	if (BeginRun())
+	{
+		FSpectrumAnalysisEngine* TaskEngine = &Engine;
+		FSpectrumAnalysisEngine::TransformPending(&TaskEngine, 1);
+		EndRun();
+	}
+}
+
+bool FSpectrumAnalysisTask::BeginRun()
+{
+	// The worker and an inline streaming call can overlap while the mode is being switched
+	if (FPlatformAtomics::InterlockedCompareExchange(&bRunning, 1, 0) != 0)
+	{
+		return false;
+	}
+
+	FSpectrumAnalysisSettings CurrentSettings;
+	FTimespan PlaybackTime;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring;
+	bool bHaveWork;
+	{
+		FScopeLock ScopeLock(&Lock);
+		bHaveWork = bHasPlayback && History.IsValid();
+		if (bHaveWork)
+		{
+			CurrentSettings = Settings;
+			Ring = History;
+			// Playback has moved on since the game thread last looked; the window is clamped to the audio we have
+			PlaybackTime = AnchorPlaybackTime + FTimespan::FromSeconds(FPlatformTime::Seconds() - AnchorSeconds);
+		}
+	}
+
+	if (bHaveWork)
+	{
+		if (bStreaming)
+		{
+			RunStreaming(CurrentSettings, Ring, PlaybackTime);
+		}
+		else
+		{
+			FSpectrumAnalysisWindow Window;
+			if (FSpectrumAnalysisEngine::FindWindow(CurrentSettings, *Ring, PlaybackTime, Window)
+				&& !(LastRing == Ring && LastEndFrame == Window.EndFrame && LastSettings == CurrentSettings)
+				&& Engine.BeginAnalyzeWindow(CurrentSettings, *Ring, Window, PlaybackTime, Results.GetWriteBuffer()))
+			{
+				PendingRing = Ring;
+				PendingEndFrame = Window.EndFrame;
+				PendingSettings = CurrentSettings;
+				return true;
+			}
+		}
+	}
+	FPlatformAtomics::InterlockedExchange(&bRunning, 0);
+	return false;
+}
+
+void FSpectrumAnalysisTask::EndRun()
+{
+	Engine.EndAnalyze(Results.GetWriteBuffer());
+	Spectrogram->Push(Results.GetWriteBuffer());
+	Results.Publish();
+	LastRing = PendingRing;
+	LastEndFrame = PendingEndFrame;
+	LastSettings = PendingSettings;
+	PendingRing.Reset();
+	FPlatformAtomics::InterlockedExchange(&bRunning, 0);
+}
+
+void FSpectrumAnalysisTask::RunStreaming(const FSpectrumAnalysisSettings& CurrentSettings, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& Ring, FTimespan PlaybackTime)
+{
+	if (LastRing != Ring || LastSettings != CurrentSettings)
+	{
+		LastRing = Ring;
+		LastSettings = CurrentSettings;
+		LastEndFrame = 0;
+		LastStreamFrame = nullptr;
+	}
+	const int32 NumNewFrames = FMath::Min(Stream.Process(CurrentSettings, Ring), Stream.GetNumFrames());
+	for (int32 Age = NumNewFrames - 1; Age >= 0; --Age)
+	{
+		Spectrogram->Push(Stream.GetFrame(Age));
+	}
+
+	const FSpectrumAnalysisResult* Frame = Stream.FindFrame(PlaybackTime);
+	if (Frame == nullptr || (Frame == LastStreamFrame && Frame->Time == LastStreamFrameTime))
+	{
+		return;
+	}
+	Results.GetWriteBuffer() = *Frame;
+	Results.Publish();
+	LastStreamFrame = Frame;
+	LastStreamFrameTime = Frame->Time;
+}
+
+FSpectrumAnalysisWorker& FSpectrumAnalysisWorker::Get()
+{
+	static FSpectrumAnalysisWorker Worker;
+	return Worker;
+}
+
+FSpectrumAnalysisWorker::FSpectrumAnalysisWorker()
+	: Thread(nullptr)
+	, WakeEvent(nullptr)
+	, bStopping(0)
+{
+}
+
+FSpectrumAnalysisWorker::~FSpectrumAnalysisWorker()
+{
+	Shutdown();
+}
+
+void FSpectrumAnalysisWorker::Register(const FSpectrumAnalysisTaskPtr& Task)
+{
+	if (!Task.IsValid() || Task->IsRegistered())
+	{
+		return;
+	}
+	FScopeLock ScopeLock(&TasksLock);
+	if (Thread == nullptr)
+	{
+		bStopping = 0;
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("SpectrumAnalysisWorker"), 0, TPri_BelowNormal);
+	}
+	Tasks.Add(Task);
+	FPlatformAtomics::InterlockedExchange(&Task->bRegistered, 1);
+}
+
+void FSpectrumAnalysisWorker::Unregister(const FSpectrumAnalysisTaskPtr& Task)
+{
+	if (!Task.IsValid() || !Task->IsRegistered())
+	{
+		return;
+	}
+	FScopeLock ScopeLock(&TasksLock);
+	Tasks.Remove(Task);
+	FPlatformAtomics::InterlockedExchange(&Task->bRegistered, 0);
+}
+
+void FSpectrumAnalysisWorker::Shutdown()
+{
+	if (Thread != nullptr)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = nullptr;
+	}
+
+	FScopeLock ScopeLock(&TasksLock);
+	for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+	{
+		FPlatformAtomics::InterlockedExchange(&Tasks[TaskIndex]->bRegistered, 0);
+	}
+	Tasks.Empty();
+}
+
+void FSpectrumAnalysisWorker::Wake()
+{
+	if (WakeEvent != nullptr)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+uint32 FSpectrumAnalysisWorker::Run()
+{
+	TArray<FSpectrumAnalysisTaskPtr> Pending;
+	TArray<FSpectrumAnalysisTaskPtr> Batched;
+	TArray<FSpectrumAnalysisEngine*> Engines;
+	while (!bStopping)
+	{
+		WakeEvent->Wait();
+
+		Pending.Reset();
+		{
+			FScopeLock ScopeLock(&TasksLock);
+			for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+			{
+				if (FPlatformAtomics::InterlockedExchange(&Tasks[TaskIndex]->bPending, 0))
+				{
+					Pending.Add(Tasks[TaskIndex]);
+				}
+			}
+		}
+		// Windows of every task first, then one pass of FFTs so tasks sharing an FFT size fill SIMD lanes together
+		Batched.Reset();
+		Engines.Reset();
+		for (int32 TaskIndex = 0; TaskIndex < Pending.Num() && !bStopping; ++TaskIndex)
+		{
+			if (Pending[TaskIndex]->BeginRun())
+			{
+				Batched.Add(Pending[TaskIndex]);
+				Engines.Add(&Pending[TaskIndex]->Engine);
+			}
+		}
+		FSpectrumAnalysisEngine::TransformPending(Engines.GetData(), Engines.Num());
+		for (int32 TaskIndex = 0; TaskIndex < Batched.Num(); ++TaskIndex)
+		{
+			Batched[TaskIndex]->EndRun();
+		}
+	}
+	return 0;
+}
+
+void FSpectrumAnalysisWorker::Stop()
+{
+	FPlatformAtomics::InterlockedExchange(&bStopping, 1);
+	Wake();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+#include "TripleBuffer.h"
+#include "STFTStream.h"
+#include "SpectrogramHistory.h"
+
+/**
+ * Analysis of one FSharedSpectrumAnalysis driven by incoming audio rather than by the game thread.
+ *
+ * The game thread tells the task where playback is and what to compute, the audio thread tells it
+ * when new audio arrives, and the task analyzes the window heard at the extrapolated playback
+ * position and publishes the result through a triple buffer. In streaming mode it instead runs an
+ * FSTFTStream over the new audio and publishes the frame matching playback. The work runs on the
+ * FSpectrumAnalysisWorker thread when the task is registered with it, otherwise streaming runs
+ * inline on the audio thread. Holds no reference to the analyzer itself, so it may outlive it.
+ */
+class FSpectrumAnalysisTask
+{
+public:
+	/** Every frame the task produces is also recorded in Spectrogram. */
+	explicit FSpectrumAnalysisTask(const TSharedPtr<FSpectrogramHistory, ESPMode::ThreadSafe>& InSpectrogram);
+
+	/** Game thread: the settings to analyze with and the playback position, sampled now. */
+	void SetPlayback(const FSpectrumAnalysisSettings& InSettings, FTimespan PlaybackTime);
+
+	/** Game thread: whether to run the STFT stream instead of analyzing single windows. */
+	void SetStreaming(bool bInStreaming) { FPlatformAtomics::InterlockedExchange(&bStreaming, bInStreaming ? 1 : 0); }
+
+	/** Audio thread: the ring that new audio is written to. */
+	void SetHistory(const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& InHistory);
+
+	/** Audio thread: new audio was written, so queue an analysis on the worker, or stream it now. */
+	void NotifyAudio();
+
+	/** Game thread: the latest published result. NumChannels is zero until the first one arrives. */
+	const FSpectrumAnalysisResult& GetLatestResult() { return Results.GetReadBuffer(); }
+
+	bool IsRegistered() const { return bRegistered != 0; }
+
+private:
+	friend class FSpectrumAnalysisWorker;
+
+	/** Analyzes whatever is new and publishes it. Does nothing if another thread is already running the task. */
+	void Run();
+
+	/**
+	 * Run split around the FFT so the worker can batch the FFTs of every task it runs. Returns true
+	 * if Engine was left waiting for FSpectrumAnalysisEngine::TransformPending, in which case EndRun
+	 * must follow; otherwise the run is already over.
+	 */
+	bool BeginRun();
+	void EndRun();
+	void RunStreaming(const FSpectrumAnalysisSettings& CurrentSettings, const TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe>& Ring, FTimespan PlaybackTime);
+
+	/** Guards everything set by SetPlayback and SetHistory */
+	FCriticalSection Lock;
+	FSpectrumAnalysisSettings Settings;
+	bool bHasPlayback;
+	FTimespan AnchorPlaybackTime;
+	double AnchorSeconds;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> History;
+
+	volatile int32 bRegistered;
+	volatile int32 bPending;
+	volatile int32 bStreaming;
+	volatile int32 bRunning;
+
+	/** Only touched inside Run */
+	FSpectrumAnalysisEngine Engine;
+	FSTFTStream Stream;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> LastRing;
+	uint64 LastEndFrame;
+	FSpectrumAnalysisSettings LastSettings;
+	/** Window being analyzed between BeginRun and EndRun */
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> PendingRing;
+	uint64 PendingEndFrame;
+	FSpectrumAnalysisSettings PendingSettings;
+	const FSpectrumAnalysisResult* LastStreamFrame;
+	FTimespan LastStreamFrameTime;
+
+	TTripleBuffer<FSpectrumAnalysisResult> Results;
+	TSharedPtr<FSpectrogramHistory, ESPMode::ThreadSafe> Spectrogram;
+};
+
+typedef TSharedPtr<FSpectrumAnalysisTask, ESPMode::ThreadSafe> FSpectrumAnalysisTaskPtr;
+
+/** The thread running every registered FSpectrumAnalysisTask. Started by the first registration. */
+class FSpectrumAnalysisWorker : public FRunnable
+{
+public:
+	static FSpectrumAnalysisWorker& Get();
+
+	void Register(const FSpectrumAnalysisTaskPtr& Task);
+	void Unregister(const FSpectrumAnalysisTaskPtr& Task);
+
+	/** Stops the thread and drops every task. */
+	void Shutdown();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	friend class FSpectrumAnalysisTask;
+
+	FSpectrumAnalysisWorker();
+	virtual ~FSpectrumAnalysisWorker();
+
+	void Wake();
+
+	FCriticalSection TasksLock;
+	TArray<FSpectrumAnalysisTaskPtr> Tasks;
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	volatile int32 bStopping;
+};
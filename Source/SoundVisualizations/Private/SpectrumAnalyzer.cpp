@@ -1,609 +1,452 @@
 #include "SoundVisualizationsNonEnginePrivatePCH.h"
 #include "SpectrumAnalyzer.h"
-#include "kiss_fft.h"
+#include "MediaAudioHub.h"
+#include "SpectrogramBaker.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogSpectrumAnalyzer, Log, All);
 
-// Hacks for android which has degenerate support for IMediaPlayer.
-// The Epic implementation AndroidMediaPlayer ultimately depends on the java MediaPlayer. 
-// Our workaround is to use the android Visualizer to
-// obtain 8-bit periodic samples.
-
-#if PLATFORM_ANDROID
-#include "Android/AndroidJNI.h"
-#include "Android/AndroidApplication.h"
-#include <android_native_app_glue.h>
-
-jmethodID USpectrumAnalyzer::CreateVisualizer = 0;
-jmethodID USpectrumAnalyzer::EnableVisualizer = 0;
-jclass USpectrumAnalyzer::VisualizerClass = 0;
-
-void USpectrumAnalyzer::InitMethodIds()
-{
-	if (CreateVisualizer == 0)
-	{
-		if (JNIEnv* Env = FAndroidApplication::GetJavaEnv())
-		{
-			jmethodID method = FJavaWrapper::FindStaticMethod(Env, FJavaWrapper::GameActivityClassID, "AndroidThunkJava_SoundVisualizationsNonEngineGetVisualizerClass", "()Ljava/lang/Class;", false);
-			VisualizerClass = (jclass)Env->CallStaticObjectMethod(FJavaWrapper::GameActivityClassID, method);
-			CreateVisualizer = FJavaWrapper::FindStaticMethod(Env, VisualizerClass, "createSoundVisualizer", "(JI)Lcom/soundVisualizationsNonEngine/SoundVisualizer;", false);
-			EnableVisualizer = FJavaWrapper::FindMethod(Env, VisualizerClass, "setEnabled", "(Z)V", false);
-		}
-	}
-}
-
-#endif
-
-
 USpectrumAnalyzer::USpectrumAnalyzer(const class FObjectInitializer& PCIP)
 	: Super(PCIP),
-	Sink(new SinkDelegate(this)),
-	CurSampleIndex(0),
-	CurrentTime(FTimespan(0)),
-	PlaybackTime(FTimespan(0)),
-	PCMData(nullptr),
 	WindowDurationInSeconds(0.03333f),
 	SpectrumWidth(10),
-	AmplitudeBuckets(10)
+	AmplitudeBuckets(10),
+	WindowType(ESpectrumWindowType::Hann),
+	BandScale(ESpectrumBandScale::Linear),
+	MinFrequency(20.f),
+	OctaveFraction(3),
+	bAnalyzeOnWorkerThread(false),
+	bStreamingAnalysis(false),
+	HopFraction(0.5f),
+	AnalysisBackend(ESpectrumAnalysisBackend::Native),
+	SpectrogramFrames(256),
+	AnalysisStaleness(0.f),
+	AnalysisCacheHits(0),
+	AnalysisCacheMisses(0),
+	CaptureCallbacksPerSecond(0.f),
+	CaptureBytesPerSecond(0.f),
+	PlaybackTime(FTimespan(0)),
+	HubSoundWave(nullptr)
 {
-#if PLATFORM_ANDROID
-	this->Visualizer = 0;
-#endif
 }
 
 void USpectrumAnalyzer::BeginDestroy()
 {
-	if (MediaPlayer != nullptr)
-	{
-		if (MediaPlayer->GetPlayer().IsValid())
-		{
-			MediaPlayer->GetPlayer()->GetOutput().SetAudioSink(nullptr);
-		}
-	}
+	ReleaseHub();
 	Super::BeginDestroy();
 }
 
-
-
-USpectrumAnalyzer::~USpectrumAnalyzer()
+FMediaAudioHub* USpectrumAnalyzer::AcquireHub()
 {
-	delete PCMData;
-}
-
-SinkDelegate::
-SinkDelegate(USpectrumAnalyzer *InAnalyzer) : Analyzer(InAnalyzer) {}
-
-void SinkDelegate::
-PlayAudioSink(const uint8* Buffer, uint32 BufferSize, FTimespan Time)
-{
-	USpectrumAnalyzer *U = (USpectrumAnalyzer*)Analyzer.Get();
-	uint32 NumSamples = BufferSize / (sizeof(uint16) * Channels);
-	FTimespan Duration = FTimespan::FromSeconds((double)NumSamples / (double)SampleRate);
-	if (U != nullptr)
+	if (Hub.IsValid() && Hub->GetMediaPlayer() != MediaPlayer)
 	{
-		UMediaSoundWave* SoundWave = GetSoundWave();
-		if (SoundWave != nullptr)
-		{
-			SoundWave->PlayAudioSink(Buffer, BufferSize, Time);
-		}
-		U->ProcessMediaSample(Channels, SampleRate, Buffer, BufferSize, Duration, Time);
+		ReleaseHub();
 	}
-}
-
-UMediaSoundWave*
-SinkDelegate::GetSoundWave()
-{
-#if PLATFORM_ANDROID
-	// no support for this on android yet
-#else
-	USpectrumAnalyzer* U = (USpectrumAnalyzer*)Analyzer.Get();
-	if (U != nullptr)
+	if (!Hub.IsValid() && MediaPlayer != nullptr)
 	{
-		return U->SoundWave;
+		Hub = FMediaAudioHub::FindOrCreate(MediaPlayer);
+		HubSoundWave = SoundWave;
+		Hub->AddSoundWave(HubSoundWave);
 	}
-#endif
-	return nullptr;
+	return Hub.Get();
 }
 
-void SinkDelegate::FlushAudioSink()
+FSharedSpectrumAnalysis* USpectrumAnalyzer::AcquireAnalysis()
 {
-	UMediaSoundWave* SoundWave = GetSoundWave();
-	if (SoundWave != nullptr) SoundWave->FlushAudioSink();
+	FMediaAudioHub* CurrentHub = AcquireHub();
+	if (CurrentHub == nullptr)
+	{
+		return nullptr;
+	}
+	FSharedSpectrumAnalysisKey Key;
+	Key.Settings = GetAnalysisSettings();
+	// Mapping a platform capture costs less than handing it to another thread, and a baked frame has
+	// nothing left to analyze
+	const FBakedSpectrogramPtr& Baked = CurrentHub->GetBakedSpectrogram();
+	const bool bGameThreadOnly = Key.Settings.Backend == ESpectrumAnalysisBackend::PlatformFFT || (Baked.IsValid() && Baked->Matches(Key.Settings));
+	Key.bWorkerThread = bAnalyzeOnWorkerThread && !bGameThreadOnly;
+	Key.bStreaming = bStreamingAnalysis && !bGameThreadOnly;
+	Key.SpectrogramFrames = SpectrogramFrames;
+	if (!Analysis.IsValid() || Analysis->GetKey() != Key)
+	{
+		// Drop ours first so an analysis nobody else uses is torn down before its replacement starts
+		Analysis.Reset();
+		Analysis = CurrentHub->FindOrAddAnalysis(Key);
+	}
+	return Analysis.Get();
 }
 
-bool SinkDelegate::InitializeAudioSink(uint32 InChannels, uint32 InSampleRate)
+void USpectrumAnalyzer::ReleaseHub()
 {
-	Channels = InChannels;
-	SampleRate = InSampleRate;
-	bool bSoundWaveResult = true;
-	UMediaSoundWave* SoundWave = GetSoundWave();
-	if (SoundWave != nullptr) {
-		bSoundWaveResult = SoundWave->InitializeAudioSink(InChannels, InSampleRate);
-	}
-#if PLATFORM_ANDROID	
-	USpectrumAnalyzer *U = (USpectrumAnalyzer*)Analyzer.Get();
-	USpectrumAnalyzer::InitMethodIds();
-	JNIEnv* Env = FAndroidApplication::GetJavaEnv();
-	jobject Obj = Env->CallStaticObjectMethod(U->VisualizerClass, USpectrumAnalyzer::CreateVisualizer, (jlong)U, (int32)SampleRate);
-	U->Visualizer = Env->NewGlobalRef(Obj);
-	FJavaWrapper::CallVoidMethod(Env, U->Visualizer, USpectrumAnalyzer::EnableVisualizer, true);
-	UE_LOG(LogSpectrumAnalyzer, Log, TEXT("Created Android Sound Visualizer %p, sample rate: %d"), U->Visualizer, SampleRate);
-	Env->DeleteLocalRef(Obj);
-#endif
-	return bSoundWaveResult && Channels > 0 && SampleRate > 0;
+	Analysis.Reset();
+	if (Hub.IsValid())
+	{
+		Hub->RemoveSoundWave(HubSoundWave);
+		HubSoundWave = nullptr;
+		Hub.Reset();
+	}
 }
 
-int32 SinkDelegate::GetAudioSinkChannels() const { return Channels; }
-int32 SinkDelegate::GetAudioSinkSampleRate() const { return SampleRate; }
-
-void SinkDelegate::PauseAudioSink()
+FSpectrumAnalysisSettings USpectrumAnalyzer::GetAnalysisSettings() const
 {
-	UMediaSoundWave* SoundWave = GetSoundWave();
-	if (SoundWave != nullptr) SoundWave->PauseAudioSink();
+	FSpectrumAnalysisSettings Settings;
+	Settings.WindowDurationInSeconds = WindowDurationInSeconds;
+	Settings.SpectrumWidth = SpectrumWidth;
+	Settings.AmplitudeBuckets = AmplitudeBuckets;
+	Settings.WindowType = WindowType;
+	Settings.BandScale = BandScale;
+	Settings.MinFrequency = MinFrequency;
+	Settings.OctaveFraction = OctaveFraction;
+	Settings.HopFraction = HopFraction;
+	Settings.Backend = FMediaAudioHub::HasPlatformFFT() ? AnalysisBackend : ESpectrumAnalysisBackend::Native;
+	return Settings;
 }
 
-void SinkDelegate::ResumeAudioSink()
+const FSpectrumAnalysisResult* USpectrumAnalyzer::UpdateAnalysis()
 {
-	UMediaSoundWave* SoundWave = GetSoundWave();
-	if (SoundWave != nullptr) SoundWave->ResumeAudioSink();
-}
+	if (MediaPlayer == nullptr || MediaPlayer->IsPaused())
+	{
+		return nullptr;
+	}
+	FSharedSpectrumAnalysis* Shared = AcquireAnalysis();
+	const FSpectrumAnalysisSettings& Settings = Shared->GetKey().Settings;
+	PlaybackTime = MediaPlayer->GetTime();
 
-void SinkDelegate::ShutdownAudioSink()
-{
-	UMediaSoundWave* SoundWave = GetSoundWave();
-	if (SoundWave != nullptr) SoundWave->ShutdownAudioSink();
+	// Before the first baked frame, or in a bake without any, the audio is analyzed live instead
+	const FBakedSpectrogramPtr& Baked = Hub->GetBakedSpectrogram();
+	if (Baked.IsValid() && Baked->Matches(Settings))
+	{
+		const FSpectrumAnalysisResult* Result = LookupBakedOnGameThread(*Shared, Baked);
+		if (Result != nullptr)
+		{
+			AnalysisStaleness = (PlaybackTime - Result->Time).GetTotalSeconds();
+			return Result;
+		}
+	}
 #if PLATFORM_ANDROID
-	USpectrumAnalyzer* U = (USpectrumAnalyzer*)Analyzer.Get();
-	JNIEnv* Env = FAndroidApplication::GetJavaEnv();
-	FJavaWrapper::CallVoidMethod(Env, U->Visualizer, USpectrumAnalyzer::EnableVisualizer, false);
-	Env->DeleteGlobalRef(U->Visualizer);
-	U->Visualizer = 0;
+	Hub->SetPlaybackTime(PlaybackTime);
+	Hub->NoteRead(Settings);
 #endif
-}
+	Hub->GetCaptureRates(CaptureCallbacksPerSecond, CaptureBytesPerSecond);
 
-void USpectrumAnalyzer::
-ProcessMediaSample(uint32 NumChannels, uint32 SamplesPerSecond, const uint8* Buffer, volatile uint32 BufferSize, FTimespan Duration, FTimespan Time)
-{
-	FScopeLock ScopeLock(&CriticalSection);
-	// buffer a few seconds
-	uint32 SamplesNeeded = SamplesPerSecond*NumChannels * 3;// WindowDurationInSeconds;
-	uint32 PoT = 2;
-	while (PoT < SamplesNeeded) PoT *= 2;
-	if (PCMData == nullptr || PCMData->Capacity() < PoT)
-	{
-		delete PCMData;
-		PCMData = new TCircularBuffer<int16>(PoT, (int16)0);
-		CurSampleIndex = 0;
-	}
-	CurrentTime = Time + Duration;
-	uint32 SampleCount = Duration.GetTotalSeconds() * SamplesPerSecond;
-	uint32 SamplesAvailable = BufferSize / sizeof(int16);
-	int16 *SampleBuffer = (int16*)(Buffer);
-	uint32 Start = CurSampleIndex;
-	for (uint32 i = 0; i < SamplesAvailable; i++)
-	{
-		(*PCMData)[CurSampleIndex] = SampleBuffer[i];
-		CurSampleIndex = PCMData->GetNextIndex(CurSampleIndex);
-	}
-	//uint32 End = CurSampleIndex;
-	//UE_LOG(LogSpectrumAnalyzer, Warning, TEXT("Samples available %d, Buffered %f seconds, Current time %f"), SamplesAvailable, (CurrentTime-PlaybackTime).GetTotalSeconds(), Time.GetTotalSeconds());
+	// Analyzers sharing the analysis also share its results: the worker publishes one result for all
+	// of them, and on the game thread the first to ask in a frame analyzes and the rest hit its cache.
+	// Until the first platform capture arrives, the spectra come from our own FFT.
+	const FSpectrumAnalysisResult* Result = nullptr;
+	if (Settings.Backend == ESpectrumAnalysisBackend::PlatformFFT)
+	{
+		Result = AnalyzeCaptureOnGameThread(*Shared, Settings);
+	}
+	if (Result == nullptr && (Shared->GetKey().bWorkerThread || Shared->GetKey().bStreaming))
+	{
+		Shared->Task->SetPlayback(Settings, PlaybackTime);
+		const FSpectrumAnalysisResult& Latest = Shared->Task->GetLatestResult();
+		if (Latest.NumChannels > 0)
+		{
+			Result = &Latest;
+		}
+	}
+	else if (Result == nullptr)
+	{
+		Result = AnalyzeOnGameThread(*Shared, Settings);
+	}
 
+	if (Result != nullptr)
+	{
+		AnalysisStaleness = (PlaybackTime - Result->Time).GetTotalSeconds();
+	}
+	return Result;
 }
 
-static float GetFFTInValue(const int16 SampleValue, const int16 SampleIndex, const int16 SampleCount)
+const FSpectrumAnalysisResult* USpectrumAnalyzer::AnalyzeOnGameThread(FSharedSpectrumAnalysis& Shared, const FSpectrumAnalysisSettings& Settings)
 {
-	float FFTValue = SampleValue;
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring = Hub->GetHistory();
+	if (!Ring.IsValid())
+	{
+		return nullptr;
+	}
+	FSpectrumAnalysisWindow Window;
+	if (!FSpectrumAnalysisEngine::FindWindow(Settings, *Ring, PlaybackTime, Window))
+	{
+		return nullptr;
+	}
 
-	// Apply the Hann window
-	FFTValue *= 0.5f * (1 - FMath::Cos(2 * PI * SampleIndex / (SampleCount - 1)));
+	FSpectrumAnalysisCache& Cache = Shared.Cache;
+	if (Cache.bValid && Cache.Ring == Ring && Cache.EndFrame == Window.EndFrame && Cache.CaptureSequence == 0 && Cache.Settings == Settings)
+	{
+		++AnalysisCacheHits;
+		return &Cache.Result;
+	}
+	++AnalysisCacheMisses;
 
-	return FFTValue;
+	Cache.bValid = false;
+	if (!Cache.Engine.AnalyzeWindow(Settings, *Ring, Window, PlaybackTime, Cache.Result))
+	{
+		return nullptr;
+	}
+	Shared.Spectrogram->Push(Cache.Result);
+	Cache.bValid = true;
+	Cache.Ring = Ring;
+	Cache.EndFrame = Window.EndFrame;
+	Cache.CaptureSequence = 0;
+	Cache.Baked.Reset();
+	Cache.Settings = Settings;
+	return &Cache.Result;
 }
 
-void USpectrumAnalyzer::
-CalculateFrequencySpectrum(int32 Channel, TArray<float> &OutSpectrum)
+const FSpectrumAnalysisResult* USpectrumAnalyzer::AnalyzeCaptureOnGameThread(FSharedSpectrumAnalysis& Shared, const FSpectrumAnalysisSettings& Settings)
 {
-	TArray< TArray<float> > Spectrums;
+	const FVisualizerCapture* Capture = Hub->GetLatestCapture();
+	if (Capture == nullptr)
+	{
+		return nullptr;
+	}
+	// The spectra only change with the capture, but amplitudes still follow the window being heard
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring = Hub->GetHistory();
+	FSpectrumAnalysisWindow Window;
+	if (!Ring.IsValid() || !FSpectrumAnalysisEngine::FindWindow(Settings, *Ring, PlaybackTime, Window))
+	{
+		Ring.Reset();
+		Window.EndFrame = 0;
+		Window.AmplitudeOffset = 0;
+	}
 
-	volatile bool did = DoCalculateFrequencySpectrum(Channel != 0, Spectrums);
-	if (!did)
+	FSpectrumAnalysisCache& Cache = Shared.Cache;
+	if (Cache.bValid && Cache.Ring == Ring && Cache.EndFrame == Window.EndFrame && Cache.CaptureSequence == Capture->Sequence && Cache.Settings == Settings)
 	{
-		//UE_LOG(LogSpectrumAnalyzer, Warning, TEXT("CalculateFrequencySpectrum: skipped"));
-		OutSpectrum.AddZeroed(SpectrumWidth);
-		return;
+		++AnalysisCacheHits;
+		return &Cache.Result;
 	}
-	
-	if (Spectrums.Num() > 0)
+	++AnalysisCacheMisses;
+
+	const bool bNewCapture = !Cache.bValid || Cache.CaptureSequence != Capture->Sequence || Cache.Settings != Settings;
+	Cache.bValid = false;
+	if (!VisualizerSpectrum::Analyze(Cache.Engine, Settings, *Capture, Ring.Get(), Window, PlaybackTime, Cache.Result))
 	{
-		if (Channel == 0)
-		{
-			OutSpectrum = Spectrums[0];
-		}
-		else if (Channel <= Spectrums.Num())
-		{
-			OutSpectrum = Spectrums[Channel - 1];
-		}
-		else
-		{
-			UE_LOG(LogSpectrumAnalyzer, Error, TEXT("Requested channel %d, sound only has %d channels"), SoundWave->NumChannels);
-		}
+		return nullptr;
 	}
-	for (int32 i = 0; i < OutSpectrum.Num(); i++)
+	if (bNewCapture)
 	{
-		if (!FMath::IsFinite(OutSpectrum[i]))
-		{
-			OutSpectrum[i] = 0.0f;
-		}
+		Shared.Spectrogram->Push(Cache.Result);
 	}
+	Cache.bValid = true;
+	Cache.Ring = Ring;
+	Cache.EndFrame = Window.EndFrame;
+	Cache.CaptureSequence = Capture->Sequence;
+	Cache.Baked.Reset();
+	Cache.Settings = Settings;
+	return &Cache.Result;
 }
 
-void USpectrumAnalyzer::BeginPlay()
+const FSpectrumAnalysisResult* USpectrumAnalyzer::LookupBakedOnGameThread(FSharedSpectrumAnalysis& Shared, const FBakedSpectrogramPtr& Baked)
 {
-#if PLATFORM_ANDROID
-	InitMethodIds();
-#endif
-	if (MediaPlayer != nullptr)
+	const FSpectrumAnalysisSettings& Settings = Shared.GetKey().Settings;
+	const int32 Frame = Baked->FindFrame(PlaybackTime);
+	if (Frame == INDEX_NONE)
 	{
-		MediaPlayer->SetSoundWave(nullptr);
-		MediaPlayer->OnMediaOpened.AddDynamic(this, &USpectrumAnalyzer::HandleMediaOpened);
-		MediaPlayer->OnMediaClosed.AddDynamic(this, &USpectrumAnalyzer::HandleMediaClosed);
+		return nullptr;
 	}
-}
 
-void USpectrumAnalyzer::HandleMediaOpened(FString OpenedUrl)
-{
-	CurrentTime = MediaPlayer->GetTime();
-	ConnectSink();
+	FSpectrumAnalysisCache& Cache = Shared.Cache;
+	if (Cache.bValid && Cache.Baked.Pin() == Baked && Cache.EndFrame == (uint64)Frame && Cache.Settings == Settings)
+	{
+		++AnalysisCacheHits;
+		return &Cache.Result;
+	}
+	++AnalysisCacheMisses;
+
+	Baked->GetFrame(Frame, Cache.Result);
+	Shared.Spectrogram->Push(Cache.Result);
+	Cache.bValid = true;
+	Cache.Ring.Reset();
+	Cache.EndFrame = Frame;
+	Cache.CaptureSequence = 0;
+	Cache.Baked = Baked;
+	Cache.Settings = Settings;
+	return &Cache.Result;
 }
 
-
-void USpectrumAnalyzer::ConnectSink()
+const FSpectrumAnalysisResult* USpectrumAnalyzer::UpdateChannelAnalysis(int32 Channel)
 {
-	if (MediaPlayer != nullptr)
+	const FSpectrumAnalysisResult* Result = UpdateAnalysis();
+	if (Result != nullptr && (Channel < 0 || Channel > (int32)Result->NumChannels))
 	{
-		TSharedPtr<IMediaPlayer> Player = MediaPlayer->GetPlayer();
-		if (Player.IsValid())
-		{
-			Player->GetOutput().SetAudioSink(&Sink.Get());
-		}
+		UE_LOG(LogSpectrumAnalyzer, Error, TEXT("Requested channel %d, sound only has %d channels"), Channel, Result->NumChannels);
+		return nullptr;
 	}
+	return Result;
 }
 
-void USpectrumAnalyzer::HandleMediaClosed()
+int32 USpectrumAnalyzer::CopyFrequencySpectrum(int32 Channel, TArrayView<float> OutSpectrum)
 {
-	if (MediaPlayer != nullptr)
+	const FSpectrumAnalysisResult* Result = UpdateChannelAnalysis(Channel);
+	if (Result == nullptr)
 	{
-		TSharedPtr<IMediaPlayer> Player = MediaPlayer->GetPlayer();
-		if (Player.IsValid())
-		{
-			Player->GetOutput().SetAudioSink(nullptr);
-		}
+		return FSpectrumAnalysisResult::CopyValues(nullptr, 0, OutSpectrum);
 	}
+	return Result->CopySpectrum(Channel, OutSpectrum);
 }
 
-void USpectrumAnalyzer::EndPlay(EEndPlayReason::Type Reason)
+int32 USpectrumAnalyzer::CopyAmplitude(int32 Channel, TArrayView<float> OutAmplitudes)
 {
-	if (MediaPlayer != nullptr)
+	const FSpectrumAnalysisResult* Result = UpdateChannelAnalysis(Channel);
+	if (Result == nullptr)
 	{
-		MediaPlayer->OnMediaOpened.RemoveDynamic(this, &USpectrumAnalyzer::HandleMediaOpened);
-		MediaPlayer->OnMediaClosed.RemoveDynamic(this, &USpectrumAnalyzer::HandleMediaClosed);
+		return FSpectrumAnalysisResult::CopyValues(nullptr, 0, OutAmplitudes);
 	}
+	return Result->CopyAmplitude(Channel, OutAmplitudes);
+}
+
+void USpectrumAnalyzer::
+CalculateFrequencySpectrum(int32 Channel, TArray<float> &OutSpectrum)
+{
+	// Reset keeps the allocation, so a Blueprint reusing its array does not allocate per call; without
+	// an analysis the output is SpectrumWidth zeros
+	const FSpectrumAnalysisResult* Result = UpdateChannelAnalysis(Channel);
+	const int32 Num = Result != nullptr ? Result->SpectrumWidth : SpectrumWidth;
+	OutSpectrum.Reset(Num);
+	OutSpectrum.AddUninitialized(Num);
+	FSpectrumAnalysisResult::CopyValues(Result != nullptr ? Result->GetSpectrum(Channel) : nullptr, Result != nullptr ? Num : 0, OutSpectrum);
+}
+
+void USpectrumAnalyzer::
+GetAmplitude(int32 Channel, TArray<float> &OutAmplitudes)
+{
+	const FSpectrumAnalysisResult* Result = UpdateChannelAnalysis(Channel);
+	const int32 Num = Result != nullptr ? Result->AmplitudeBuckets : AmplitudeBuckets;
+	OutAmplitudes.Reset(Num);
+	OutAmplitudes.AddUninitialized(Num);
+	FSpectrumAnalysisResult::CopyValues(Result != nullptr ? Result->GetAmplitude(Channel) : nullptr, Result != nullptr ? Num : 0, OutAmplitudes);
 }
 
 bool USpectrumAnalyzer::
-DoCalculateFrequencySpectrum(bool bSplitChannels, TArray<TArray<float> > &OutSpectrums)
+GetAnalysisFrame(FSpectrumAnalysisFrame& OutFrame)
 {
-	if (MediaPlayer == nullptr || MediaPlayer->IsPaused())
+	const FSpectrumAnalysisResult* Result = UpdateAnalysis();
+	if (Result == nullptr)
 	{
+		OutFrame.NumChannels = 0;
+		OutFrame.Spectrum.Reset();
+		OutFrame.SpectrumStride = SpectrumWidth;
+		OutFrame.Amplitude.Reset();
+		OutFrame.AmplitudeStride = AmplitudeBuckets;
+		OutFrame.Time = 0.f;
 		return false;
 	}
-	FScopeLock ScopeLock(&CriticalSection);
-	if (PCMData == nullptr) return false;
-	PlaybackTime = MediaPlayer->GetTime();
-	//UE_LOG(LogSpectrumAnalyzer, Log, TEXT("PlaybackTime %f, CurrentTime %f"), PlaybackTime.GetTotalSeconds(), CurrentTime.GetTotalSeconds());
-	FTimespan Delta = CurrentTime - PlaybackTime;
-	uint32 NumChannels = Sink->GetNumChannels();
-	uint32 SamplesPerSecond = Sink->GetSamplesPerSecond();
-	int32 DeltaSamples = Delta.GetTotalSeconds() * SamplesPerSecond * NumChannels;
-	uint32 SamplesNeeded = SamplesPerSecond * NumChannels * WindowDurationInSeconds;
-	if (CurSampleIndex < SamplesNeeded)
-	{
-		//return false;
-	}
-	int32 SampleCount = SamplesNeeded;
-	int32 LastSample = CurSampleIndex - DeltaSamples - 1;
-	int32 FirstSample = LastSample - SampleCount;
-	//UE_LOG(LogSpectrumAnalyzer, Log, TEXT("Samples %d .. %d"), FirstSample, LastSample);
-
-	volatile int32 SamplesToRead = LastSample - FirstSample;
-	// Setup the output data
-	OutSpectrums.AddZeroed((bSplitChannels ? NumChannels : 1));
-	for (int32 ChannelIndex = 0; ChannelIndex < OutSpectrums.Num(); ++ChannelIndex)
-	{
-		OutSpectrums[ChannelIndex].AddZeroed(SpectrumWidth);
-	}
-	if (SamplesToRead > 0)
-	{
-		// Shift the window enough so that we get a power of 2
-		int32 PoT = 2;
-		while (SamplesToRead > PoT) PoT *= 2;
-		FirstSample = FMath::Max(0, FirstSample - (PoT - SamplesToRead) / 2);
-		SamplesToRead = PoT;
-		LastSample = FirstSample + SamplesToRead;
-		if (LastSample > SampleCount)
-		{
-			FirstSample = LastSample - SamplesToRead;
-		}
-		if (FirstSample < 0)
-		{
-			// If we get to this point we can't create a reasonable window so just give up
-			//SoundWave->RawData.Unlock();
-			return false;
-		}
-
-		kiss_fft_cpx* buf[10] = { 0 };
-		kiss_fft_cpx* out[10] = { 0 };
-		kiss_fft_cfg stf = kiss_fft_alloc(SamplesToRead, 1, 0, 0);
-
-
-		//int16* SamplePtr = reinterpret_cast<int16*>(WaveInfo.SampleDataStart);
-		int32 SamplePtr = FirstSample;
-		if (NumChannels <= 2)
-		{
-			for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-			{
-				buf[ChannelIndex] = (kiss_fft_cpx *)KISS_FFT_MALLOC(sizeof(kiss_fft_cpx) * SamplesToRead);
-				out[ChannelIndex] = (kiss_fft_cpx *)KISS_FFT_MALLOC(sizeof(kiss_fft_cpx) * SamplesToRead);
-			}
-
-			//SamplePtr += (FirstSample * NumChannels);
-			const TCircularBuffer<int16> &Sampler = *PCMData;
-			for (int32 SampleIndex = 0; SampleIndex < SamplesToRead; ++SampleIndex)
-			{
-				for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-				{
-					int32 Index = SamplePtr;
-					int16 Value = Sampler[Index];
-					buf[ChannelIndex][SampleIndex].r = GetFFTInValue(Value, SampleIndex, SamplesToRead);
-					buf[ChannelIndex][SampleIndex].i = 0.f;
-
-					SamplePtr++;
-				}
-			}
-		}
-		else
-		{
-			return false;
-		}
-
-		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-		{
-			if (buf[ChannelIndex])
-			{
-				kiss_fft(stf, buf[ChannelIndex], out[ChannelIndex]);
-			}
-		}
-
-		int32 SamplesPerSpectrum = SamplesToRead / (2 * SpectrumWidth);
-		int32 ExcessSamples = SamplesToRead % (2 * SpectrumWidth);
+	// Results already use the frame's layout, so each array is a single copy
+	OutFrame.NumChannels = Result->NumChannels;
+	OutFrame.Spectrum.Reset(Result->Spectrum.Num());
+	OutFrame.Spectrum.Append(Result->Spectrum);
+	OutFrame.SpectrumStride = Result->SpectrumWidth;
+	OutFrame.Amplitude.Reset(Result->Amplitude.Num());
+	OutFrame.Amplitude.Append(Result->Amplitude);
+	OutFrame.AmplitudeStride = Result->AmplitudeBuckets;
+	OutFrame.Time = Result->Time.GetTotalSeconds();
+	return true;
+}
 
-		int32 FirstSampleForSpectrum = 1;
-		for (int32 SpectrumIndex = 0; SpectrumIndex < SpectrumWidth; ++SpectrumIndex)
-		{
-			static bool doLog = false;
-
-			int32 SamplesRead = 0;
-			double SampleSum = 0;
-			int32 SamplesForSpectrum = SamplesPerSpectrum + (ExcessSamples-- > 0 ? 1 : 0);
-
-			for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-			{
-				if (out[ChannelIndex])
-				{
-					if (bSplitChannels)
-					{
-						SampleSum = 0;
-					}
-
-					for (int32 SampleIndex = 0; SampleIndex < SamplesForSpectrum; ++SampleIndex)
-					{
-						float PostScaledR = out[ChannelIndex][FirstSampleForSpectrum + SampleIndex].r * 2.f / SamplesToRead;
-						float PostScaledI = out[ChannelIndex][FirstSampleForSpectrum + SampleIndex].i * 2.f / SamplesToRead;
-						//float Val = FMath::Sqrt(FMath::Square(PostScaledR) + FMath::Square(PostScaledI));
-						float Val = 10.f * FMath::LogX(10.f, FMath::Square(PostScaledR) + FMath::Square(PostScaledI));
-						//UE_LOG(LogSoundVisualization, Log, TEXT("%.2f"), Val);
-						SampleSum += Val;
-					}
-
-					if (bSplitChannels)
-					{
-						OutSpectrums[ChannelIndex][SpectrumIndex] = (float)(SampleSum / SamplesForSpectrum);
-					}
-					SamplesRead += SamplesForSpectrum;
-				}
-			}
-
-			if (!bSplitChannels)
-			{
-				OutSpectrums[0][SpectrumIndex] = (float)(SampleSum / SamplesRead);
-			}
-
-			FirstSampleForSpectrum += SamplesForSpectrum;
-		}
+int32 USpectrumAnalyzer::
+GetSpectrogram(int32 Channel, int32 NumFrames, TArray<float>& OutSpectrogram, int32& OutStride)
+{
+	const FTimespan EndTime = MediaPlayer != nullptr ? MediaPlayer->GetTime() : FTimespan::MaxValue();
+	return CopySpectrogram(Channel, FTimespan::MinValue(), EndTime, NumFrames, OutSpectrogram, OutStride);
+}
 
-		KISS_FFT_FREE(stf);
-		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-		{
-			if (buf[ChannelIndex])
-			{
-				KISS_FFT_FREE(buf[ChannelIndex]);
-				KISS_FFT_FREE(out[ChannelIndex]);
-			}
-		}
-	}
-	return true;
+int32 USpectrumAnalyzer::
+GetSpectrogramInTimeRange(int32 Channel, float StartTime, float EndTime, TArray<float>& OutSpectrogram, int32& OutStride)
+{
+	return CopySpectrogram(Channel, FTimespan::FromSeconds(StartTime), FTimespan::FromSeconds(EndTime), MAX_int32, OutSpectrogram, OutStride);
 }
 
-void USpectrumAnalyzer::
-GetAmplitude(int32 Channel, TArray<float> &OutSpectrum)
+bool USpectrumAnalyzer::
+BakeSpectrogram(USoundWave* Source, const FString& MediaUrl, ESpectrogramBakePrecision Precision)
 {
-	TArray< TArray<float> > Spectrums;
-	volatile bool did = DoGetAmplitude(Channel != 0, Spectrums);
-	if (!did)
+	const FSpectrumAnalysisSettings Settings = GetAnalysisSettings();
+	const FString Path = FBakedSpectrogram::GetPathForMedia(MediaUrl);
+	const uint32 BytesPerValue = Precision == ESpectrogramBakePrecision::EightBit ? 1 : 2;
+
+	// Some platforms cannot overwrite a file while it is mapped
+	FMediaAudioHub* CurrentHub = AcquireHub();
+	if (CurrentHub != nullptr)
 	{
-		OutSpectrum.AddZeroed(AmplitudeBuckets);
-		//UE_LOG(LogSpectrumAnalyzer, Warning, TEXT("GetAmplitude: skipped"));
-		return;
+		CurrentHub->CloseBakedSpectrogram();
 	}
-	if (Spectrums.Num() > 0)
+	bool bBaked;
+	if (Source != nullptr)
 	{
-		if (Channel == 0)
-		{
-			OutSpectrum = Spectrums[0];
-		}
-		else if (Channel <= Spectrums.Num())
-		{
-			OutSpectrum = Spectrums[Channel - 1];
-		}
-		else
-		{
-			UE_LOG(LogSoundVisualization, Error, TEXT("Requested channel %d, sound only has %d channels"), SoundWave->NumChannels);
-		}
+		bBaked = SpectrogramBaker::BakeSoundWave(Settings, Source, BytesPerValue, Path);
 	}
-	for (int32 i = 0; i < OutSpectrum.Num(); i++)
+	else
 	{
-		if (!FMath::IsFinite(OutSpectrum[i]))
-		{
-			OutSpectrum[i] = 0.0f;
-		}
+		FString MediaPath = MediaUrl;
+		MediaPath.RemoveFromStart(TEXT("file://"));
+		bBaked = SpectrogramBaker::BakeWaveFile(Settings, MediaPath, BytesPerValue, Path);
 	}
+	if (CurrentHub != nullptr)
+	{
+		CurrentHub->ReloadBakedSpectrogram();
+	}
+	return bBaked;
 }
 
-bool USpectrumAnalyzer::
-DoGetAmplitude(bool bSplitChannels, TArray<TArray<float> > &OutAmplitudes)
+int32 USpectrumAnalyzer::CopySpectrogram(int32 Channel, FTimespan StartTime, FTimespan EndTime, int32 MaxFrames, TArray<float>& OutSpectrogram, int32& OutStride)
 {
-
-	if (MediaPlayer != nullptr)
+	FSharedSpectrumAnalysis* Shared = AcquireAnalysis();
+	TSharedPtr<const FSpectrogram, ESPMode::ThreadSafe> Frames;
+	if (Shared != nullptr)
 	{
-		TSharedPtr<IMediaPlayer> Player = MediaPlayer->GetPlayer();
-		if (Player.IsValid())
-		{
-			Player->GetOutput().SetAudioSink(&Sink.Get());
-		}
-	}
-	if (MediaPlayer->IsPaused())
-	{
-		return false;
+		Frames = Shared->Spectrogram->Get();
 	}
-	FScopeLock ScopeLock(&CriticalSection);
-	if (PCMData == nullptr) return false;
-	uint32 NumChannels = Sink->GetNumChannels();
-	uint32 SamplesPerSecond = Sink->GetSamplesPerSecond();
-	uint32 SamplesNeeded = SamplesPerSecond * NumChannels * WindowDurationInSeconds;
-	if (CurSampleIndex < SamplesNeeded)
+	if (!Frames.IsValid() || MaxFrames <= 0)
 	{
-		//return;
+		OutStride = SpectrumWidth;
+		OutSpectrogram.Reset();
+		return 0;
 	}
-	int32 SampleCount = SamplesNeeded;
-	PlaybackTime = MediaPlayer->GetTime();
 
-	FTimespan Delta = CurrentTime - PlaybackTime;
-	int32 DeltaSamples = Delta.GetTotalSeconds() * SamplesPerSecond * NumChannels;
-	int32 LastSample = CurSampleIndex - DeltaSamples - 1;
-	int32 FirstSample = LastSample - SampleCount;
+	// Reset keeps the allocation, so a caller reusing its array does not allocate per query
+	OutStride = Frames->GetSpectrumWidth();
+	MaxFrames = FMath::Min(MaxFrames, Frames->GetCapacity());
+	OutSpectrogram.Reset(MaxFrames * OutStride);
+	OutSpectrogram.AddUninitialized(MaxFrames * OutStride);
+	const int32 NumFrames = Frames->CopyFrames(Channel, StartTime, EndTime, MaxFrames, OutSpectrogram.GetData());
+	OutSpectrogram.SetNum(NumFrames * OutStride, false);
+	return NumFrames;
+}
 
-	volatile int32 SamplesToRead = LastSample - FirstSample;
-	if (SamplesToRead <= 0)
-	{
-		//UE_LOG(LogSpectrumAnalyzer, Warning, TEXT("GetAmplitudes PlaybackTime %f, CurrentTime %f"), PlaybackTime.GetTotalSeconds(), CurrentTime.GetTotalSeconds());
-		return false;
-	}
-	else
+void USpectrumAnalyzer::BeginPlay()
+{
+	if (MediaPlayer != nullptr)
 	{
-		//UE_LOG(LogSpectrumAnalyzer, Display, TEXT("PlaybackTime %f"), PlaybackTime.GetTotalSeconds());
+		MediaPlayer->SetSoundWave(nullptr);
+		MediaPlayer->OnMediaOpened.AddDynamic(this, &USpectrumAnalyzer::HandleMediaOpened);
+		MediaPlayer->OnMediaClosed.AddDynamic(this, &USpectrumAnalyzer::HandleMediaClosed);
+		// The media may have been opened before we started listening
+		AcquireHub()->Connect();
 	}
-	OutAmplitudes.Empty();
+}
 
-	if (AmplitudeBuckets > 0 && NumChannels > 0)
+void USpectrumAnalyzer::HandleMediaOpened(FString OpenedUrl)
+{
+	if (FMediaAudioHub* CurrentHub = AcquireHub())
 	{
-		// Setup the output data
-		OutAmplitudes.AddZeroed((bSplitChannels ? NumChannels : 1));
-		for (int32 ChannelIndex = 0; ChannelIndex < OutAmplitudes.Num(); ++ChannelIndex)
-		{
-			OutAmplitudes[ChannelIndex].AddZeroed(AmplitudeBuckets);
-		}
-		const TCircularBuffer<int16> &Sampler = *PCMData;
-
-		int32 SamplePtr = FirstSample;
-		uint32 SamplesPerAmplitude = (LastSample - FirstSample) / AmplitudeBuckets;
-		uint32 ExcessSamples = (LastSample - FirstSample) % AmplitudeBuckets;
-
-		for (int32 AmplitudeIndex = 0; AmplitudeIndex < AmplitudeBuckets; ++AmplitudeIndex)
-		{
-			if (NumChannels <= 2)
-			{
-				int64 SampleSum[2] = { 0 };
-				SamplesToRead = SamplesPerAmplitude + (ExcessSamples-- > 0 ? 1 : 0);
-				for (int32 SampleIndex = 0; SampleIndex < SamplesToRead; ++SampleIndex)
-				{
-					for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-					{
-						SampleSum[ChannelIndex] += FMath::Abs(Sampler[SamplePtr]);
-						SamplePtr++;
-					}
-				}
-				for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
-				{
-					OutAmplitudes[(bSplitChannels ? ChannelIndex : 0)][AmplitudeIndex] = SampleSum[ChannelIndex] / (float)SamplesToRead;
-				}
-			}
-			else
-			{
-				return false;
-			}
-		}
+		CurrentHub->Connect();
 	}
-	return true;
 }
 
-
-#if PLATFORM_ANDROID
-
-void USpectrumAnalyzer::HandleCapture(const uint8* WaveForm, uint32 WaveFormSize)
+void USpectrumAnalyzer::HandleMediaClosed()
 {
-	int32 NumChannels = Sink->GetNumChannels();
-	int32 SamplesPerSecond = Sink->GetSamplesPerSecond();
-	ResampleBuffer.Reset(WaveFormSize*NumChannels);
-	for (uint32 i = 0; i < WaveFormSize; i++)
+	if (FMediaAudioHub* CurrentHub = AcquireHub())
 	{
-		for (int32 j = 0; j < NumChannels; j++)
-		{
-			ResampleBuffer.Add((int16)(WaveForm[i] - 0x80) << 8);
-		}
+		CurrentHub->Disconnect();
 	}
-	FTimespan Duration = FTimespan::FromSeconds(WaveFormSize / (double)SamplesPerSecond);
-	Sink->PlayAudioSink((const uint8*)ResampleBuffer.GetData(), ResampleBuffer.Num(), PlaybackTime + Duration);
-
 }
 
-extern "C"
+void USpectrumAnalyzer::EndPlay(EEndPlayReason::Type Reason)
 {
-
-	JNIEXPORT void JNICALL
-		Java_com_soundVisualizationsNonEngine_SoundVisualizer_nativeSendWaveForm(JNIEnv* Env, jclass clazz, jlong callbackObject, jbyteArray bytes, jint sampleRate)
+	if (MediaPlayer != nullptr)
 	{
-		//UE_LOG(LogSpectrumAnalyzer, Log, TEXT("Env %p, clazz %p, callbackObject %p, bytes %p, sampleRate %d "), Env, clazz, callbackObject, bytes, sampleRate);
-
-		jint length = Env->GetArrayLength(bytes);
-		jboolean bIsCopy;
-		jbyte* rawBytes = Env->GetByteArrayElements(bytes, &bIsCopy);
-		if (rawBytes != NULL)
-		{
-			((USpectrumAnalyzer*)callbackObject)->HandleCapture((const uint8*)rawBytes, length);
-		}
-		Env->ReleaseByteArrayElements(bytes, rawBytes, JNI_ABORT);
-
+		MediaPlayer->OnMediaOpened.RemoveDynamic(this, &USpectrumAnalyzer::HandleMediaOpened);
+		MediaPlayer->OnMediaClosed.RemoveDynamic(this, &USpectrumAnalyzer::HandleMediaClosed);
 	}
+	ReleaseHub();
 }
-
-#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * Hands the latest value from one producer thread to one consumer thread without locks.
+ *
+ * The producer fills GetWriteBuffer() and calls Publish(); the consumer calls GetReadBuffer(), which
+ * switches to the newest published value if there is one. Each side owns one of the three slots and
+ * they swap ownership of the third with a single atomic exchange, so neither side ever waits and the
+ * consumer may keep reading its slot for as long as it likes. Values the consumer never saw are
+ * simply overwritten.
+ */
+template<typename T>
+class TTripleBuffer
+{
+public:
+	TTripleBuffer()
+		: Shared(1)
+		, WriteIndex(0)
+		, ReadIndex(2)
+	{
+	}
+
+	/** Slot the producer may fill. Producer only. */
+	T& GetWriteBuffer() { return Slots[WriteIndex]; }
+
+	/** Makes the write buffer the latest value and takes the stale slot for the next write. Producer only. */
+	void Publish()
+	{
+		WriteIndex = FPlatformAtomics::InterlockedExchange(&Shared, WriteIndex | DirtyFlag) & IndexMask;
+	}
+
+	/** Latest published value. Consumer only. */
+	const T& GetReadBuffer()
+	{
+		if (Shared & DirtyFlag)
+		{
+			ReadIndex = FPlatformAtomics::InterlockedExchange(&Shared, ReadIndex) & IndexMask;
+		}
+		return Slots[ReadIndex];
+	}
+
+	/** True if something was published since the consumer last read. */
+	bool HasUpdate() const { return (Shared & DirtyFlag) != 0; }
+
+private:
+	TTripleBuffer(const TTripleBuffer&);
+	TTripleBuffer& operator=(const TTripleBuffer&);
+
+	static const int32 IndexMask = 3;
+	static const int32 DirtyFlag = 4;
+
+	T Slots[3];
+	/** Index of the slot in neither side's hands, plus DirtyFlag when it holds an unread value */
+	volatile int32 Shared;
+	int32 WriteIndex;
+	int32 ReadIndex;
+};
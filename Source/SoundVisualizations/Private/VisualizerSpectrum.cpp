@@ -0,0 +1,68 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "VisualizerSpectrum.h"
+
+float VisualizerSpectrum::GetPowerScale(int32 CaptureSize)
+{
+	const float BinScale = 32.f * CaptureSize;
+	return BinScale * BinScale;
+}
+
+bool VisualizerSpectrum::MapSpectrum(const FSpectrumAnalysisSettings& Settings, const FVisualizerCapture& Capture, FSpectrumAnalysisResult& Out)
+{
+	const int32 CaptureSize = Capture.Bins.Num();
+	if (CaptureSize < 2 || Capture.SampleRate == 0 || Out.NumChannels == 0)
+	{
+		return false;
+	}
+
+	Out.SpectrumWidth = FMath::Max(Settings.SpectrumWidth, 0);
+	Out.Spectrum.Reset();
+	Out.Spectrum.AddZeroed(Out.SpectrumWidth * (Out.NumChannels + 1));
+	if (Out.SpectrumWidth == 0)
+	{
+		return true;
+	}
+
+	FBandMapSettings BandSettings;
+	BandSettings.FFTSize = CaptureSize;
+	BandSettings.SampleRate = Capture.SampleRate;
+	BandSettings.NumBands = Out.SpectrumWidth;
+	BandSettings.Scale = Settings.BandScale;
+	BandSettings.OctaveFraction = Settings.OctaveFraction;
+	BandSettings.MinFrequency = Settings.MinFrequency;
+	FBandMapPtr BandMap = FBandMapCache::Get().FindOrCreate(BandSettings);
+	if (!BandMap.IsValid())
+	{
+		return false;
+	}
+
+	float* MixPower = Out.Spectrum.GetData();
+	BandMap->AccumulatePowerPacked8(Capture.Bins.GetData(), GetPowerScale(CaptureSize), MixPower);
+	FBandMap::PowerToDecibels(MixPower, Out.SpectrumWidth);
+	for (uint32 ChannelIndex = 0; ChannelIndex < Out.NumChannels; ++ChannelIndex)
+	{
+		FMemory::Memcpy(Out.Spectrum.GetData() + (ChannelIndex + 1) * Out.SpectrumWidth, MixPower, Out.SpectrumWidth * sizeof(float));
+	}
+	return true;
+}
+
+bool VisualizerSpectrum::Analyze(FSpectrumAnalysisEngine& Engine, const FSpectrumAnalysisSettings& Settings, const FVisualizerCapture& Capture, FAudioRingBuffer* Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out)
+{
+	if (Capture.Bins.Num() < 2)
+	{
+		return false;
+	}
+
+	// With no bands to fill the engine only measures amplitudes and never plans an FFT
+	FSpectrumAnalysisSettings AmplitudeSettings = Settings;
+	AmplitudeSettings.SpectrumWidth = 0;
+	if (Ring == nullptr || !Engine.AnalyzeWindow(AmplitudeSettings, *Ring, Window, PlaybackTime, Out))
+	{
+		Out.NumChannels = Ring != nullptr ? Ring->GetNumChannels() : 1;
+		Out.AmplitudeBuckets = FMath::Max(Settings.AmplitudeBuckets, 0);
+		Out.Amplitude.Reset();
+		Out.Amplitude.AddZeroed(Out.AmplitudeBuckets * (Out.NumChannels + 1));
+	}
+	Out.Time = Capture.Time;
+	return MapSpectrum(Settings, Capture, Out);
+}
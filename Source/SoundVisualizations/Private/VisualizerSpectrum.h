@@ -0,0 +1,50 @@
+#pragma once
+
+#include "SpectrumAnalysis.h"
+
+/** One spectrum captured by Android's Visualizer */
+struct FVisualizerCapture
+{
+	/** The packed 8 bit bins, in the layout FBandMap::AccumulatePowerPacked8 takes; the capture size is Bins.Num() */
+	TArray<int8> Bins;
+	uint32 SampleRate;
+	/** Playback time when the spectrum was captured */
+	FTimespan Time;
+	/** Counts captures, so a consumer can tell a new one from one it has already mapped */
+	uint64 Sequence;
+
+	FVisualizerCapture()
+		: SampleRate(0)
+		, Time(0)
+		, Sequence(0)
+	{
+	}
+};
+
+/**
+ * The PlatformFFT backend: spectra taken from a platform FFT capture instead of our own FFT.
+ *
+ * Nothing here depends on Android, so recorded captures map the same on any platform.
+ */
+namespace VisualizerSpectrum
+{
+	/**
+	 * What |packed byte|^2 is multiplied by to get the power of a bin of the int16 scale waveform. The
+	 * Visualizer's fixed point FFT divides every bin by the capture size, and packing a bin into a byte
+	 * drops its low 5 bits.
+	 */
+	float GetPowerScale(int32 CaptureSize);
+
+	/**
+	 * Writes the spectra of Capture into Out, which must already have NumChannels set. The capture is
+	 * of the output mix, so every run gets the same bands. Returns false if Capture is empty.
+	 */
+	bool MapSpectrum(const FSpectrumAnalysisSettings& Settings, const FVisualizerCapture& Capture, FSpectrumAnalysisResult& Out);
+
+	/**
+	 * The whole analysis: spectra from Capture, and amplitudes from Window of Ring, which Engine
+	 * measures without running an FFT. Amplitudes read 0 if Ring is null or no longer holds Window.
+	 * Out.Time is the time of the capture.
+	 */
+	bool Analyze(FSpectrumAnalysisEngine& Engine, const FSpectrumAnalysisSettings& Settings, const FVisualizerCapture& Capture, FAudioRingBuffer* Ring, const FSpectrumAnalysisWindow& Window, FTimespan PlaybackTime, FSpectrumAnalysisResult& Out);
+}
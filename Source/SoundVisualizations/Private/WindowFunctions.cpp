@@ -0,0 +1,125 @@
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+#include "WindowFunctions.h"
+
+#define WINDOW_TABLE_ALIGNMENT 64
+#define KAISER_BETA 8.6
+
+namespace
+{
+	/** Zeroth order modified Bessel function of the first kind */
+	double BesselI0(double X)
+	{
+		double Sum = 1.0;
+		double Term = 1.0;
+		const double HalfXSquared = 0.25 * X * X;
+		for (int32 K = 1; K < 64; ++K)
+		{
+			Term *= HalfXSquared / (double(K) * double(K));
+			Sum += Term;
+			if (Term < Sum * 1e-12)
+			{
+				break;
+			}
+		}
+		return Sum;
+	}
+
+	double CosineSum(const double* A, int32 NumTerms, double Phase)
+	{
+		double Value = A[0];
+		double Sign = -1.0;
+		for (int32 K = 1; K < NumTerms; ++K)
+		{
+			Value += Sign * A[K] * cos(K * Phase);
+			Sign = -Sign;
+		}
+		return Value;
+	}
+
+	double EvaluateWindow(ESpectrumWindowType Type, int32 Index, int32 Length)
+	{
+		static const double Hann[] = { 0.5, 0.5 };
+		static const double Hamming[] = { 0.54, 0.46 };
+		static const double BlackmanHarris[] = { 0.35875, 0.48829, 0.14128, 0.01168 };
+		static const double FlatTop[] = { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 };
+
+		const double Phase = 2.0 * PI * Index / (Length - 1);
+		switch (Type)
+		{
+		case ESpectrumWindowType::Hamming: return CosineSum(Hamming, ARRAY_COUNT(Hamming), Phase);
+		case ESpectrumWindowType::BlackmanHarris: return CosineSum(BlackmanHarris, ARRAY_COUNT(BlackmanHarris), Phase);
+		case ESpectrumWindowType::FlatTop: return CosineSum(FlatTop, ARRAY_COUNT(FlatTop), Phase);
+		case ESpectrumWindowType::Kaiser:
+		{
+			const double Ratio = 2.0 * Index / (Length - 1) - 1.0;
+			return BesselI0(KAISER_BETA * sqrt(FMath::Max(0.0, 1.0 - Ratio * Ratio))) / BesselI0(KAISER_BETA);
+		}
+		case ESpectrumWindowType::Hann:
+		default:
+			return CosineSum(Hann, ARRAY_COUNT(Hann), Phase);
+		}
+	}
+}
+
+FWindowTable::FWindowTable(ESpectrumWindowType InType, int32 InLength)
+	: Type(InType)
+	, Length(FMath::Max(InLength, 1))
+{
+	Coefficients = (float*)FMemory::Malloc(sizeof(float) * Length, WINDOW_TABLE_ALIGNMENT);
+	FixedCoefficients = (int16*)FMemory::Malloc(sizeof(int16) * Length, WINDOW_TABLE_ALIGNMENT);
+	for (int32 Index = 0; Index < Length; ++Index)
+	{
+		Coefficients[Index] = Length == 1 ? 1.f : (float)EvaluateWindow(Type, Index, Length);
+		FixedCoefficients[Index] = (int16)FMath::Clamp(FMath::RoundToInt(Coefficients[Index] * 32768.f), -32768, 32767);
+	}
+}
+
+FWindowTable::~FWindowTable()
+{
+	FMemory::Free(Coefficients);
+	FMemory::Free(FixedCoefficients);
+}
+
+FWindowTableCache& FWindowTableCache::Get()
+{
+	static FWindowTableCache Cache;
+	return Cache;
+}
+
+FWindowTablePtr FWindowTableCache::FindOrCreate(ESpectrumWindowType Type, int32 Length)
+{
+	if (Length <= 0)
+	{
+		return nullptr;
+	}
+	const uint64 Key = ((uint64)Type << 32) | (uint32)Length;
+
+	Lock.ReadLock();
+	const FWindowTablePtr* Found = Tables.Find(Key);
+	FWindowTablePtr Table = Found != nullptr ? *Found : nullptr;
+	Lock.ReadUnlock();
+	if (Table.IsValid())
+	{
+		return Table;
+	}
+
+	Table = MakeShareable(new FWindowTable(Type, Length));
+	Lock.WriteLock();
+	if (const FWindowTablePtr* Existing = Tables.Find(Key))
+	{
+		Table = *Existing;
+	}
+	else
+	{
+		Tables.Add(Key, Table);
+	}
+	Lock.WriteUnlock();
+	return Table;
+}
+
+void FWindowTableCache::Empty()
+{
+	Lock.WriteLock();
+	Tables.Empty();
+	Lock.WriteUnlock();
+}
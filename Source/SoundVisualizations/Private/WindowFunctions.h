@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SpectrumAnalyzer.h"
+
+/** Symmetric window coefficients of one type and length, aligned for SIMD loads. */
+class FWindowTable
+{
+public:
+	FWindowTable(ESpectrumWindowType InType, int32 InLength);
+	~FWindowTable();
+
+	ESpectrumWindowType GetType() const { return Type; }
+	int32 Num() const { return Length; }
+	const float* GetData() const { return Coefficients; }
+	/** The coefficients in Q15, for the fixed point FFT */
+	const int16* GetFixedData() const { return FixedCoefficients; }
+
+private:
+	FWindowTable(const FWindowTable&);
+	FWindowTable& operator=(const FWindowTable&);
+
+	ESpectrumWindowType Type;
+	int32 Length;
+	float* Coefficients;
+	int16* FixedCoefficients;
+};
+
+typedef TSharedPtr<const FWindowTable, ESPMode::ThreadSafe> FWindowTablePtr;
+
+/**
+ * Window tables built once per (type, length) and shared by every analyzer.
+ *
+ * Analyzers only use a handful of lengths, so tables are kept until Empty() is called.
+ */
+class FWindowTableCache
+{
+public:
+	static FWindowTableCache& Get();
+
+	FWindowTablePtr FindOrCreate(ESpectrumWindowType Type, int32 Length);
+	void Empty();
+
+private:
+	FWindowTableCache() {}
+
+	mutable FRWLock Lock;
+	TMap<uint64, FWindowTablePtr> Tables;
+};
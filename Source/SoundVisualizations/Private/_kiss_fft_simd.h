@@ -0,0 +1,168 @@
+/*
+ * Vector versions of the radix 2, 3, 4 and 5 butterflies and of the power of two radix 4 stage,
+ * working on KF_W columns of a stage at once with the usual interleaved kiss_fft_cpx layout.
+ * kiss_fft.c includes this once per instruction set after defining:
+ *
+ *  KF_SIMD_NAME(f)       : name of the instantiation of f
+ *  KF_SIMD_TARGET        : function attributes needed to use the instruction set
+ *  KF_V, KF_W            : vector type and the number of complex values it holds
+ *  KF_LOAD(p), KF_STORE(p,v)
+ *  KF_TWLOAD(tw,stride)  : KF_W twiddles starting at tw, stride apart
+ *  KF_ADD(a,b), KF_SUB(a,b), KF_CMUL(a,b)
+ *  KF_MULJ(a)            : a * i
+ *  KF_SCALE(a,s)         : a * real scalar s
+ *
+ * Columns left over after the last full vector go to the scalar butterflies.
+ */
+
+static KF_SIMD_TARGET void KF_SIMD_NAME(kf_bfly2)(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m
+        )
+{
+    const kiss_fft_cpx * tw = st->twiddles;
+    kiss_fft_cpx * Fout2 = Fout + m;
+    int k;
+    for (k=0; k+KF_W<=m; k+=KF_W) {
+        KF_V t = KF_CMUL(KF_LOAD(Fout2+k), KF_TWLOAD(tw+k*fstride, fstride));
+        KF_V a = KF_LOAD(Fout+k);
+        KF_STORE(Fout2+k, KF_SUB(a, t));
+        KF_STORE(Fout+k, KF_ADD(a, t));
+    }
+    if (k < m)
+        kf_bfly2(Fout, fstride, st, m, k);
+}
+
+static KF_SIMD_TARGET void KF_SIMD_NAME(kf_bfly4)(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        const size_t m
+        )
+{
+    const kiss_fft_cpx * tw = st->twiddles;
+    const size_t m2=2*m;
+    const size_t m3=3*m;
+    size_t k;
+    for (k=0; k+KF_W<=m; k+=KF_W) {
+        KF_V f0 = KF_LOAD(Fout+k);
+        KF_V s0 = KF_CMUL(KF_LOAD(Fout+k+m), KF_TWLOAD(tw+k*fstride, fstride));
+        KF_V s1 = KF_CMUL(KF_LOAD(Fout+k+m2), KF_TWLOAD(tw+k*fstride*2, fstride*2));
+        KF_V s2 = KF_CMUL(KF_LOAD(Fout+k+m3), KF_TWLOAD(tw+k*fstride*3, fstride*3));
+        KF_V s5 = KF_SUB(f0, s1);
+        KF_V f1 = KF_ADD(f0, s1);
+        KF_V s3 = KF_ADD(s0, s2);
+        KF_V js4 = KF_MULJ(KF_SUB(s0, s2));
+
+        KF_STORE(Fout+k+m2, KF_SUB(f1, s3));
+        KF_STORE(Fout+k, KF_ADD(f1, s3));
+        if (st->inverse) {
+            KF_STORE(Fout+k+m, KF_ADD(s5, js4));
+            KF_STORE(Fout+k+m3, KF_SUB(s5, js4));
+        }else{
+            KF_STORE(Fout+k+m, KF_SUB(s5, js4));
+            KF_STORE(Fout+k+m3, KF_ADD(s5, js4));
+        }
+    }
+    if (k < m)
+        kf_bfly4(Fout, fstride, st, m, k);
+}
+
+static KF_SIMD_TARGET void KF_SIMD_NAME(kf_bfly3)(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        size_t m
+        )
+{
+    const kiss_fft_cpx * tw = st->twiddles;
+    const size_t m2 = 2*m;
+    const kiss_fft_scalar epi3i = st->twiddles[fstride*m].i;
+    size_t k;
+    for (k=0; k+KF_W<=m; k+=KF_W) {
+        KF_V f0 = KF_LOAD(Fout+k);
+        KF_V s1 = KF_CMUL(KF_LOAD(Fout+k+m), KF_TWLOAD(tw+k*fstride, fstride));
+        KF_V s2 = KF_CMUL(KF_LOAD(Fout+k+m2), KF_TWLOAD(tw+k*fstride*2, fstride*2));
+        KF_V s3 = KF_ADD(s1, s2);
+        KF_V js0 = KF_MULJ(KF_SCALE(KF_SUB(s1, s2), epi3i));
+        KF_V fm = KF_SUB(f0, KF_SCALE(s3, 0.5f));
+
+        KF_STORE(Fout+k, KF_ADD(f0, s3));
+        KF_STORE(Fout+k+m2, KF_SUB(fm, js0));
+        KF_STORE(Fout+k+m, KF_ADD(fm, js0));
+    }
+    if (k < m)
+        kf_bfly3(Fout, fstride, st, m, k);
+}
+
+static KF_SIMD_TARGET void KF_SIMD_NAME(kf_bfly5)(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m
+        )
+{
+    const kiss_fft_cpx * tw = st->twiddles;
+    const kiss_fft_cpx ya = tw[fstride*m];
+    const kiss_fft_cpx yb = tw[fstride*2*m];
+    int u;
+    for (u=0; u+KF_W<=m; u+=KF_W) {
+        KF_V s0 = KF_LOAD(Fout+u);
+        KF_V s1 = KF_CMUL(KF_LOAD(Fout+u+m), KF_TWLOAD(tw+u*fstride, fstride));
+        KF_V s2 = KF_CMUL(KF_LOAD(Fout+u+2*m), KF_TWLOAD(tw+u*fstride*2, fstride*2));
+        KF_V s3 = KF_CMUL(KF_LOAD(Fout+u+3*m), KF_TWLOAD(tw+u*fstride*3, fstride*3));
+        KF_V s4 = KF_CMUL(KF_LOAD(Fout+u+4*m), KF_TWLOAD(tw+u*fstride*4, fstride*4));
+        KF_V s7 = KF_ADD(s1, s4);
+        KF_V s10 = KF_SUB(s1, s4);
+        KF_V s8 = KF_ADD(s2, s3);
+        KF_V s9 = KF_SUB(s2, s3);
+
+        KF_V s5 = KF_ADD(s0, KF_ADD(KF_SCALE(s7, ya.r), KF_SCALE(s8, yb.r)));
+        KF_V js6 = KF_MULJ(KF_ADD(KF_SCALE(s10, ya.i), KF_SCALE(s9, yb.i)));
+        KF_V s11 = KF_ADD(s0, KF_ADD(KF_SCALE(s7, yb.r), KF_SCALE(s8, ya.r)));
+        KF_V s12 = KF_MULJ(KF_SUB(KF_SCALE(s10, yb.i), KF_SCALE(s9, ya.i)));
+
+        KF_STORE(Fout+u, KF_ADD(s0, KF_ADD(s7, s8)));
+        KF_STORE(Fout+u+m, KF_ADD(s5, js6));
+        KF_STORE(Fout+u+4*m, KF_SUB(s5, js6));
+        KF_STORE(Fout+u+2*m, KF_ADD(s11, s12));
+        KF_STORE(Fout+u+3*m, KF_SUB(s11, s12));
+    }
+    if (u < m)
+        kf_bfly5(Fout, fstride, st, m, u);
+}
+
+static KF_SIMD_TARGET void KF_SIMD_NAME(kf_pow2_bfly4)(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * tw,
+        int m,
+        int count,
+        int inverse
+        )
+{
+    int k;
+    for (k=0; k+KF_W<=count; k+=KF_W) {
+        KF_V f0 = KF_LOAD(Fout+k);
+        KF_V s0 = KF_CMUL(KF_LOAD(Fout+k+m), KF_TWLOAD(tw+k, 1));
+        KF_V s1 = KF_CMUL(KF_LOAD(Fout+k+2*m), KF_TWLOAD(tw+m+k, 1));
+        KF_V s2 = KF_CMUL(KF_LOAD(Fout+k+3*m), KF_TWLOAD(tw+2*m+k, 1));
+        KF_V s5 = KF_SUB(f0, s1);
+        KF_V f1 = KF_ADD(f0, s1);
+        KF_V s3 = KF_ADD(s0, s2);
+        KF_V js4 = KF_MULJ(KF_SUB(s0, s2));
+
+        KF_STORE(Fout+k+2*m, KF_SUB(f1, s3));
+        KF_STORE(Fout+k, KF_ADD(f1, s3));
+        if (inverse) {
+            KF_STORE(Fout+k+m, KF_ADD(s5, js4));
+            KF_STORE(Fout+k+3*m, KF_SUB(s5, js4));
+        }else{
+            KF_STORE(Fout+k+m, KF_SUB(s5, js4));
+            KF_STORE(Fout+k+3*m, KF_ADD(s5, js4));
+        }
+    }
+    if (k < count)
+        kf_pow2_bfly4(Fout, tw, m, count, inverse, k);
+}
@@ -18,18 +18,24 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
+/* The scalar butterflies start at index k0 of the stage so the SIMD kernels can hand them the
+   few columns left over after their last full vector. */
+
 static void kf_bfly2(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int k0
         )
 {
     kiss_fft_cpx * Fout2;
-    kiss_fft_cpx * tw1 = st->twiddles;
+    kiss_fft_cpx * tw1 = st->twiddles + k0*fstride;
     kiss_fft_cpx t;
+    int k;
+    Fout += k0;
     Fout2 = Fout + m;
-    do{
+    for (k=k0; k<m; ++k) {
         C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
 
         C_MUL (t,  *Fout2 , *tw1);
@@ -38,26 +44,29 @@ static void kf_bfly2(
         C_ADDTO( *Fout ,  t );
         ++Fout2;
         ++Fout;
-    }while (--m);
+    }
 }
 
 static void kf_bfly4(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        const size_t m
+        const size_t m,
+        size_t k0
         )
 {
     kiss_fft_cpx *tw1,*tw2,*tw3;
     kiss_fft_cpx scratch[6];
-    size_t k=m;
+    size_t k;
     const size_t m2=2*m;
     const size_t m3=3*m;
 
+    tw1 = st->twiddles + k0*fstride;
+    tw2 = st->twiddles + k0*fstride*2;
+    tw3 = st->twiddles + k0*fstride*3;
+    Fout += k0;
 
-    tw3 = tw2 = tw1 = st->twiddles;
-
-    do {
+    for (k=k0; k<m; ++k) {
         C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
 
         C_MUL(scratch[0],Fout[m] , *tw1 );
@@ -86,26 +95,29 @@ static void kf_bfly4(
             Fout[m3].i = scratch[5].i + scratch[4].r;
         }
         ++Fout;
-    }while(--k);
+    }
 }
 
 static void kf_bfly3(
          kiss_fft_cpx * Fout,
          const size_t fstride,
          const kiss_fft_cfg st,
-         size_t m
+         size_t m,
+         size_t k0
          )
 {
-     size_t k=m;
+     size_t k;
      const size_t m2 = 2*m;
      kiss_fft_cpx *tw1,*tw2;
      kiss_fft_cpx scratch[5];
      kiss_fft_cpx epi3;
      epi3 = st->twiddles[fstride*m];
 
-     tw1=tw2=st->twiddles;
+     tw1 = st->twiddles + k0*fstride;
+     tw2 = st->twiddles + k0*fstride*2;
+     Fout += k0;
 
-     do{
+     for (k=k0; k<m; ++k) {
          C_FIXDIV(*Fout,3); C_FIXDIV(Fout[m],3); C_FIXDIV(Fout[m2],3);
 
          C_MUL(scratch[1],Fout[m] , *tw1);
@@ -130,14 +142,15 @@ static void kf_bfly3(
          Fout[m].i += scratch[0].r;
 
          ++Fout;
-     }while(--k);
+     }
 }
 
 static void kf_bfly5(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int k0
         )
 {
     kiss_fft_cpx *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
@@ -149,14 +162,14 @@ static void kf_bfly5(
     ya = twiddles[fstride*m];
     yb = twiddles[fstride*2*m];
 
-    Fout0=Fout;
+    Fout0=Fout+k0;
     Fout1=Fout0+m;
     Fout2=Fout0+2*m;
     Fout3=Fout0+3*m;
     Fout4=Fout0+4*m;
 
     tw=st->twiddles;
-    for ( u=0; u<m; ++u ) {
+    for ( u=k0; u<m; ++u ) {
         C_FIXDIV( *Fout0,5); C_FIXDIV( *Fout1,5); C_FIXDIV( *Fout2,5); C_FIXDIV( *Fout3,5); C_FIXDIV( *Fout4,5);
         scratch[0] = *Fout0;
 
@@ -194,6 +207,49 @@ static void kf_bfly5(
     }
 }
 
+/*
+ * Radix 4 stage of a power of two plan: combines the four transforms of length m starting at
+ * Fout. tw holds the stage's twiddles w^k, w^2k and w^3k as three runs of m. Only the first count
+ * columns are done, so a stage can be split up by offsetting Fout and tw.
+ */
+static void kf_pow2_bfly4(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * tw,
+        int m,
+        int count,
+        int inverse,
+        int k0
+        )
+{
+    kiss_fft_cpx scratch[6];
+    int k;
+    for (k=k0; k<count; ++k) {
+        kiss_fft_cpx * F = Fout + k;
+        C_MUL(scratch[0], F[m], tw[k]);
+        C_MUL(scratch[1], F[2*m], tw[m+k]);
+        C_MUL(scratch[2], F[3*m], tw[2*m+k]);
+
+        C_SUB( scratch[5] , *F, scratch[1] );
+        C_ADDTO(*F, scratch[1]);
+        C_ADD( scratch[3] , scratch[0] , scratch[2] );
+        C_SUB( scratch[4] , scratch[0] , scratch[2] );
+        C_SUB( F[2*m], *F, scratch[3] );
+        C_ADDTO( *F , scratch[3] );
+
+        if (inverse) {
+            F[m].r = scratch[5].r - scratch[4].i;
+            F[m].i = scratch[5].i + scratch[4].r;
+            F[3*m].r = scratch[5].r + scratch[4].i;
+            F[3*m].i = scratch[5].i - scratch[4].r;
+        }else{
+            F[m].r = scratch[5].r + scratch[4].i;
+            F[m].i = scratch[5].i - scratch[4].r;
+            F[3*m].r = scratch[5].r - scratch[4].i;
+            F[3*m].i = scratch[5].i + scratch[4].r;
+        }
+    }
+}
+
 /* perform the butterfly for one stage of a mixed radix FFT */
 static void kf_bfly_generic(
         kiss_fft_cpx * Fout,
@@ -234,6 +290,608 @@ static void kf_bfly_generic(
     KISS_FFT_TMP_FREE(scratch);
 }
 
+static void kf_bfly2_scalar(kiss_fft_cpx * Fout,const size_t fstride,const kiss_fft_cfg st,int m) { kf_bfly2(Fout,fstride,st,m,0); }
+static void kf_bfly3_scalar(kiss_fft_cpx * Fout,const size_t fstride,const kiss_fft_cfg st,size_t m) { kf_bfly3(Fout,fstride,st,m,0); }
+static void kf_bfly4_scalar(kiss_fft_cpx * Fout,const size_t fstride,const kiss_fft_cfg st,const size_t m) { kf_bfly4(Fout,fstride,st,m,0); }
+static void kf_bfly5_scalar(kiss_fft_cpx * Fout,const size_t fstride,const kiss_fft_cfg st,int m) { kf_bfly5(Fout,fstride,st,m,0); }
+static void kf_pow2_bfly4_scalar(kiss_fft_cpx * Fout,const kiss_fft_cpx * tw,int m,int count,int inverse) { kf_pow2_bfly4(Fout,tw,m,count,inverse,0); }
+
+/* One set of radix 2-5 butterflies */
+typedef struct {
+    int level;
+    const char * name;
+    void (*bfly2)(kiss_fft_cpx *,const size_t,const kiss_fft_cfg,int);
+    void (*bfly3)(kiss_fft_cpx *,const size_t,const kiss_fft_cfg,size_t);
+    void (*bfly4)(kiss_fft_cpx *,const size_t,const kiss_fft_cfg,const size_t);
+    void (*bfly5)(kiss_fft_cpx *,const size_t,const kiss_fft_cfg,int);
+    void (*pow2_bfly4)(kiss_fft_cpx *,const kiss_fft_cpx *,int,int,int);
+} kf_kernels;
+
+static const kf_kernels kf_scalar_kernels = {
+    KISS_FFT_SIMD_NONE, "scalar", kf_bfly2_scalar, kf_bfly3_scalar, kf_bfly4_scalar, kf_bfly5_scalar, kf_pow2_bfly4_scalar
+};
+
+/*
+ * SIMD butterflies keep the float kiss_fft_cpx interface, so they only exist in the plain float
+ * build. 128 bit kernels use the baseline instruction set of the target (SSE2 on x86-64, NEON on
+ * AArch64); AVX2 is compiled for explicitly and only used if the CPU reports it at runtime.
+ */
+#if !defined(FIXED_POINT) && !defined(USE_SIMD)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define KISS_FFT_HAVE_SSE2
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#    define KISS_FFT_HAVE_AVX2
+#  endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define KISS_FFT_HAVE_NEON
+#endif
+
+#ifdef KISS_FFT_HAVE_SSE2
+#include <emmintrin.h>
+
+static __inline __m128 kf_twload_sse2(const kiss_fft_cpx * tw, size_t stride)
+{
+    if (stride == 1)
+        return _mm_loadu_ps((const float *)tw);
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)tw), (const __m64 *)(tw+stride));
+}
+
+static __inline __m128 kf_cmul_sse2(__m128 a, __m128 b)
+{
+    const __m128 sign = _mm_set_ps(0.f, -0.f, 0.f, -0.f);
+    __m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,2,0,0));
+    __m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3,3,1,1));
+    __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1));
+    return _mm_add_ps(_mm_mul_ps(a, br), _mm_xor_ps(_mm_mul_ps(as, bi), sign));
+}
+
+static __inline __m128 kf_mulj_sse2(__m128 a)
+{
+    const __m128 sign = _mm_set_ps(0.f, -0.f, 0.f, -0.f);
+    return _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1)), sign);
+}
+
+#define KF_SIMD_NAME(f) f##_sse2
+#define KF_SIMD_TARGET
+#define KF_V __m128
+#define KF_W 2
+#define KF_LOAD(p) _mm_loadu_ps((const float *)(p))
+#define KF_STORE(p,v) _mm_storeu_ps((float *)(p), v)
+#define KF_TWLOAD(tw,stride) kf_twload_sse2(tw, stride)
+#define KF_ADD(a,b) _mm_add_ps(a, b)
+#define KF_SUB(a,b) _mm_sub_ps(a, b)
+#define KF_CMUL(a,b) kf_cmul_sse2(a, b)
+#define KF_MULJ(a) kf_mulj_sse2(a)
+#define KF_SCALE(a,s) _mm_mul_ps(a, _mm_set1_ps(s))
+#include "_kiss_fft_simd.h"
+#undef KF_SIMD_NAME
+#undef KF_SIMD_TARGET
+#undef KF_V
+#undef KF_W
+#undef KF_LOAD
+#undef KF_STORE
+#undef KF_TWLOAD
+#undef KF_ADD
+#undef KF_SUB
+#undef KF_CMUL
+#undef KF_MULJ
+#undef KF_SCALE
+
+static const kf_kernels kf_sse2_kernels = {
+    KISS_FFT_SIMD_128, "sse2", kf_bfly2_sse2, kf_bfly3_sse2, kf_bfly4_sse2, kf_bfly5_sse2, kf_pow2_bfly4_sse2
+};
+#endif /* KISS_FFT_HAVE_SSE2 */
+
+#ifdef KISS_FFT_HAVE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#  include <intrin.h>
+#  define KF_AVX2_TARGET
+#else
+#  define KF_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+static int kf_cpu_has_avx2(void)
+{
+    unsigned int regs[4];
+    unsigned long long xcr0;
+#ifdef _MSC_VER
+    __cpuid((int *)regs, 0);
+    if (regs[0] < 7)
+        return 0;
+    __cpuid((int *)regs, 1);
+#else
+    __asm__ __volatile__ ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3]) : "a"(0), "c"(0));
+    if (regs[0] < 7)
+        return 0;
+    __asm__ __volatile__ ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3]) : "a"(1), "c"(0));
+#endif
+    /* FMA, OSXSAVE and AVX */
+    if ((regs[2] & ((1u<<12) | (1u<<27) | (1u<<28))) != ((1u<<12) | (1u<<27) | (1u<<28)))
+        return 0;
+    /* the OS must save the ymm registers */
+#ifdef _MSC_VER
+    xcr0 = _xgetbv(0);
+#else
+    {
+        unsigned int lo, hi;
+        __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = ((unsigned long long)hi << 32) | lo;
+    }
+#endif
+    if ((xcr0 & 6) != 6)
+        return 0;
+#ifdef _MSC_VER
+    __cpuidex((int *)regs, 7, 0);
+#else
+    __asm__ __volatile__ ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3]) : "a"(7), "c"(0));
+#endif
+    return (regs[1] & (1u<<5)) != 0;
+}
+
+static KF_AVX2_TARGET __inline __m256 kf_twload_avx2(const kiss_fft_cpx * tw, size_t stride)
+{
+    __m128 lo, hi;
+    if (stride == 1)
+        return _mm256_loadu_ps((const float *)tw);
+    lo = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)tw), (const __m64 *)(tw+stride));
+    hi = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(tw+2*stride)), (const __m64 *)(tw+3*stride));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static KF_AVX2_TARGET __inline __m256 kf_cmul_avx2(__m256 a, __m256 b)
+{
+    /* even lanes a.r*b.r - a.i*b.i, odd lanes a.i*b.r + a.r*b.i */
+    return _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(b), _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(b)));
+}
+
+static KF_AVX2_TARGET __inline __m256 kf_mulj_avx2(__m256 a)
+{
+    const __m256 sign = _mm256_set_ps(0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f);
+    return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), sign);
+}
+
+#define KF_SIMD_NAME(f) f##_avx2
+#define KF_SIMD_TARGET KF_AVX2_TARGET
+#define KF_V __m256
+#define KF_W 4
+#define KF_LOAD(p) _mm256_loadu_ps((const float *)(p))
+#define KF_STORE(p,v) _mm256_storeu_ps((float *)(p), v)
+#define KF_TWLOAD(tw,stride) kf_twload_avx2(tw, stride)
+#define KF_ADD(a,b) _mm256_add_ps(a, b)
+#define KF_SUB(a,b) _mm256_sub_ps(a, b)
+#define KF_CMUL(a,b) kf_cmul_avx2(a, b)
+#define KF_MULJ(a) kf_mulj_avx2(a)
+#define KF_SCALE(a,s) _mm256_mul_ps(a, _mm256_set1_ps(s))
+#include "_kiss_fft_simd.h"
+#undef KF_SIMD_NAME
+#undef KF_SIMD_TARGET
+#undef KF_V
+#undef KF_W
+#undef KF_LOAD
+#undef KF_STORE
+#undef KF_TWLOAD
+#undef KF_ADD
+#undef KF_SUB
+#undef KF_CMUL
+#undef KF_MULJ
+#undef KF_SCALE
+
+static const kf_kernels kf_avx2_kernels = {
+    KISS_FFT_SIMD_256, "avx2", kf_bfly2_avx2, kf_bfly3_avx2, kf_bfly4_avx2, kf_bfly5_avx2, kf_pow2_bfly4_avx2
+};
+#endif /* KISS_FFT_HAVE_AVX2 */
+
+#ifdef KISS_FFT_HAVE_NEON
+#include <arm_neon.h>
+
+static __inline float32x4_t kf_twload_neon(const kiss_fft_cpx * tw, size_t stride)
+{
+    if (stride == 1)
+        return vld1q_f32((const float *)tw);
+    return vcombine_f32(vld1_f32((const float *)tw), vld1_f32((const float *)(tw+stride)));
+}
+
+static __inline float32x4_t kf_sign_neon(void)
+{
+    static const float sign[4] = { -1.f, 1.f, -1.f, 1.f };
+    return vld1q_f32(sign);
+}
+
+static __inline float32x4_t kf_cmul_neon(float32x4_t a, float32x4_t b)
+{
+    float32x4_t as = vmulq_f32(vrev64q_f32(a), kf_sign_neon());
+    return vfmaq_f32(vmulq_f32(a, vtrn1q_f32(b, b)), as, vtrn2q_f32(b, b));
+}
+
+static __inline float32x4_t kf_mulj_neon(float32x4_t a)
+{
+    return vmulq_f32(vrev64q_f32(a), kf_sign_neon());
+}
+
+#define KF_SIMD_NAME(f) f##_neon
+#define KF_SIMD_TARGET
+#define KF_V float32x4_t
+#define KF_W 2
+#define KF_LOAD(p) vld1q_f32((const float *)(p))
+#define KF_STORE(p,v) vst1q_f32((float *)(p), v)
+#define KF_TWLOAD(tw,stride) kf_twload_neon(tw, stride)
+#define KF_ADD(a,b) vaddq_f32(a, b)
+#define KF_SUB(a,b) vsubq_f32(a, b)
+#define KF_CMUL(a,b) kf_cmul_neon(a, b)
+#define KF_MULJ(a) kf_mulj_neon(a)
+#define KF_SCALE(a,s) vmulq_n_f32(a, s)
+#include "_kiss_fft_simd.h"
+#undef KF_SIMD_NAME
+#undef KF_SIMD_TARGET
+#undef KF_V
+#undef KF_W
+#undef KF_LOAD
+#undef KF_STORE
+#undef KF_TWLOAD
+#undef KF_ADD
+#undef KF_SUB
+#undef KF_CMUL
+#undef KF_MULJ
+#undef KF_SCALE
+
+static const kf_kernels kf_neon_kernels = {
+    KISS_FFT_SIMD_128, "neon", kf_bfly2_neon, kf_bfly3_neon, kf_bfly4_neon, kf_bfly5_neon, kf_pow2_bfly4_neon
+};
+#endif /* KISS_FFT_HAVE_NEON */
+
+#endif /* !FIXED_POINT && !USE_SIMD */
+
+/* The kernels in use. Every writer stores the same pointer for a given limit, so racing
+   initializations are harmless. */
+static const kf_kernels * kf_active_kernels = NULL;
+static int kf_simd_limit = KISS_FFT_SIMD_256;
+
+static const kf_kernels * kf_select_kernels(int max_level)
+{
+#ifdef KISS_FFT_HAVE_AVX2
+    if (max_level >= KISS_FFT_SIMD_256 && kf_cpu_has_avx2())
+        return &kf_avx2_kernels;
+#endif
+#ifdef KISS_FFT_HAVE_SSE2
+    if (max_level >= KISS_FFT_SIMD_128)
+        return &kf_sse2_kernels;
+#endif
+#ifdef KISS_FFT_HAVE_NEON
+    if (max_level >= KISS_FFT_SIMD_128)
+        return &kf_neon_kernels;
+#endif
+    (void)max_level;
+    return &kf_scalar_kernels;
+}
+
+static const kf_kernels * kf_kernels_in_use(void)
+{
+    const kf_kernels * kernels = kf_active_kernels;
+    if (kernels == NULL) {
+        kernels = kf_select_kernels(kf_simd_limit);
+        kf_active_kernels = kernels;
+    }
+    return kernels;
+}
+
+int kiss_fft_set_simd(int max_level)
+{
+    kf_simd_limit = max_level;
+    kf_active_kernels = kf_select_kernels(max_level);
+    return kf_active_kernels->level;
+}
+
+int kiss_fft_get_simd(void)
+{
+    return kf_kernels_in_use()->level;
+}
+
+const char * kiss_fft_get_simd_name(void)
+{
+    return kf_kernels_in_use()->name;
+}
+
+static void kf_bfly(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m,
+        int p
+        )
+{
+    const kf_kernels * kernels = kf_kernels_in_use();
+    switch (p) {
+        case 2: kernels->bfly2(Fout,fstride,st,m); break;
+        case 3: kernels->bfly3(Fout,fstride,st,m); break;
+        case 4: kernels->bfly4(Fout,fstride,st,m); break;
+        case 5: kernels->bfly5(Fout,fstride,st,m); break;
+        default: kf_bfly_generic(Fout,fstride,st,m,p); break;
+    }
+}
+
+/* Scheduler for transforms of at least kf_parallel_min_nfft points, see kiss_fft_set_parallel_for */
+static kiss_fft_parallel_for kf_parallel_for = NULL;
+static void * kf_parallel_context = NULL;
+static int kf_parallel_min_nfft = INT_MAX;
+
+void kiss_fft_set_parallel_for(kiss_fft_parallel_for parallel_for, void * context, int min_nfft)
+{
+    kf_parallel_for = parallel_for;
+    kf_parallel_context = context;
+    kf_parallel_min_nfft = parallel_for ? min_nfft : INT_MAX;
+}
+
+static int kf_use_parallel(const kiss_fft_cfg st)
+{
+    return kf_parallel_for != NULL && st->nfft >= kf_parallel_min_nfft;
+}
+
+/*
+ * Power of two plans.
+ *
+ * Float plans of 2^k points, k >= 5, skip the recursive kf_work. The first stage gathers the input
+ * with a mixed radix digit reversal straight into twiddle-free 8 or 4 point DFTs, and radix 4 stages
+ * follow, each with its own twiddles stored in the order it reads them. Stages whose transforms fit
+ * in KF_POW2_BLOCK points run depth first, one block at a time, so the data stays in cache; only the
+ * last few stages sweep the whole buffer.
+ */
+#if !defined(FIXED_POINT) && !defined(USE_SIMD)
+#define KF_POW2_ENGINE
+#endif
+#define KF_POW2_MIN_SIZE 32
+/* 32KB of complex floats */
+#define KF_POW2_BLOCK 4096
+/* columns of a stage per work unit when running in parallel */
+#define KF_POW2_CHUNK 1024
+
+#ifdef KF_POW2_ENGINE
+static void kf_pow2_first8(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * f,
+        size_t s,
+        int in_stride,
+        const int * offsets,
+        int nblocks,
+        int inverse
+        )
+{
+    const kiss_fft_scalar r = (kiss_fft_scalar)0.707106781186547524400844362104849039;
+    int j;
+    for (j=0; j<nblocks; ++j) {
+        const kiss_fft_cpx * x = f + (size_t)offsets[j]*in_stride;
+        kiss_fft_cpx a0,a1,a2,a3,a4,a5,a6,a7;
+        kiss_fft_cpx e0,e1,e2,e3,o0,o1,o2,o3,t;
+
+        C_ADD(a0, x[0], x[4*s]); C_SUB(a1, x[0], x[4*s]);
+        C_ADD(a2, x[2*s], x[6*s]); C_SUB(a3, x[2*s], x[6*s]);
+        C_ADD(a4, x[s], x[5*s]); C_SUB(a5, x[s], x[5*s]);
+        C_ADD(a6, x[3*s], x[7*s]); C_SUB(a7, x[3*s], x[7*s]);
+
+        /* a3, a7 times -i (forward) or i (inverse) */
+        t = a3;
+        a3.r = inverse ? -t.i : t.i; a3.i = inverse ? t.r : -t.r;
+        t = a7;
+        a7.r = inverse ? -t.i : t.i; a7.i = inverse ? t.r : -t.r;
+
+        /* 4 point DFTs of the even and odd inputs */
+        C_ADD(e0, a0, a2); C_SUB(e2, a0, a2); C_ADD(e1, a1, a3); C_SUB(e3, a1, a3);
+        C_ADD(o0, a4, a6); C_SUB(o2, a4, a6); C_ADD(o1, a5, a7); C_SUB(o3, a5, a7);
+
+        /* odd outputs times w^k, w = exp(-+i pi/4) */
+        if (inverse) {
+            t = o1; o1.r = r*(t.r - t.i); o1.i = r*(t.r + t.i);
+            t = o2; o2.r = -t.i; o2.i = t.r;
+            t = o3; o3.r = -r*(t.r + t.i); o3.i = r*(t.r - t.i);
+        }else{
+            t = o1; o1.r = r*(t.r + t.i); o1.i = r*(t.i - t.r);
+            t = o2; o2.r = t.i; o2.i = -t.r;
+            t = o3; o3.r = r*(t.i - t.r); o3.i = -r*(t.r + t.i);
+        }
+
+        C_ADD(Fout[0], e0, o0); C_SUB(Fout[4], e0, o0);
+        C_ADD(Fout[1], e1, o1); C_SUB(Fout[5], e1, o1);
+        C_ADD(Fout[2], e2, o2); C_SUB(Fout[6], e2, o2);
+        C_ADD(Fout[3], e3, o3); C_SUB(Fout[7], e3, o3);
+        Fout += 8;
+    }
+}
+
+static void kf_pow2_first4(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * f,
+        size_t s,
+        int in_stride,
+        const int * offsets,
+        int nblocks,
+        int inverse
+        )
+{
+    int j;
+    for (j=0; j<nblocks; ++j) {
+        const kiss_fft_cpx * x = f + (size_t)offsets[j]*in_stride;
+        kiss_fft_cpx a0,a1,a2,a3;
+
+        C_ADD(a0, x[0], x[2*s]); C_SUB(a1, x[0], x[2*s]);
+        C_ADD(a2, x[s], x[3*s]); C_SUB(a3, x[s], x[3*s]);
+
+        C_ADD(Fout[0], a0, a2); C_SUB(Fout[2], a0, a2);
+        if (inverse) {
+            Fout[1].r = a1.r - a3.i; Fout[1].i = a1.i + a3.r;
+            Fout[3].r = a1.r + a3.i; Fout[3].i = a1.i - a3.r;
+        }else{
+            Fout[1].r = a1.r + a3.i; Fout[1].i = a1.i - a3.r;
+            Fout[3].r = a1.r - a3.i; Fout[3].i = a1.i + a3.r;
+        }
+        Fout += 4;
+    }
+}
+
+/* Radix 4 stages combining transforms of length m up to length 4m, over nfft points of Fout */
+static void kf_pow2_stage(
+        const kf_kernels * kernels,
+        kiss_fft_cpx * Fout,
+        int nfft,
+        const kiss_fft_cpx * tw,
+        int m,
+        int inverse
+        )
+{
+    int g;
+    for (g=0; g<nfft; g+=4*m)
+        kernels->pow2_bfly4(Fout+g, tw, m, m, inverse);
+}
+
+typedef struct {
+    const kf_kernels * kernels;
+    kiss_fft_cpx * Fout;
+    const kiss_fft_cpx * f;
+    int in_stride;
+    kiss_fft_cfg st;
+    int block;
+    /* stage spanning several blocks: its twiddles, input length and columns per work unit */
+    const kiss_fft_cpx * tw;
+    int m;
+    int chunk;
+} kf_pow2_job;
+
+/* The first stage and every stage within block b */
+static void kf_pow2_block(void * arg, int b)
+{
+    const kf_pow2_job * job = (const kf_pow2_job *)arg;
+    const kiss_fft_cfg st = job->st;
+    const int first = st->pow2_first;
+    const int base = b * job->block;
+    /* distance between the inputs of one first stage DFT */
+    const size_t s = (size_t)(st->nfft/first) * job->in_stride;
+    const kiss_fft_cpx * tw = st->pow2_twiddles;
+    int m;
+
+    if (first == 8)
+        kf_pow2_first8(job->Fout+base, job->f, s, job->in_stride, st->pow2_offsets+base/8, job->block/8, st->inverse);
+    else
+        kf_pow2_first4(job->Fout+base, job->f, s, job->in_stride, st->pow2_offsets+base/4, job->block/4, st->inverse);
+    for (m=first; m<job->block; m*=4) {
+        kf_pow2_stage(job->kernels, job->Fout+base, job->block, tw, m, st->inverse);
+        tw += 3*m;
+    }
+}
+
+/* Columns [i * chunk, (i + 1) * chunk) of job->m's stage, counting across its groups */
+static void kf_pow2_chunk(void * arg, int i)
+{
+    const kf_pow2_job * job = (const kf_pow2_job *)arg;
+    const int chunks_per_group = job->m / job->chunk;
+    const int g = (i / chunks_per_group) * 4 * job->m;
+    const int k0 = (i % chunks_per_group) * job->chunk;
+    job->kernels->pow2_bfly4(job->Fout+g+k0, job->tw+k0, job->m, job->chunk, job->st->inverse);
+}
+
+static void kf_pow2_work(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * f,
+        int in_stride,
+        const kiss_fft_cfg st
+        )
+{
+    const int nfft = st->nfft;
+    const int parallel = kf_use_parallel(st);
+    kf_pow2_job job;
+    const kiss_fft_cpx * tw = st->pow2_twiddles;
+    int b, m;
+
+    job.kernels = kf_kernels_in_use();
+    job.Fout = Fout;
+    job.f = f;
+    job.in_stride = in_stride;
+    job.st = st;
+    job.block = st->pow2_first;
+    while (job.block*4 <= nfft && job.block*4 <= KF_POW2_BLOCK)
+        job.block *= 4;
+
+    /* blocks are independent, so they are what gets spread over workers first */
+    if (parallel && job.block < nfft)
+        kf_parallel_for(kf_parallel_context, nfft/job.block, kf_pow2_block, &job);
+    else
+        for (b=0; b<nfft/job.block; ++b)
+            kf_pow2_block(&job, b);
+
+    for (m=st->pow2_first; m<job.block; m*=4)
+        tw += 3*m;
+    for (; m<nfft; m*=4) {
+        if (parallel) {
+            job.tw = tw;
+            job.m = m;
+            job.chunk = m < KF_POW2_CHUNK ? m : KF_POW2_CHUNK;
+            kf_parallel_for(kf_parallel_context, nfft/(4*job.chunk), kf_pow2_chunk, &job);
+        }else{
+            kf_pow2_stage(job.kernels, Fout, nfft, tw, m, st->inverse);
+        }
+        tw += 3*m;
+    }
+}
+#endif /* KF_POW2_ENGINE */
+
+#ifdef KF_POW2_ENGINE
+static int kf_pow2_enabled = 1;
+#endif
+
+int kiss_fft_set_pow2_engine(int enabled)
+{
+#ifdef KF_POW2_ENGINE
+    kf_pow2_enabled = enabled != 0;
+    return kf_pow2_enabled;
+#else
+    (void)enabled;
+    return 0;
+#endif
+}
+
+/* Radix of the first stage of the iterative plan for nfft points, or 0 to use kf_work */
+static int kf_pow2_first_radix(int nfft)
+{
+#ifdef KF_POW2_ENGINE
+    int bits = 0;
+    if (!kf_pow2_enabled || nfft < KF_POW2_MIN_SIZE || (nfft & (nfft-1)) != 0)
+        return 0;
+    while ((1<<bits) < nfft)
+        ++bits;
+    return (bits & 1) ? 8 : 4;
+#else
+    (void)nfft;
+    return 0;
+#endif
+}
+
+static
+void kf_work(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * f,
+        const size_t fstride,
+        int in_stride,
+        int * factors,
+        const kiss_fft_cfg st
+        );
+
+/* One of the p smaller DFTs of kf_work's top level */
+typedef struct {
+    kiss_fft_cpx * Fout;
+    const kiss_fft_cpx * f;
+    size_t fstride;
+    int in_stride;
+    int * factors;
+    kiss_fft_cfg st;
+    int p;
+    int m;
+} kf_work_job;
+
+static void kf_work_unit(void * arg, int k)
+{
+    const kf_work_job * job = (const kf_work_job *)arg;
+    kf_work( job->Fout + k*job->m, job->f + job->fstride*job->in_stride*k, job->fstride*job->p, job->in_stride, job->factors, job->st);
+}
+
 static
 void kf_work(
         kiss_fft_cpx * Fout,
@@ -249,29 +907,27 @@ void kf_work(
     const int m=*factors++; /* stage's fft length/p */
     const kiss_fft_cpx * Fout_end = Fout + p*m;
 
-#ifdef _OPENMP
-    // use openmp extensions at the 
-    // top-level (not recursive)
-    if (fstride==1 && p<=5)
+    // split the first stage across the scheduler's workers
+    // at the top-level (not recursive)
+    if (fstride==1 && p<=5 && kf_use_parallel(st))
     {
-        int k;
-
-        // execute the p different work units in different threads
-#       pragma omp parallel for
-        for (k=0;k<p;++k) 
-            kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st);
-        // all threads have joined by this point
-
-        switch (p) {
-            case 2: kf_bfly2(Fout,fstride,st,m); break;
-            case 3: kf_bfly3(Fout,fstride,st,m); break; 
-            case 4: kf_bfly4(Fout,fstride,st,m); break;
-            case 5: kf_bfly5(Fout,fstride,st,m); break; 
-            default: kf_bfly_generic(Fout,fstride,st,m,p); break;
-        }
+        kf_work_job job;
+        job.Fout = Fout;
+        job.f = f;
+        job.fstride = fstride;
+        job.in_stride = in_stride;
+        job.factors = factors;
+        job.st = st;
+        job.p = p;
+        job.m = m;
+
+        // execute the p different work units on different threads
+        kf_parallel_for(kf_parallel_context, p, kf_work_unit, &job);
+        // all work units have finished by this point
+
+        kf_bfly(Fout,fstride,st,m,p);
         return;
     }
-#endif
 
     if (m==1) {
         do{
@@ -292,13 +948,7 @@ void kf_work(
     Fout=Fout_beg;
 
     // recombine the p smaller DFTs 
-    switch (p) {
-        case 2: kf_bfly2(Fout,fstride,st,m); break;
-        case 3: kf_bfly3(Fout,fstride,st,m); break; 
-        case 4: kf_bfly4(Fout,fstride,st,m); break;
-        case 5: kf_bfly5(Fout,fstride,st,m); break; 
-        default: kf_bfly_generic(Fout,fstride,st,m,p); break;
-    }
+    kf_bfly(Fout,fstride,st,m,p);
 }
 
 /*  facbuf is populated by p1,m1,p2,m2, ...
@@ -333,14 +983,38 @@ void kf_factor(int n,int * facbuf)
  *
  * User-callable function to allocate all necessary storage space for the fft.
  *
- * The return value is a contiguous block of memory, allocated with malloc.  As such,
- * It can be freed with free(), rather than a kiss_fft-specific function.
+ * The return value is a contiguous block of memory, allocated with KISS_FFT_MALLOC.  As such,
+ * It can be freed with kiss_fft_free().
  * */
+#ifndef USE_SIMD
+void * kiss_fft_aligned_malloc(size_t nbytes)
+{
+    /* over-allocate and keep the pointer malloc returned just below the aligned block */
+    unsigned char * raw = (unsigned char *)malloc(nbytes + KISS_FFT_ALIGNMENT + sizeof(void *));
+    unsigned char * aligned;
+    if (raw == NULL)
+        return NULL;
+    aligned = (unsigned char *)(((size_t)(raw + sizeof(void *)) + KISS_FFT_ALIGNMENT - 1) & ~(size_t)(KISS_FFT_ALIGNMENT - 1));
+    ((void **)aligned)[-1] = raw;
+    return aligned;
+}
+
+void kiss_fft_aligned_free(void * ptr)
+{
+    if (ptr != NULL)
+        free(((void **)ptr)[-1]);
+}
+#endif
+
 kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
 {
     kiss_fft_cfg st=NULL;
+    const int pow2_first = kf_pow2_first_radix(nfft);
     size_t memneeded = sizeof(struct kiss_fft_state)
         + sizeof(kiss_fft_cpx)*(nfft-1); /* twiddle factors*/
+    if (pow2_first)
+        memneeded += sizeof(kiss_fft_cpx)*nfft   /* per stage twiddles, 3 * (nfft/4 + nfft/16 + ...) at most */
+            + sizeof(int)*(nfft/pow2_first);     /* first stage offsets */
 
     if ( lenmem==NULL ) {
         st = ( kiss_fft_cfg)KISS_FFT_MALLOC( memneeded );
@@ -363,6 +1037,38 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         }
 
         kf_factor(nfft,st->factors);
+
+        st->pow2_first = pow2_first;
+        st->pow2_twiddles = NULL;
+        st->pow2_offsets = NULL;
+        if (pow2_first) {
+            const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+            kiss_fft_cpx * tw = st->twiddles + nfft;
+            int nblocks = nfft/pow2_first;
+            int m, k, a, j;
+            st->pow2_twiddles = tw;
+            for (m=pow2_first; m<nfft; m*=4) {
+                for (a=1; a<=3; ++a) {
+                    for (k=0; k<m; ++k) {
+                        double phase = -2*pi*a*k / (4*m);
+                        if (st->inverse)
+                            phase *= -1;
+                        kf_cexp(tw, phase);
+                        ++tw;
+                    }
+                }
+            }
+            /* base 4 digit reversal of the first stage DFT index */
+            st->pow2_offsets = (int*)(st->pow2_twiddles + nfft);
+            for (j=0; j<nblocks; ++j) {
+                int rev = 0, rest = j, span;
+                for (span=1; span<nblocks; span*=4) {
+                    rev = rev*4 + (rest & 3);
+                    rest >>= 2;
+                }
+                st->pow2_offsets[j] = rev;
+            }
+        }
     }
     return st;
 }
@@ -374,10 +1080,16 @@ void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,
         //NOTE: this is not really an in-place FFT algorithm.
         //It just performs an out-of-place FFT into a temp buffer
         kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
-        kf_work(tmpbuf,fin,1,in_stride, st->factors,st);
+        kiss_fft_stride(st,fin,tmpbuf,in_stride);
         memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
         KISS_FFT_TMP_FREE(tmpbuf);
     }else{
+#ifdef KF_POW2_ENGINE
+        if (st->pow2_first) {
+            kf_pow2_work( fout, fin, in_stride, st );
+            return;
+        }
+#endif
         kf_work( fout, fin, 1,in_stride, st->factors,st );
     }
 }
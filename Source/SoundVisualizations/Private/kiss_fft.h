@@ -29,13 +29,15 @@ extern "C" {
 #define KISS_FFT_MALLOC(nbytes) _mm_malloc(nbytes,16)
 #define KISS_FFT_FREE _mm_free
 #else	
-#define KISS_FFT_MALLOC malloc
-#define KISS_FFT_FREE free
+/* state buffers are cache line aligned so the vector butterflies never split a twiddle load */
+#define KISS_FFT_ALIGNMENT 64
+#define KISS_FFT_MALLOC kiss_fft_aligned_malloc
+#define KISS_FFT_FREE kiss_fft_aligned_free
 #endif	
 
 
 #ifdef FIXED_POINT
-#include <sys/types.h>	
+#include <stdint.h>
 # if (FIXED_POINT == 32)
 #  define kiss_fft_scalar int32_t
 # else	
@@ -65,8 +67,8 @@ typedef struct kiss_fft_state* kiss_fft_cfg;
  *  The return value from fft_alloc is a cfg buffer used internally
  *  by the fft routine or NULL.
  *
- *  If lenmem is NULL, then kiss_fft_alloc will allocate a cfg buffer using malloc.
- *  The returned value should be free()d when done to avoid memory leaks.
+ *  If lenmem is NULL, then kiss_fft_alloc will allocate a cfg buffer using KISS_FFT_MALLOC.
+ *  The returned value should be released with kiss_fft_free when done to avoid memory leaks.
  *  
  *  The state can be placed in a user supplied buffer 'mem':
  *  If lenmem is not NULL and mem is not NULL and *lenmem is large enough,
@@ -98,8 +100,54 @@ void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
 void kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int fin_stride);
 
 /* If kiss_fft_alloc allocated a buffer, it is one contiguous 
-   buffer and can be simply free()d when no longer needed*/
-#define kiss_fft_free free
+   buffer and can be simply kiss_fft_free()d when no longer needed*/
+#define kiss_fft_free KISS_FFT_FREE
+
+#ifndef USE_SIMD
+/* malloc/free for blocks aligned to KISS_FFT_ALIGNMENT bytes */
+void * kiss_fft_aligned_malloc(size_t nbytes);
+void kiss_fft_aligned_free(void * ptr);
+#endif
+
+/*
+ * Vector butterflies.
+ *
+ * Float builds pick the widest butterflies the CPU supports the first time an FFT runs:
+ * SSE2 or AVX2+FMA on x86, NEON on AArch64. Results match the scalar code to rounding.
+ *
+ * kiss_fft_set_simd limits the choice to vectors of at most the given width, e.g.
+ * KISS_FFT_SIMD_NONE to force the scalar butterflies, and returns the width now in use.
+ * Call it before starting FFTs on other threads.
+ */
+#define KISS_FFT_SIMD_NONE 0
+#define KISS_FFT_SIMD_128 1
+#define KISS_FFT_SIMD_256 2
+
+int kiss_fft_set_simd(int max_level);
+int kiss_fft_get_simd(void);
+/* "scalar", "sse2", "avx2" or "neon" */
+const char * kiss_fft_get_simd_name(void);
+
+/*
+ * Power of two plans of at least 32 points run on an iterative engine instead of the recursive
+ * kf_work. kiss_fft_set_pow2_engine(0) makes plans allocated afterwards use kf_work, to compare the
+ * two; it returns whether the engine is now enabled, which is always 0 in fixed point builds.
+ */
+int kiss_fft_set_pow2_engine(int enabled);
+
+/*
+ * Parallel transforms.
+ *
+ * Transforms of at least min_nfft points split their first stage, and for power of two sizes the
+ * stages after it, into work units handed to parallel_for. It must call fn(arg, i) once for every
+ * i in [0, count), on any threads and in any order, and return when all calls have finished.
+ * Passing NULL, the default, runs everything on the calling thread. Call it before starting FFTs
+ * on other threads.
+ */
+typedef void (*kiss_fft_parallel_fn)(void * arg, int index);
+typedef void (*kiss_fft_parallel_for)(void * context, int count, kiss_fft_parallel_fn fn, void * arg);
+
+void kiss_fft_set_parallel_for(kiss_fft_parallel_for parallel_for, void * context, int min_nfft);
 
 /*
  Cleans up some memory that gets managed internally. Not necessary to call, but it might clean up 
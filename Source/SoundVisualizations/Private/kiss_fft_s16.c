@@ -0,0 +1,25 @@
+/*
+ Builds kiss_fft.c and kiss_fftr.c a second time with FIXED_POINT 16, giving every external
+ symbol an _s16 name so both builds link into the same module. See kiss_fft_s16.h.
+*/
+#define FIXED_POINT 16
+
+#define kiss_fft kiss_fft_s16
+#define kiss_fft_stride kiss_fft_s16_stride
+#define kiss_fft_alloc kiss_fft_s16_alloc
+#define kiss_fft_cleanup kiss_fft_s16_cleanup
+#define kiss_fft_next_fast_size kiss_fft_s16_next_fast_size
+#define kiss_fft_set_simd kiss_fft_s16_set_simd
+#define kiss_fft_get_simd kiss_fft_s16_get_simd
+#define kiss_fft_get_simd_name kiss_fft_s16_get_simd_name
+#define kiss_fft_set_parallel_for kiss_fft_s16_set_parallel_for
+#define kiss_fft_set_pow2_engine kiss_fft_s16_set_pow2_engine
+#define kiss_fft_aligned_malloc kiss_fft_s16_aligned_malloc
+#define kiss_fft_aligned_free kiss_fft_s16_aligned_free
+#define kiss_fftr kiss_fftr_s16
+#define kiss_fftr_alloc kiss_fftr_s16_alloc
+#define kiss_fftr_scratch kiss_fftr_s16_scratch
+#define kiss_fftri kiss_fftri_s16
+
+#include "kiss_fft.c"
+#include "tools/kiss_fftr.c"
@@ -0,0 +1,44 @@
+#ifndef KISS_FFT_S16_H
+#define KISS_FFT_S16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ 16 bit fixed point (Q15) build of kiss_fft and kiss_fftr, linked alongside the float one.
+
+ Each function behaves like its float counterpart without the _s16, except for scaling: every
+ stage divides by its radix to avoid overflow, so forward transforms come out divided by nfft.
+*/
+
+typedef struct {
+    int16_t r;
+    int16_t i;
+}kiss_fft_s16_cpx;
+
+typedef struct kiss_fft_s16_state* kiss_fft_s16_cfg;
+typedef struct kiss_fftr_s16_state* kiss_fftr_s16_cfg;
+
+kiss_fft_s16_cfg kiss_fft_s16_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem);
+void kiss_fft_s16(kiss_fft_s16_cfg cfg,const kiss_fft_s16_cpx *fin,kiss_fft_s16_cpx *fout);
+void kiss_fft_s16_stride(kiss_fft_s16_cfg cfg,const kiss_fft_s16_cpx *fin,kiss_fft_s16_cpx *fout,int fin_stride);
+
+kiss_fftr_s16_cfg kiss_fftr_s16_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem);
+void kiss_fftr_s16(kiss_fftr_s16_cfg cfg,const int16_t *timedata,kiss_fft_s16_cpx *freqdata);
+/* tmpbuf holds nfft/2 complex points, as for kiss_fftr_scratch */
+void kiss_fftr_s16_scratch(kiss_fftr_s16_cfg cfg,const int16_t *timedata,kiss_fft_s16_cpx *freqdata,kiss_fft_s16_cpx *tmpbuf);
+void kiss_fftri_s16(kiss_fftr_s16_cfg cfg,const kiss_fft_s16_cpx *freqdata,int16_t *timedata);
+
+void kiss_fft_s16_aligned_free(void * ptr);
+#define kiss_fft_s16_free kiss_fft_s16_aligned_free
+#define kiss_fftr_s16_free kiss_fft_s16_aligned_free
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
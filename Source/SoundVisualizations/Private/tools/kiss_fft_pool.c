@@ -0,0 +1,145 @@
+/*
+ Work stealing thread pool driving kiss_fft_set_parallel_for in standalone builds.
+ See kiss_fft_pool.h.
+*/
+#ifdef KISS_FFT_POOL
+
+#include <pthread.h>
+#include "kiss_fft_pool.h"
+
+#define KFP_MAX_THREADS 64
+
+/* One thread's share of the current job. Anyone may take indices from it; a cache line each. */
+typedef struct {
+    int next;
+    int end;
+    char pad[64 - 2*sizeof(int)];
+} kfp_share;
+
+static struct {
+    pthread_t threads[KFP_MAX_THREADS];
+    int nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int generation;
+    int stopping;
+    int busy;
+    kiss_fft_parallel_fn fn;
+    void * arg;
+    /* the workers' shares, then the caller's */
+    kfp_share shares[KFP_MAX_THREADS + 1];
+} kfp;
+
+static int kfp_take(kfp_share * share)
+{
+    int i = __atomic_fetch_add(&share->next, 1, __ATOMIC_RELAXED);
+    return i < share->end ? i : -1;
+}
+
+/* Drains share self, then steals from the others */
+static void kfp_run(int self)
+{
+    const int nshares = kfp.nthreads + 1;
+    int v, i;
+    for (v=0; v<nshares; ++v) {
+        kfp_share * share = &kfp.shares[(self + v) % nshares];
+        while ((i = kfp_take(share)) >= 0)
+            kfp.fn(kfp.arg, i);
+    }
+}
+
+static void * kfp_worker(void * param)
+{
+    const int self = (int)(size_t)param;
+    int seen = 0;
+    pthread_mutex_lock(&kfp.lock);
+    for (;;) {
+        while (!kfp.stopping && kfp.generation == seen)
+            pthread_cond_wait(&kfp.wake, &kfp.lock);
+        if (kfp.stopping)
+            break;
+        seen = kfp.generation;
+        pthread_mutex_unlock(&kfp.lock);
+
+        kfp_run(self);
+
+        pthread_mutex_lock(&kfp.lock);
+        if (--kfp.busy == 0)
+            pthread_cond_signal(&kfp.done);
+    }
+    pthread_mutex_unlock(&kfp.lock);
+    return NULL;
+}
+
+static void kfp_parallel_for(void * context, int count, kiss_fft_parallel_fn fn, void * arg)
+{
+    const int nshares = kfp.nthreads + 1;
+    int t;
+    (void)context;
+    if (count <= 1 || kfp.nthreads == 0) {
+        for (t=0; t<count; ++t)
+            fn(arg, t);
+        return;
+    }
+
+    pthread_mutex_lock(&kfp.lock);
+    kfp.fn = fn;
+    kfp.arg = arg;
+    for (t=0; t<nshares; ++t) {
+        kfp.shares[t].next = (int)((long long)count * t / nshares);
+        kfp.shares[t].end = (int)((long long)count * (t + 1) / nshares);
+    }
+    kfp.busy = kfp.nthreads;
+    ++kfp.generation;
+    pthread_cond_broadcast(&kfp.wake);
+    pthread_mutex_unlock(&kfp.lock);
+
+    kfp_run(kfp.nthreads);
+
+    pthread_mutex_lock(&kfp.lock);
+    while (kfp.busy > 0)
+        pthread_cond_wait(&kfp.done, &kfp.lock);
+    pthread_mutex_unlock(&kfp.lock);
+}
+
+int kiss_fft_pool_start(int nthreads, int min_nfft)
+{
+    int t;
+    kiss_fft_pool_stop();
+    if (nthreads > KFP_MAX_THREADS)
+        nthreads = KFP_MAX_THREADS;
+    pthread_mutex_init(&kfp.lock, NULL);
+    pthread_cond_init(&kfp.wake, NULL);
+    pthread_cond_init(&kfp.done, NULL);
+    kfp.stopping = 0;
+    kfp.generation = 0;
+    kfp.nthreads = 0;
+    for (t=0; t<nthreads; ++t) {
+        if (pthread_create(&kfp.threads[t], NULL, kfp_worker, (void *)(size_t)t) != 0)
+            break;
+        ++kfp.nthreads;
+    }
+    kiss_fft_set_parallel_for(kfp_parallel_for, NULL, min_nfft);
+    return kfp.nthreads;
+}
+
+void kiss_fft_pool_stop(void)
+{
+    int t;
+    if (kfp.nthreads == 0)
+        return;
+    kiss_fft_set_parallel_for(NULL, NULL, 0);
+    pthread_mutex_lock(&kfp.lock);
+    kfp.stopping = 1;
+    pthread_cond_broadcast(&kfp.wake);
+    pthread_mutex_unlock(&kfp.lock);
+    for (t=0; t<kfp.nthreads; ++t)
+        pthread_join(kfp.threads[t], NULL);
+    kfp.nthreads = 0;
+    pthread_mutex_destroy(&kfp.lock);
+    pthread_cond_destroy(&kfp.wake);
+    pthread_cond_destroy(&kfp.done);
+}
+
+#endif /* KISS_FFT_POOL */
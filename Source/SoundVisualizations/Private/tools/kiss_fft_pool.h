@@ -0,0 +1,31 @@
+#ifndef KISS_FFT_POOL_H
+#define KISS_FFT_POOL_H
+#include "kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ kiss_fft_pool -- a small work stealing thread pool for standalone builds
+
+ Hosts with a task scheduler of their own should hand it to kiss_fft_set_parallel_for instead.
+ The pool is only compiled when KISS_FFT_POOL is defined, and needs POSIX threads.
+
+ Each parallel_for splits its indices evenly between the workers and the calling thread, which
+ joins in. Whoever runs out of its own share takes indices from the others' shares, so uneven
+ work units still keep every thread busy. One parallel_for runs at a time, and work units must
+ not start another.
+*/
+
+/* Starts nthreads workers and installs the pool for transforms of at least min_nfft points. */
+int kiss_fft_pool_start(int nthreads, int min_nfft);
+
+/* Uninstalls the pool and joins its workers. */
+void kiss_fft_pool_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -32,13 +32,19 @@ void kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *f
  output freqdata has nfft/2+1 complex points
 */
 
+void kiss_fftr_scratch(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *tmpbuf);
+/*
+ same as kiss_fftr, but uses the caller's tmpbuf of nfft/2 complex points instead of the one
+ inside cfg, so one cfg can be shared by several threads
+*/
+
 void kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata);
 /*
  input freqdata has  nfft/2+1 complex points
  output timedata has nfft scalar points
 */
 
-#define kiss_fftr_free free
+#define kiss_fftr_free KISS_FFT_FREE
 
 #ifdef __cplusplus
 }
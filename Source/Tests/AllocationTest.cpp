@@ -0,0 +1,159 @@
+// Checks that analyzing a frame and reading its results does not touch the heap once warmed up.
+//
+// Every operator new is counted; the shim's FMemory::Malloc goes through it too, so TArray growth
+// shows up. Each frame runs what a level full of analyzers does per tick: the decoder writes a
+// buffer, one engine analyzes the window heard now, two more share a TransformPending, a stream
+// catches up on its hops, and every result is read out both through the native TArrayView copies
+// and the way the Blueprint calls do it, Reset and AddUninitialized on an array the caller reuses,
+// including calls for channels that do not exist. A few warm-up frames may allocate; none after.
+
+#include "TestHelpers.h"
+#include "SpectrumAnalysis.h"
+#include "STFTStream.h"
+
+#include <new>
+
+namespace
+{
+	volatile int64 GNumAllocations = 0;
+}
+
+void* operator new(size_t Size)
+{
+	FPlatformAtomics::InterlockedIncrement(&GNumAllocations);
+	void* Result = malloc(Size > 0 ? Size : 1);
+	if (Result == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return Result;
+}
+
+// Kept out of line: inlined into a delete expression, GCC takes the free for a mismatch with new
+__attribute__((noinline)) void operator delete(void* Ptr) noexcept
+{
+	free(Ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* Ptr, size_t) noexcept
+{
+	free(Ptr);
+}
+
+namespace
+{
+	const uint32 NumChannels = 2;
+	const uint32 SampleRate = 48000;
+	const uint32 BufferFrames = 1024;
+
+	FSpectrumAnalysisSettings MakeSettings(float WindowSeconds, int32 SpectrumWidth)
+	{
+		FSpectrumAnalysisSettings Settings;
+		Settings.WindowDurationInSeconds = WindowSeconds;
+		Settings.SpectrumWidth = SpectrumWidth;
+		Settings.AmplitudeBuckets = 10;
+		Settings.WindowType = ESpectrumWindowType::Hann;
+		Settings.BandScale = ESpectrumBandScale::Logarithmic;
+		Settings.MinFrequency = 20.f;
+		Settings.OctaveFraction = 3;
+		Settings.HopFraction = 0.5f;
+		Settings.Backend = ESpectrumAnalysisBackend::Native;
+		return Settings;
+	}
+
+	/** What CalculateFrequencySpectrum does with the Blueprint's array */
+	void CopyLikeBlueprint(const FSpectrumAnalysisResult& Result, int32 Channel, TArray<float>& Out)
+	{
+		const bool bValid = Channel >= 0 && Channel <= (int32)Result.NumChannels;
+		Out.Reset(Result.SpectrumWidth);
+		Out.AddUninitialized(Result.SpectrumWidth);
+		FSpectrumAnalysisResult::CopyValues(bValid ? Result.GetSpectrum(Channel) : nullptr, bValid ? Result.SpectrumWidth : 0, Out);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int32 NumFrames = argc > 1 ? atoi(argv[1]) : 2000;
+	const int32 NumWarmupFrames = 8;
+
+	const FSpectrumAnalysisSettings Settings = MakeSettings(0.04f, 64);
+	const FSpectrumAnalysisSettings OtherSettings = MakeSettings(0.02f, 32);
+
+	TSharedPtr<FAudioRingBuffer, ESPMode::ThreadSafe> Ring = MakeShareable(new FAudioRingBuffer(NumChannels, SampleRate, SampleRate * 2));
+	std::vector<int16> Audio(BufferFrames * NumChannels * 64);
+	MakeTestAudio(Audio.data(), NumChannels, BufferFrames * 64, SampleRate);
+
+	FSpectrumAnalysisEngine Engine, FixedEngine, BatchEngines[2];
+	FixedEngine.SetFixedPoint(true);
+	FSpectrumAnalysisResult Result, FixedResult, BatchResults[2];
+	FSTFTStream Stream;
+
+	TArray<float> BlueprintSpectrum;
+	float NativeSpectrum[64];
+	float NativeAmplitude[10];
+
+	int64 WarmupAllocations = 0;
+	int64 NumAnalyses = 0;
+	uint64 FramesWritten = 0;
+	for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+	{
+		if (Frame == NumWarmupFrames)
+		{
+			WarmupAllocations = GNumAllocations;
+			FPlatformAtomics::InterlockedExchange(&GNumAllocations, 0);
+		}
+
+		const int16* Buffer = Audio.data() + (Frame % 64) * BufferFrames * NumChannels;
+		FramesWritten += BufferFrames;
+		Ring->Write(Buffer, BufferFrames, FTimespan::FromSeconds((double)FramesWritten / SampleRate));
+		// Playback trails the decoder by a buffer
+		const FTimespan PlaybackTime = FTimespan::FromSeconds((double)(FramesWritten - BufferFrames) / SampleRate);
+
+		FSpectrumAnalysisWindow Window;
+		if (FSpectrumAnalysisEngine::FindWindow(Settings, *Ring, PlaybackTime, Window))
+		{
+			NumAnalyses += Engine.AnalyzeWindow(Settings, *Ring, Window, PlaybackTime, Result) ? 1 : 0;
+			FixedEngine.AnalyzeWindow(Settings, *Ring, Window, PlaybackTime, FixedResult);
+
+			FSpectrumAnalysisEngine* Engines[2] = { &BatchEngines[0], &BatchEngines[1] };
+			const bool bBegun0 = BatchEngines[0].BeginAnalyzeWindow(Settings, *Ring, Window, PlaybackTime, BatchResults[0]);
+			FSpectrumAnalysisWindow OtherWindow;
+			const bool bBegun1 = FSpectrumAnalysisEngine::FindWindow(OtherSettings, *Ring, PlaybackTime, OtherWindow)
+				&& BatchEngines[1].BeginAnalyzeWindow(OtherSettings, *Ring, OtherWindow, PlaybackTime, BatchResults[1]);
+			FSpectrumAnalysisEngine::TransformPending(Engines, 2);
+			if (bBegun0)
+			{
+				BatchEngines[0].EndAnalyze(BatchResults[0]);
+			}
+			if (bBegun1)
+			{
+				BatchEngines[1].EndAnalyze(BatchResults[1]);
+			}
+		}
+
+		Stream.Process(Settings, Ring);
+		const FSpectrumAnalysisResult* StreamFrame = Stream.FindFrame(PlaybackTime);
+
+		const FSpectrumAnalysisResult* Reads[] = { &Result, &FixedResult, &BatchResults[0], &BatchResults[1], StreamFrame };
+		for (const FSpectrumAnalysisResult* Read : Reads)
+		{
+			if (Read == nullptr || Read->SpectrumWidth == 0)
+			{
+				continue;
+			}
+			for (int32 Channel = -1; Channel <= (int32)NumChannels + 1; ++Channel)
+			{
+				CopyLikeBlueprint(*Read, Channel, BlueprintSpectrum);
+			}
+			Read->CopySpectrum(0, TArrayView<float>(NativeSpectrum, ARRAY_COUNT(NativeSpectrum)));
+			Read->CopyAmplitude(1, TArrayView<float>(NativeAmplitude, ARRAY_COUNT(NativeAmplitude)));
+		}
+	}
+
+	printf("%lld allocations while warming up, %lld over %d frames and %lld analyses after\n", (long long)WarmupAllocations,
+		(long long)GNumAllocations, NumFrames, (long long)NumAnalyses);
+	TEST_CHECK(NumAnalyses > 0, "nothing was analyzed");
+	TEST_CHECK(Stream.GetNumFrames() > 0, "the stream produced no frames");
+	TEST_CHECK(GNumAllocations == 0, "%lld allocations after warming up", (long long)GNumAllocations);
+	return GNumFailedChecks;
+}
@@ -0,0 +1,140 @@
+// How fast SpectrogramBaker analyzes a sound as workers are added, and what a bake reads back as.
+//
+// Every hop of a few minutes of stereo audio is analyzed on 1 worker, then 2, up to one per core and
+// at least 4, so the order segments finish in is shuffled even on small machines.
+// Each run must give bit for bit the frames of the single worker run, and is reported in seconds of
+// audio analyzed per second. Then the sound is baked to disk at 1 and 2 bytes a value, streamed a
+// segment at a time from every worker, and every frame read back must match the analysis to within half a
+// quantization step of the levels fixed by the loudest sample.
+//
+//   BakerBench [seconds of audio]
+
+#include "TestHelpers.h"
+#include "SpectrogramBaker.h"
+
+namespace
+{
+	bool SameFrames(const FSpectrogramFrames& A, const FSpectrogramFrames& B)
+	{
+		return A.GetNumFrames() == B.GetNumFrames() && A.Spectra.Num() == B.Spectra.Num() && A.Amplitudes.Num() == B.Amplitudes.Num()
+			&& FMemory::Memcmp(A.Times.GetData(), B.Times.GetData(), A.Times.Num() * sizeof(int64)) == 0
+			&& FMemory::Memcmp(A.Spectra.GetData(), B.Spectra.GetData(), A.Spectra.Num() * sizeof(float)) == 0
+			&& FMemory::Memcmp(A.Amplitudes.GetData(), B.Amplitudes.GetData(), A.Amplitudes.Num() * sizeof(float)) == 0;
+	}
+
+	/** Largest error of the baked frames at Path against Frames, in quantization steps */
+	double CheckBake(const FString& Path, const FSpectrogramFrames& Frames, const FSpectrogramLevels& Levels, uint32 BytesPerValue)
+	{
+		FBakedSpectrogramPtr Baked = FBakedSpectrogram::Open(Path);
+		TEST_CHECK(Baked.IsValid(), "%u bytes a value: the bake does not open", BytesPerValue);
+		if (!Baked.IsValid())
+		{
+			return 0.0;
+		}
+		TEST_CHECK(Baked->GetNumFrames() == Frames.GetNumFrames(), "%u bytes a value: %d frames baked of %d", BytesPerValue, Baked->GetNumFrames(), Frames.GetNumFrames());
+
+		const uint32 MaxValue = BytesPerValue == 1 ? MAX_uint8 : MAX_uint16;
+		const double SpectrumStep = (Levels.SpectrumMax - Levels.SpectrumMin) / MaxValue;
+		const double AmplitudeStep = (Levels.AmplitudeMax - Levels.AmplitudeMin) / (MaxValue - 1);
+		const int32 SpectrumStride = Frames.GetSpectrumStride();
+		const int32 AmplitudeStride = Frames.GetAmplitudeStride();
+		double WorstSteps = 0.0;
+		FSpectrumAnalysisResult Result;
+		for (int32 Frame = 0; Frame < FMath::Min(Baked->GetNumFrames(), Frames.GetNumFrames()); ++Frame)
+		{
+			Baked->GetFrame(Frame, Result);
+			TEST_CHECK(Result.Time.GetTicks() == Frames.Times[Frame], "%u bytes a value, frame %d: time", BytesPerValue, Frame);
+			for (int32 Index = 0; Index < SpectrumStride; ++Index)
+			{
+				const float Expected = Frames.Spectra[(int64)Frame * SpectrumStride + Index];
+				TEST_CHECK(Expected <= Levels.SpectrumMax, "frame %d: %.2f dB above the peak bound %.2f dB", Frame, Expected, Levels.SpectrumMax);
+				const double Steps = FMath::Abs(Result.Spectrum[Index] - FMath::Max(Expected, Levels.SpectrumMin)) / SpectrumStep;
+				WorstSteps = FMath::Max(WorstSteps, Steps);
+			}
+			for (int32 Index = 0; Index < AmplitudeStride; ++Index)
+			{
+				const float Expected = Frames.Amplitudes[(int64)Frame * AmplitudeStride + Index];
+				if (Expected <= 0.f)
+				{
+					TEST_CHECK(Result.Amplitude[Index] == 0.f, "frame %d: silence reads %f", Frame, Result.Amplitude[Index]);
+					continue;
+				}
+				const float Decibels = 20.f * FMath::LogX(10.f, Expected);
+				TEST_CHECK(Decibels <= Levels.AmplitudeMax, "frame %d: amplitude %.2f dB above the peak bound %.2f dB", Frame, Decibels, Levels.AmplitudeMax);
+				const double Steps = FMath::Abs(20.f * FMath::LogX(10.f, Result.Amplitude[Index]) - FMath::Max(Decibels, Levels.AmplitudeMin)) / AmplitudeStep;
+				WorstSteps = FMath::Max(WorstSteps, Steps);
+			}
+		}
+		return WorstSteps;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double AudioSeconds = argc > 1 ? atof(argv[1]) : 180.0;
+	const uint32 SampleRate = 48000;
+	const uint32 NumChannels = 2;
+
+	FSpectrumAnalysisSettings Settings;
+	Settings.WindowDurationInSeconds = 0.04f;
+	Settings.SpectrumWidth = 64;
+	Settings.AmplitudeBuckets = 10;
+	Settings.WindowType = ESpectrumWindowType::Hann;
+	Settings.BandScale = ESpectrumBandScale::Logarithmic;
+	Settings.MinFrequency = 20.f;
+	Settings.OctaveFraction = 3;
+	Settings.HopFraction = 0.5f;
+	Settings.Backend = ESpectrumAnalysisBackend::Native;
+
+	std::vector<int16> Audio((size_t)(AudioSeconds * SampleRate) * NumChannels);
+	MakeTestAudio(Audio.data(), NumChannels, Audio.size() / NumChannels, SampleRate);
+	FBakeSource Source;
+	Source.Samples = Audio.data();
+	Source.NumChannels = NumChannels;
+	Source.SampleRate = SampleRate;
+	Source.NumFrames = Audio.size() / NumChannels;
+
+	FSpectrogramFrames Reference;
+	TEST_CHECK(SpectrogramBaker::Analyze(Settings, Source, Reference, 1), "analyzing on one worker");
+	printf("%.0f s of stereo audio, %d frames, best of 3\n", AudioSeconds, Reference.GetNumFrames());
+	printf("workers  audio s/s  speedup\n");
+	double OneWorkerSeconds = 0.0;
+	const int32 MaxWorkers = FMath::Max(SpectrogramBaker::GetMaxWorkers(), 4);
+	for (int32 NumWorkers = 1; NumWorkers <= MaxWorkers; ++NumWorkers)
+	{
+		FSpectrogramFrames Frames;
+		bool bAnalyzed = true;
+		const double Seconds = TimeBestOf(3, [&]()
+		{
+			bAnalyzed &= SpectrogramBaker::Analyze(Settings, Source, Frames, NumWorkers);
+		});
+		TEST_CHECK(bAnalyzed, "analyzing on %d workers", NumWorkers);
+		TEST_CHECK(SameFrames(Reference, Frames), "%d workers give other frames than one", NumWorkers);
+		if (NumWorkers == 1)
+		{
+			OneWorkerSeconds = Seconds;
+		}
+		printf("%7d  %9.0f  %6.2fx\n", NumWorkers, AudioSeconds / Seconds, OneWorkerSeconds / Seconds);
+	}
+
+	int32 PeakSample = 0;
+	for (int16 Sample : Audio)
+	{
+		PeakSample = FMath::Max(PeakSample, FMath::Abs((int32)Sample));
+	}
+	const FSpectrogramLevels Levels = FSpectrogramLevels::ForPeakSample(PeakSample);
+	const FString Path = TEXT("build/BakerBench.spectrogram");
+	for (uint32 BytesPerValue = 1; BytesPerValue <= 2; ++BytesPerValue)
+	{
+		const double Start = FPlatformTime::Seconds();
+		const bool bBaked = SpectrogramBaker::Bake(Settings, Source, BytesPerValue, Path, MaxWorkers);
+		const double Seconds = FPlatformTime::Seconds() - Start;
+		TEST_CHECK(bBaked, "baking at %u bytes a value", BytesPerValue);
+		const double WorstSteps = bBaked ? CheckBake(Path, Reference, Levels, BytesPerValue) : 0.0;
+		printf("baked at %u bytes a value: %.0f s of audio per second, worst error %.3f steps\n", BytesPerValue, AudioSeconds / Seconds, WorstSteps);
+		// Half a step, plus the float rounding of levels near 100 dB, which is a few thousandths of a 2 byte step
+		TEST_CHECK(WorstSteps <= 0.51, "%u bytes a value: %.3f steps off", BytesPerValue, WorstSteps);
+		IFileManager::Get().Delete(*Path);
+	}
+	return GNumFailedChecks;
+}
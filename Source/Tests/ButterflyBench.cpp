@@ -0,0 +1,146 @@
+// kiss_fft with scalar, 128 bit and 256 bit butterflies, chosen at run time with kiss_fft_set_simd.
+//
+// First checks that every vector width agrees with the scalar butterflies, forward and inverse, over
+// sizes that exercise each radix. Then times complex and real forward transforms from 256 to 65536
+// points at each width the CPU supports.
+//
+//   ButterflyBench [transformed points per timing run]
+
+#include "TestHelpers.h"
+#include "kiss_fftr.h"
+
+namespace
+{
+	const int32 Levels[] = { KISS_FFT_SIMD_NONE, KISS_FFT_SIMD_128, KISS_FFT_SIMD_256 };
+
+	/** Largest difference from the scalar result, relative to the mean magnitude of the scalar result */
+	double DifferenceFromScalar(int32 Size, bool bInverse, int32 Level)
+	{
+		std::vector<kiss_fft_cpx> In(Size), Expected(Size), Actual(Size);
+		FTestRandom Random(Size);
+		for (kiss_fft_cpx& Value : In)
+		{
+			Value.r = Random.NextSigned();
+			Value.i = Random.NextSigned();
+		}
+
+		kiss_fft_set_simd(KISS_FFT_SIMD_NONE);
+		kiss_fft_cfg Plan = kiss_fft_alloc(Size, bInverse ? 1 : 0, nullptr, nullptr);
+		kiss_fft(Plan, In.data(), Expected.data());
+		kiss_fft_free(Plan);
+
+		kiss_fft_set_simd(Level);
+		Plan = kiss_fft_alloc(Size, bInverse ? 1 : 0, nullptr, nullptr);
+		kiss_fft(Plan, In.data(), Actual.data());
+		kiss_fft_free(Plan);
+
+		double MaxDifference = 0.0, SumMagnitude = 0.0;
+		for (int32 Index = 0; Index < Size; ++Index)
+		{
+			MaxDifference = FMath::Max(MaxDifference, hypot((double)Expected[Index].r - Actual[Index].r, (double)Expected[Index].i - Actual[Index].i));
+			SumMagnitude += hypot((double)Expected[Index].r, (double)Expected[Index].i);
+		}
+		return MaxDifference / (SumMagnitude / Size);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int64 PointsPerRun = argc > 1 ? atoll(argv[1]) : (1 << 23);
+
+	// Every radix kiss_fft has a butterfly for, alone and mixed, plus the generic one (7)
+	const int32 CheckSizes[] = { 2, 3, 4, 5, 6, 7, 8, 12, 15, 16, 20, 24, 30, 45, 60, 64, 100, 120, 125, 240, 256, 360, 480, 1000, 1024, 1536, 2048, 3000, 4096, 6000, 8192 };
+	double WorstDifference = 0.0;
+	for (int32 Level : Levels)
+	{
+		if (Level == KISS_FFT_SIMD_NONE || kiss_fft_set_simd(Level) != Level)
+		{
+			continue;
+		}
+		for (int32 Size : CheckSizes)
+		{
+			for (int32 Inverse = 0; Inverse < 2; ++Inverse)
+			{
+				const double Difference = DifferenceFromScalar(Size, Inverse != 0, Level);
+				WorstDifference = FMath::Max(WorstDifference, Difference);
+				TEST_CHECK(Difference < 1e-5, "%s, %d points, %s: %.2e", kiss_fft_get_simd_name(), Size, Inverse ? "inverse" : "forward", Difference);
+			}
+		}
+	}
+	printf("largest difference from the scalar butterflies: %.2e\n\n", WorstDifference);
+
+	const char* Names[3] = { "-", "-", "-" };
+	for (int32 Level : Levels)
+	{
+		if (kiss_fft_set_simd(Level) == Level)
+		{
+			Names[Level] = kiss_fft_get_simd_name();
+		}
+	}
+	printf("us per transform, best of 5\n");
+	printf("%6s  %-42s  %s\n", "", "complex", "real");
+	printf("%6s", "N");
+	for (int32 Group = 0; Group < 2; ++Group)
+	{
+		printf("  %8s  %8s %6s  %8s %6s", Names[0], Names[1], "", Names[2], "");
+	}
+	printf("\n");
+	for (int32 Size = 256; Size <= 65536; Size *= 2)
+	{
+		const int32 NumTransforms = (int32)FMath::Max<int64>(PointsPerRun / Size, 1);
+		std::vector<kiss_fft_cpx> In(Size), Out(Size);
+		std::vector<float> RealIn(Size);
+		FTestRandom Random(Size);
+		for (int32 Index = 0; Index < Size; ++Index)
+		{
+			RealIn[Index] = In[Index].r = Random.NextSigned();
+			In[Index].i = 0.f;
+		}
+
+		double Complex[3] = { 0.0, 0.0, 0.0 }, Real[3] = { 0.0, 0.0, 0.0 };
+		for (int32 Level : Levels)
+		{
+			if (kiss_fft_set_simd(Level) != Level)
+			{
+				continue;
+			}
+			kiss_fft_cfg Plan = kiss_fft_alloc(Size, 0, nullptr, nullptr);
+			kiss_fftr_cfg RealPlan = kiss_fftr_alloc(Size, 0, nullptr, nullptr);
+			Complex[Level] = 1e6 * TimeBestOf(5, [&]()
+			{
+				for (int32 Transform = 0; Transform < NumTransforms; ++Transform)
+				{
+					kiss_fft(Plan, In.data(), Out.data());
+				}
+			}) / NumTransforms;
+			Real[Level] = 1e6 * TimeBestOf(5, [&]()
+			{
+				for (int32 Transform = 0; Transform < NumTransforms; ++Transform)
+				{
+					kiss_fftr(RealPlan, RealIn.data(), Out.data());
+				}
+			}) / NumTransforms;
+			kiss_fft_free(Plan);
+			kiss_fftr_free(RealPlan);
+		}
+
+		printf("%6d", Size);
+		for (const double* Times : { Complex, Real })
+		{
+			printf("  %8.2f", Times[0]);
+			for (int32 Level = 1; Level < 3; ++Level)
+			{
+				if (Times[Level] > 0.0)
+				{
+					printf("  %8.2f %5.2fx", Times[Level], Times[0] / Times[Level]);
+				}
+				else
+				{
+					printf("  %8s %6s", "-", "");
+				}
+			}
+		}
+		printf("\n");
+	}
+	return GNumFailedChecks;
+}
@@ -0,0 +1,178 @@
+// The capture format FCaptureController asks the platform for, driven with synthetic clocks.
+//
+// The limits are those of a typical Android Visualizer: 128 to 1024 byte captures at up to 20 Hz.
+// Reads come at a fixed game frame rate, each needing some FFT size, and captures arrive between
+// them. Captures must be sized for the largest FFT read over the last period, come about as often
+// as the game reads, move only when the read rate moves past the hysteresis, stop while paused or
+// once nobody reads, and restart with the next read; the callback and byte rates must be what was
+// delivered.
+
+#include "TestHelpers.h"
+#include "CaptureController.h"
+
+namespace
+{
+	const int32 MinSize = 128;
+	const int32 MaxSize = 1024;
+	const int32 MaxRateMilliHz = 20000;
+
+	/** A game reading results once per frame at a fixed rate */
+	struct FReadClock
+	{
+		double Now;
+		uint64 Frame;
+
+		FReadClock() : Now(100.0), Frame(1000) {}
+
+		/** Reads for Seconds at FramesPerSecond, ReadsPerFrame times each frame, needing FramesNeeded */
+		void Read(FCaptureController& Controller, double Seconds, double FramesPerSecond, int32 FramesNeeded, int32 ReadsPerFrame = 1)
+		{
+			const int32 NumFrames = (int32)(Seconds * FramesPerSecond + 0.5);
+			for (int32 Index = 0; Index < NumFrames; ++Index)
+			{
+				Now += 1.0 / FramesPerSecond;
+				++Frame;
+				for (int32 Read = 0; Read < ReadsPerFrame; ++Read)
+				{
+					Controller.NoteRead(Now, Frame, FramesNeeded);
+				}
+			}
+		}
+	};
+
+	FCaptureController MakeController()
+	{
+		FCaptureController Controller;
+		Controller.SetLimits(MinSize, MaxSize, MaxRateMilliHz);
+		return Controller;
+	}
+
+	/** Whether RateMilliHz is one a reader at Hz settles on: close enough that the hysteresis, a quarter of the rate, holds it */
+	bool RateNear(int32 RateMilliHz, double Hz)
+	{
+		return FMath::Abs(RateMilliHz - Hz * 1000.0) <= RateMilliHz * 0.25;
+	}
+
+	void CheckSize()
+	{
+		FCaptureController Controller = MakeController();
+		FCaptureFormat Format = Controller.GetFormat();
+		TEST_CHECK(Format.bEnabled && Format.Size == MaxSize && Format.RateMilliHz == MaxRateMilliHz,
+			"before any read: enabled %d, size %d, rate %d", Format.bEnabled, Format.Size, Format.RateMilliHz);
+
+		FReadClock Clock;
+		Clock.Read(Controller, 0.1, 30.0, 300);
+		Format = Controller.GetFormat();
+		TEST_CHECK(Format.Size == 512, "300 frames needed: size %d", Format.Size);
+
+		Clock.Read(Controller, 0.5, 30.0, 2000);
+		TEST_CHECK(Controller.GetFormat().Size == MaxSize, "2000 frames needed: size %d", Controller.GetFormat().Size);
+
+		// The big reads stop; a period later only the small ones count
+		Clock.Read(Controller, 2.5, 30.0, 100);
+		TEST_CHECK(Controller.GetFormat().Size == 128, "100 frames needed: size %d", Controller.GetFormat().Size);
+
+		Clock.Read(Controller, 2.5, 30.0, 50);
+		TEST_CHECK(Controller.GetFormat().Size == MinSize, "50 frames needed: size %d", Controller.GetFormat().Size);
+	}
+
+	void CheckRate()
+	{
+		FCaptureController Controller = MakeController();
+		FReadClock Clock;
+
+		Clock.Read(Controller, 0.5, 10.0, 1024);
+		TEST_CHECK(Controller.GetFormat().RateMilliHz == MaxRateMilliHz, "before a period completes: rate %d", Controller.GetFormat().RateMilliHz);
+
+		Clock.Read(Controller, 2.0, 10.0, 1024);
+		const int32 TenHz = Controller.GetFormat().RateMilliHz;
+		TEST_CHECK(FMath::Abs(TenHz - 10000) <= 500, "reads at 10 Hz: rate %d", TenHz);
+
+		// Within the hysteresis the format stays put, so the capture is not reconfigured for jitter
+		Clock.Read(Controller, 3.0, 11.0, 1024);
+		TEST_CHECK(Controller.GetFormat().RateMilliHz == TenHz, "reads at 11 Hz: rate %d, was %d", Controller.GetFormat().RateMilliHz, TenHz);
+
+		Clock.Read(Controller, 3.0, 5.0, 1024);
+		TEST_CHECK(RateNear(Controller.GetFormat().RateMilliHz, 5.0), "reads at 5 Hz: rate %d", Controller.GetFormat().RateMilliHz);
+
+		// Several analyzers reading in the same frame are one read
+		Clock.Read(Controller, 3.0, 10.0, 1024, 4);
+		TEST_CHECK(RateNear(Controller.GetFormat().RateMilliHz, 10.0), "4 reads a frame at 10 Hz: rate %d", Controller.GetFormat().RateMilliHz);
+
+		Clock.Read(Controller, 3.0, 60.0, 1024);
+		TEST_CHECK(Controller.GetFormat().RateMilliHz == MaxRateMilliHz, "reads at 60 Hz: rate %d", Controller.GetFormat().RateMilliHz);
+
+		// Reads further apart than IdleSeconds are gaps, not a rate, so this is as slow as reads get
+		Clock.Read(Controller, 5.0, 2.5, 1024);
+		TEST_CHECK(RateNear(Controller.GetFormat().RateMilliHz, 2.5), "reads at 2.5 Hz: rate %d", Controller.GetFormat().RateMilliHz);
+	}
+
+	void CheckIdleAndPause()
+	{
+		FCaptureController Controller = MakeController();
+		FReadClock Clock;
+		Clock.Read(Controller, 2.0, 30.0, 1024);
+		const FCaptureFormat Reading = Controller.GetFormat();
+
+		TEST_CHECK(!Controller.NoteCapture(Clock.Now + 0.1, 1024), "idle 0.1 s after the last read");
+		TEST_CHECK(Controller.GetFormat().bEnabled, "disabled 0.1 s after the last read");
+		TEST_CHECK(Controller.NoteCapture(Clock.Now + FCaptureController::IdleSeconds + 0.1, 1024), "not idle once nobody reads");
+		TEST_CHECK(!Controller.GetFormat().bEnabled, "still enabled once nobody reads");
+		TEST_CHECK(!Controller.NoteCapture(Clock.Now + FCaptureController::IdleSeconds + 0.2, 1024), "idle reported twice");
+
+		// The first read after the gap enables capture again with what was measured before it
+		Clock.Now += 5.0;
+		++Clock.Frame;
+		TEST_CHECK(Controller.NoteRead(Clock.Now, Clock.Frame, 1024), "the read after idling left the format alone");
+		TEST_CHECK(Controller.GetFormat() == Reading, "after idling: enabled %d, size %d, rate %d",
+			Controller.GetFormat().bEnabled, Controller.GetFormat().Size, Controller.GetFormat().RateMilliHz);
+
+		TEST_CHECK(Controller.SetPaused(true), "pausing left the format alone");
+		TEST_CHECK(!Controller.GetFormat().bEnabled, "enabled while paused");
+		TEST_CHECK(!Controller.SetPaused(true), "pausing twice changed the format");
+		Clock.Read(Controller, 0.2, 30.0, 1024);
+		TEST_CHECK(!Controller.GetFormat().bEnabled, "reads enabled capture while paused");
+		TEST_CHECK(Controller.SetPaused(false), "resuming left the format alone");
+		TEST_CHECK(Controller.GetFormat().bEnabled, "disabled after resuming");
+
+		FCaptureController Unlimited;
+		TEST_CHECK(!Unlimited.GetFormat().bEnabled, "enabled before the limits are known");
+	}
+
+	void CheckCounters()
+	{
+		FCaptureController Controller = MakeController();
+		float CallbacksPerSecond, BytesPerSecond;
+		const double Start = 50.0;
+		Controller.GetCaptureRates(Start, CallbacksPerSecond, BytesPerSecond);
+		TEST_CHECK(CallbacksPerSecond == 0.f && BytesPerSecond == 0.f, "before a period completes: %f callbacks, %f bytes a second", CallbacksPerSecond, BytesPerSecond);
+
+		for (int32 Capture = 0; Capture < 20; ++Capture)
+		{
+			Controller.NoteCapture(Start + Capture * 0.05, 512);
+		}
+		Controller.GetCaptureRates(Start + 1.0, CallbacksPerSecond, BytesPerSecond);
+		TEST_CHECK(FMath::Abs(CallbacksPerSecond - 20.f) < 0.01f && FMath::Abs(BytesPerSecond - 10240.f) < 1.f,
+			"20 captures of 512 bytes in a second: %f callbacks, %f bytes a second", CallbacksPerSecond, BytesPerSecond);
+
+		for (int32 Capture = 0; Capture < 10; ++Capture)
+		{
+			Controller.NoteCapture(Start + 1.0 + Capture * 0.2, 1024);
+		}
+		Controller.GetCaptureRates(Start + 1.5, CallbacksPerSecond, BytesPerSecond);
+		TEST_CHECK(FMath::Abs(CallbacksPerSecond - 20.f) < 0.01f, "the last complete period changed before the next completed: %f callbacks a second", CallbacksPerSecond);
+		Controller.GetCaptureRates(Start + 3.0, CallbacksPerSecond, BytesPerSecond);
+		TEST_CHECK(FMath::Abs(CallbacksPerSecond - 5.f) < 0.01f && FMath::Abs(BytesPerSecond - 5120.f) < 1.f,
+			"10 captures of 1024 bytes in 2 seconds: %f callbacks, %f bytes a second", CallbacksPerSecond, BytesPerSecond);
+	}
+}
+
+int main()
+{
+	CheckSize();
+	CheckRate();
+	CheckIdleAndPause();
+	CheckCounters();
+	printf("capture controller: %d failed checks\n", GNumFailedChecks);
+	return GNumFailedChecks;
+}
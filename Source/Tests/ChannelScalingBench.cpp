@@ -0,0 +1,73 @@
+// What one analysis costs as the channel count grows.
+//
+// FSpectrumAnalysisEngine::Analyze windows, transforms and band-maps every channel of a window as one
+// batch, so the cost per channel should stay flat from mono to 7.1. Each row times whole analyses of
+// the same audio: spectrum plus amplitude, logarithmic bands, Hann window.
+//
+//   ChannelScalingBench [analyses per run]
+
+#include "TestHelpers.h"
+#include "SpectrumAnalysis.h"
+
+int main(int argc, char** argv)
+{
+	const int32 NumAnalyses = argc > 1 ? atoi(argv[1]) : 4000;
+	const uint32 SampleRate = 48000;
+	const uint32 MaxChannels = 8;
+	const float WindowSeconds[] = { 0.02f, 0.04f, 0.08f };
+	const uint32 ChannelCounts[] = { 1, 2, 4, 6, 8 };
+
+	printf("%d analyses per run, best of 9, 64 logarithmic bands and 10 amplitude buckets\n", NumAnalyses);
+	printf("   fft  channels  us/window  us/channel  vs mono\n");
+	for (float Duration : WindowSeconds)
+	{
+		FSpectrumAnalysisSettings Settings;
+		Settings.WindowDurationInSeconds = Duration;
+		Settings.SpectrumWidth = 64;
+		Settings.AmplitudeBuckets = 10;
+		Settings.WindowType = ESpectrumWindowType::Hann;
+		Settings.BandScale = ESpectrumBandScale::Logarithmic;
+		Settings.MinFrequency = 20.f;
+		Settings.OctaveFraction = 3;
+		Settings.HopFraction = 0.5f;
+		Settings.Backend = ESpectrumAnalysisBackend::Native;
+		const uint32 FFTSize = Settings.GetFFTSize(SampleRate);
+
+		std::vector<int16> Interleaved(FFTSize * MaxChannels);
+		MakeTestAudio(Interleaved.data(), MaxChannels, FFTSize, SampleRate);
+
+		double MonoPerChannel = 0.0;
+		for (uint32 NumChannels : ChannelCounts)
+		{
+			std::vector<float> Planes(FFTSize * NumChannels);
+			for (uint32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				for (uint32 Frame = 0; Frame < FFTSize; ++Frame)
+				{
+					Planes[Channel * FFTSize + Frame] = Interleaved[Frame * MaxChannels + Channel];
+				}
+			}
+
+			FSpectrumAnalysisEngine Engine;
+			FSpectrumAnalysisResult Result;
+			bool bAnalyzed = true;
+			const double Seconds = TimeBestOf(9, [&]()
+			{
+				for (int32 Analysis = 0; Analysis < NumAnalyses; ++Analysis)
+				{
+					bAnalyzed &= Engine.Analyze(Settings, Planes.data(), NumChannels, SampleRate, 0, Result);
+				}
+			});
+			TEST_CHECK(bAnalyzed, "%u channels of %u points", NumChannels, FFTSize);
+
+			const double PerWindow = 1e6 * Seconds / NumAnalyses;
+			const double PerChannel = PerWindow / NumChannels;
+			if (NumChannels == 1)
+			{
+				MonoPerChannel = PerChannel;
+			}
+			printf("%6u  %8u  %9.2f  %10.2f  %6.2fx\n", FFTSize, NumChannels, PerWindow, PerChannel, PerChannel / MonoPerChannel);
+		}
+	}
+	return GNumFailedChecks;
+}
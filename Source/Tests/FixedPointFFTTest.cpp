@@ -0,0 +1,118 @@
+// Band levels from the 16 bit fixed point FFT path against the float path they stand in for.
+//
+// Android analyzes 8 bit Visualizer captures in fixed point by default, so every trial here is such a
+// capture, widened to the int16 scale as FAudioRingBuffer::WriteUnsigned8 does: two tones and some
+// noise at random levels. The same samples go through an engine in each mode and the band levels,
+// in dB, are compared. Fixed point loses precision near its noise floor, so bands are grouped by how
+// far they sit below full scale: the loudest band of a full scale sine.
+
+#include "TestHelpers.h"
+#include "SpectrumAnalysis.h"
+
+namespace
+{
+	const uint32 SampleRate = 48000;
+	const int32 NumBands = 32;
+	const int32 NumTrials = 200;
+
+	struct FErrorStats
+	{
+		double Sum = 0.0;
+		double Max = 0.0;
+		int32 Count = 0;
+
+		void Add(double Error)
+		{
+			Sum += Error;
+			Max = FMath::Max(Max, Error);
+			++Count;
+		}
+		double Mean() const { return Count > 0 ? Sum / Count : 0.0; }
+	};
+}
+
+int main()
+{
+	const float WindowSeconds[] = { 0.01f, 0.02f, 0.04f, 0.08f };
+
+	printf("%d 8 bit captures per size, Hann window, %d linear bands; error in dB\n", NumTrials, NumBands);
+	printf("  fft   within 30 dB of full scale   within 60 dB of full scale\n");
+	printf("          mean      max                mean      max\n");
+	for (float Duration : WindowSeconds)
+	{
+		FSpectrumAnalysisSettings Settings;
+		Settings.WindowDurationInSeconds = Duration;
+		Settings.SpectrumWidth = NumBands;
+		Settings.AmplitudeBuckets = 0;
+		Settings.WindowType = ESpectrumWindowType::Hann;
+		Settings.BandScale = ESpectrumBandScale::Linear;
+		Settings.MinFrequency = 20.f;
+		Settings.OctaveFraction = 3;
+		Settings.HopFraction = 0.5f;
+		Settings.Backend = ESpectrumAnalysisBackend::Native;
+		const int32 FFTSize = Settings.GetFFTSize(SampleRate);
+
+		FSpectrumAnalysisEngine FloatEngine, FixedEngine;
+		FloatEngine.SetFixedPoint(false);
+		FixedEngine.SetFixedPoint(true);
+		FSpectrumAnalysisResult FloatResult, FixedResult;
+		std::vector<float> Samples(FFTSize);
+		FErrorStats Loud, Audible;
+		FTestRandom Random(FFTSize);
+
+		for (int32 Index = 0; Index < FFTSize; ++Index)
+		{
+			Samples[Index] = (float)(32767.0 * sin(2.0 * PI * (FFTSize / 8 + 0.5) * Index / FFTSize));
+		}
+		FloatEngine.Analyze(Settings, Samples.data(), 1, SampleRate, 0, FloatResult);
+		float FullScale = FloatResult.GetSpectrum(1)[0];
+		for (int32 Band = 1; Band < NumBands; ++Band)
+		{
+			FullScale = FMath::Max(FullScale, FloatResult.GetSpectrum(1)[Band]);
+		}
+
+		for (int32 Trial = 0; Trial < NumTrials; ++Trial)
+		{
+			const double Level1 = 100.0 * (Random.NextSigned() * 0.5 + 0.5);
+			const double Level2 = 30.0 * (Random.NextSigned() * 0.5 + 0.5);
+			const double Bin1 = 20 + Random.NextBits() % (FFTSize / 4);
+			const double Bin2 = Random.NextBits() % (FFTSize / 2);
+			const double Noise = 4.0 * (Random.NextSigned() * 0.5 + 0.5);
+			for (int32 Index = 0; Index < FFTSize; ++Index)
+			{
+				const double Value = 128.0 + Level1 * sin(2.0 * PI * Bin1 * Index / FFTSize + Trial)
+					+ Level2 * sin(2.0 * PI * Bin2 * Index / FFTSize) + Noise * Random.NextSigned();
+				const int32 Byte = FMath::Clamp((int32)floor(Value + 0.5), 0, 255);
+				Samples[Index] = (float)((Byte - 128) << 8);
+			}
+
+			const bool bFloat = FloatEngine.Analyze(Settings, Samples.data(), 1, SampleRate, 0, FloatResult);
+			const bool bFixed = FixedEngine.Analyze(Settings, Samples.data(), 1, SampleRate, 0, FixedResult);
+			TEST_CHECK(bFloat && bFixed, "%d points, trial %d", FFTSize, Trial);
+			if (!bFloat || !bFixed)
+			{
+				continue;
+			}
+
+			const float* FloatBands = FloatResult.GetSpectrum(1);
+			const float* FixedBands = FixedResult.GetSpectrum(1);
+			for (int32 Band = 0; Band < NumBands; ++Band)
+			{
+				const double Error = FMath::Abs((double)FloatBands[Band] - FixedBands[Band]);
+				if (FloatBands[Band] > FullScale - 30.f)
+				{
+					Loud.Add(Error);
+				}
+				if (FloatBands[Band] > FullScale - 60.f)
+				{
+					Audible.Add(Error);
+				}
+			}
+		}
+
+		printf("%5d   %6.3f   %6.3f              %6.3f   %6.3f\n", FFTSize, Loud.Mean(), Loud.Max, Audible.Mean(), Audible.Max);
+		TEST_CHECK(Loud.Max < 0.25, "%d points: %.3f dB within 30 dB of full scale", FFTSize, Loud.Max);
+		TEST_CHECK(Audible.Mean() < 1.5 && Audible.Max < 6.0, "%d points: mean %.3f dB, max %.3f dB within 60 dB of full scale", FFTSize, Audible.Mean(), Audible.Max);
+	}
+	return GNumFailedChecks;
+}
@@ -0,0 +1,135 @@
+// What the decoder thread pays to hand a buffer to the analyzer, by channel count.
+//
+// Before: the int16 history was a circular buffer written a sample at a time, as PlayAudioSink did.
+// After: FAudioRingBuffer::Write, which deinterleaves each buffer into float planes with the
+// AudioConversion kernels. The plain per-channel loop those kernels fall back to is timed as well,
+// to show what the SIMD kernels themselves add.
+//
+// Also checks every layout from 1 to 8 channels against that plain loop, at frame counts that leave
+// a remainder for the scalar tail.
+//
+//   IngestBench [seconds of audio per run]
+
+#include "TestHelpers.h"
+#include "AudioConversion.h"
+#include "AudioRingBuffer.h"
+
+namespace
+{
+	const uint32 SampleRate = 48000;
+	const uint32 BufferFrames = 1024;
+
+	void DeinterleavePlain(const int16* In, uint32 NumChannels, uint32 NumFrames, float* Out, uint32 OutPlaneStride)
+	{
+		for (uint32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+		{
+			for (uint32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+			{
+				Out[ChannelIndex * OutPlaneStride + FrameIndex] = In[FrameIndex * NumChannels + ChannelIndex];
+			}
+		}
+	}
+
+	void CheckKernels()
+	{
+		const uint32 FrameCounts[] = { 1, 3, 4, 7, 8, 9, 15, 16, 17, 1023, 1024, 1029 };
+		for (uint32 NumChannels = 1; NumChannels <= 8; ++NumChannels)
+		{
+			for (uint32 NumFrames : FrameCounts)
+			{
+				std::vector<int16> In(NumFrames * NumChannels);
+				FTestRandom Random(NumChannels * 7919 + NumFrames);
+				for (int16& Sample : In)
+				{
+					// Full range, so sign extension mistakes show
+					Sample = (int16)(Random.NextBits() >> 7);
+				}
+				const uint32 Stride = NumFrames + 5;
+				std::vector<float> Expected(Stride * NumChannels, -1.f), Actual(Stride * NumChannels, -1.f);
+				DeinterleavePlain(In.data(), NumChannels, NumFrames, Expected.data(), Stride);
+				AudioConversion::DeinterleaveToFloat(In.data(), NumChannels, NumFrames, Actual.data(), Stride);
+				TEST_CHECK(Expected == Actual, "%u channels, %u frames", NumChannels, NumFrames);
+			}
+		}
+	}
+
+	/** The old history: interleaved int16, one sample at a time */
+	class FSampleCircularBuffer
+	{
+	public:
+		explicit FSampleCircularBuffer(uint32 CapacitySamples)
+			: Samples(CapacitySamples, 0)
+			, CurSampleIndex(0)
+		{
+		}
+
+		void Write(const int16* Buffer, uint32 NumSamples)
+		{
+			const uint32 Mask = (uint32)Samples.size() - 1;
+			for (uint32 Index = 0; Index < NumSamples; ++Index)
+			{
+				Samples[CurSampleIndex] = Buffer[Index];
+				CurSampleIndex = (CurSampleIndex + 1) & Mask;
+			}
+		}
+
+	private:
+		std::vector<int16> Samples;
+		uint32 CurSampleIndex;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	const double AudioSeconds = argc > 1 ? atof(argv[1]) : 10.0;
+	const uint32 NumBuffers = (uint32)(AudioSeconds * SampleRate / BufferFrames);
+
+	CheckKernels();
+
+	printf("%.0f s of audio per run in %u frame buffers, best of 5\n", AudioSeconds, BufferFrames);
+	printf("                   ns per frame                      speedup\n");
+	printf("channels  per sample  plain loop  kernels    vs per sample  vs plain\n");
+	const uint32 ChannelCounts[] = { 2, 6, 8 };
+	for (uint32 NumChannels : ChannelCounts)
+	{
+		std::vector<int16> Audio(BufferFrames * NumChannels);
+		MakeTestAudio(Audio.data(), NumChannels, BufferFrames, SampleRate);
+		const uint32 CapacityFrames = FMath::RoundUpToPowerOfTwo(SampleRate * 3);
+
+		FSampleCircularBuffer History(CapacityFrames * NumChannels);
+		const double PerSample = TimeBestOf(5, [&]()
+		{
+			for (uint32 BufferIndex = 0; BufferIndex < NumBuffers; ++BufferIndex)
+			{
+				History.Write(Audio.data(), BufferFrames * NumChannels);
+			}
+		});
+
+		// The plain loop into planes laid out as the ring's, without the ring's bookkeeping
+		std::vector<float> Planes(CapacityFrames * NumChannels);
+		const double Plain = TimeBestOf(5, [&]()
+		{
+			for (uint32 BufferIndex = 0; BufferIndex < NumBuffers; ++BufferIndex)
+			{
+				const uint32 First = (BufferIndex * BufferFrames) & (CapacityFrames - 1);
+				DeinterleavePlain(Audio.data(), NumChannels, BufferFrames, Planes.data() + First, CapacityFrames);
+			}
+		});
+
+		FAudioRingBuffer Ring(NumChannels, SampleRate, SampleRate * 3);
+		uint64 FramesWritten = 0;
+		const double Kernels = TimeBestOf(5, [&]()
+		{
+			for (uint32 BufferIndex = 0; BufferIndex < NumBuffers; ++BufferIndex)
+			{
+				FramesWritten += BufferFrames;
+				Ring.Write(Audio.data(), BufferFrames, FTimespan::FromSeconds((double)FramesWritten / SampleRate));
+			}
+		});
+
+		const double Frames = (double)NumBuffers * BufferFrames;
+		printf("%8u  %10.3f  %10.3f  %7.3f    %13.1fx  %7.1fx\n", NumChannels, 1e9 * PerSample / Frames, 1e9 * Plain / Frames,
+			1e9 * Kernels / Frames, PerSample / Kernels, Plain / Kernels);
+	}
+	return GNumFailedChecks;
+}
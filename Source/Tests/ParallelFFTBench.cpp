@@ -0,0 +1,57 @@
+// How large transforms speed up as kiss_fft_pool threads are added.
+//
+// Times complex forward transforms from 64K to 1M points on the calling thread alone, then with a
+// pool of 1 worker up to one per core, and at least 3, since the caller joins in. Reports ms per
+// transform and the speedup over the serial path.
+//
+//   ParallelFFTBench [transformed points per timing run]
+
+#include "TestHelpers.h"
+#include "kiss_fft_pool.h"
+
+#include <thread>
+
+int main(int argc, char** argv)
+{
+	const int64 PointsPerRun = argc > 1 ? atoll(argv[1]) : (1 << 23);
+	const int32 MaxWorkers = FMath::Max((int32)std::thread::hardware_concurrency() - 1, 3);
+
+	printf("ms per complex forward transform, best of 5, %s butterflies\n", kiss_fft_get_simd_name());
+	printf("%8s  %7s  %8s  %7s\n", "N", "workers", "ms", "speedup");
+	for (int32 Size = 65536; Size <= 1048576; Size *= 2)
+	{
+		const int32 NumTransforms = (int32)FMath::Max<int64>(PointsPerRun / Size, 1);
+		std::vector<kiss_fft_cpx> In(Size), Out(Size);
+		FTestRandom Random(Size);
+		for (kiss_fft_cpx& Value : In)
+		{
+			Value.r = Random.NextSigned();
+			Value.i = Random.NextSigned();
+		}
+		kiss_fft_cfg Plan = kiss_fft_alloc(Size, 0, nullptr, nullptr);
+
+		double SerialSeconds = 0.0;
+		for (int32 NumWorkers = 0; NumWorkers <= MaxWorkers; ++NumWorkers)
+		{
+			if (NumWorkers > 0)
+			{
+				TEST_CHECK(kiss_fft_pool_start(NumWorkers, 65536) == NumWorkers, "starting %d pool threads", NumWorkers);
+			}
+			const double Seconds = TimeBestOf(5, [&]()
+			{
+				for (int32 Transform = 0; Transform < NumTransforms; ++Transform)
+				{
+					kiss_fft(Plan, In.data(), Out.data());
+				}
+			}) / NumTransforms;
+			kiss_fft_pool_stop();
+			if (NumWorkers == 0)
+			{
+				SerialSeconds = Seconds;
+			}
+			printf("%8d  %7d  %8.3f  %6.2fx\n", Size, NumWorkers, 1e3 * Seconds, SerialSeconds / Seconds);
+		}
+		kiss_fft_free(Plan);
+	}
+	return GNumFailedChecks;
+}
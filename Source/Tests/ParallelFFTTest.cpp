@@ -0,0 +1,68 @@
+// Transforms split across kiss_fft_pool against the same transforms on the calling thread.
+//
+// kiss_fft_set_parallel_for only changes which thread runs each block and column chunk, never the
+// arithmetic, so every pooled transform must be bit for bit the serial one. Sizes cover the power of
+// two engine from 64K to 1M points and the mixed radix split of kf_work, forward and inverse, in
+// place and out of place, with a pool of 1 to 4 threads so shares are stolen from as well as drained.
+
+#include "TestHelpers.h"
+#include "kiss_fft_pool.h"
+
+namespace
+{
+	/** Smallest size handed to the pool, as the plugin does in the engine */
+	const int32 MinParallelSize = 65536;
+
+	std::vector<kiss_fft_cpx> Transform(kiss_fft_cfg Plan, const std::vector<kiss_fft_cpx>& In, bool bInPlace)
+	{
+		std::vector<kiss_fft_cpx> Out(In);
+		if (bInPlace)
+		{
+			kiss_fft(Plan, Out.data(), Out.data());
+		}
+		else
+		{
+			kiss_fft(Plan, In.data(), Out.data());
+		}
+		return Out;
+	}
+}
+
+int main()
+{
+	const int32 Sizes[] = { 65536, 131072, 262144, 524288, 1048576, 3 * 262144, 5 * 65536 };
+	const int32 ThreadCounts[] = { 1, 2, 4 };
+
+	int32 NumChecked = 0;
+	for (int32 Size : Sizes)
+	{
+		std::vector<kiss_fft_cpx> In(Size);
+		FTestRandom Random(Size);
+		for (kiss_fft_cpx& Value : In)
+		{
+			Value.r = Random.NextSigned();
+			Value.i = Random.NextSigned();
+		}
+		for (int32 Inverse = 0; Inverse < 2; ++Inverse)
+		{
+			kiss_fft_cfg Plan = kiss_fft_alloc(Size, Inverse, nullptr, nullptr);
+			for (int32 InPlace = 0; InPlace < 2; ++InPlace)
+			{
+				const std::vector<kiss_fft_cpx> Serial = Transform(Plan, In, InPlace != 0);
+				for (int32 NumThreads : ThreadCounts)
+				{
+					const int32 Started = kiss_fft_pool_start(NumThreads, MinParallelSize);
+					TEST_CHECK(Started == NumThreads, "%d of %d pool threads started", Started, NumThreads);
+					const std::vector<kiss_fft_cpx> Pooled = Transform(Plan, In, InPlace != 0);
+					kiss_fft_pool_stop();
+					TEST_CHECK(FMemory::Memcmp(Serial.data(), Pooled.data(), Size * sizeof(kiss_fft_cpx)) == 0,
+						"%d points, %s, %s, %d threads: pooled differs from serial", Size, Inverse ? "inverse" : "forward", InPlace ? "in place" : "out of place", NumThreads);
+					++NumChecked;
+				}
+			}
+			kiss_fft_free(Plan);
+		}
+	}
+	printf("%d pooled transforms from 64K to 1M points checked against serial\n", NumChecked);
+	return GNumFailedChecks;
+}
@@ -0,0 +1,119 @@
+// kiss_fft's iterative power of two engine against the recursive kf_work it replaced for 2^k plans.
+//
+// First checks that both give the same transforms, forward and inverse, strided and in place, for
+// every power of two up to 65536. Then times complex forward transforms from 1K to 64K points with
+// the scalar butterflies and with the widest ones the CPU has.
+//
+//   Pow2EngineBench [transformed points per timing run]
+
+#include "TestHelpers.h"
+#include "kiss_fft.h"
+
+namespace
+{
+	kiss_fft_cfg AllocPlan(int32 Size, bool bInverse, bool bIterative)
+	{
+		kiss_fft_set_pow2_engine(bIterative ? 1 : 0);
+		kiss_fft_cfg Plan = kiss_fft_alloc(Size, bInverse ? 1 : 0, nullptr, nullptr);
+		kiss_fft_set_pow2_engine(1);
+		return Plan;
+	}
+
+	/** Largest difference between Expected and Actual relative to the largest component of Expected */
+	double RelativeDifference(const std::vector<kiss_fft_cpx>& Expected, const std::vector<kiss_fft_cpx>& Actual)
+	{
+		double MaxDifference = 0.0, MaxValue = 0.0;
+		for (size_t Index = 0; Index < Expected.size(); ++Index)
+		{
+			MaxDifference = FMath::Max(MaxDifference, FMath::Abs((double)Expected[Index].r - Actual[Index].r) + FMath::Abs((double)Expected[Index].i - Actual[Index].i));
+			MaxValue = FMath::Max(MaxValue, (double)FMath::Abs(Expected[Index].r));
+		}
+		return MaxDifference / MaxValue;
+	}
+
+	double CheckAgainstRecursive(int32 Size, bool bInverse, int32 InStride)
+	{
+		std::vector<kiss_fft_cpx> In(Size * InStride), Recursive(Size), Iterative(Size);
+		FTestRandom Random(Size * 2 + InStride);
+		for (kiss_fft_cpx& Value : In)
+		{
+			Value.r = Random.NextSigned();
+			Value.i = Random.NextSigned();
+		}
+		kiss_fft_cfg RecursivePlan = AllocPlan(Size, bInverse, false);
+		kiss_fft_cfg IterativePlan = AllocPlan(Size, bInverse, true);
+		kiss_fft_stride(RecursivePlan, In.data(), Recursive.data(), InStride);
+		kiss_fft_stride(IterativePlan, In.data(), Iterative.data(), InStride);
+		double Difference = RelativeDifference(Recursive, Iterative);
+		if (InStride == 1)
+		{
+			// kiss_fft copies in place transforms through a temporary, which must not disturb the engine
+			std::vector<kiss_fft_cpx> InPlace(In);
+			kiss_fft(IterativePlan, InPlace.data(), InPlace.data());
+			Difference = FMath::Max(Difference, RelativeDifference(Recursive, InPlace));
+		}
+		kiss_fft_free(RecursivePlan);
+		kiss_fft_free(IterativePlan);
+		return Difference;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int64 PointsPerRun = argc > 1 ? atoll(argv[1]) : (1 << 23);
+
+	TEST_CHECK(kiss_fft_set_pow2_engine(1) == 1, "the power of two engine is not built");
+	const int32 Levels[] = { KISS_FFT_SIMD_NONE, KISS_FFT_SIMD_256 };
+	double WorstDifference = 0.0;
+	for (int32 Level : Levels)
+	{
+		kiss_fft_set_simd(Level);
+		for (int32 Size = 1; Size <= 65536; Size *= 2)
+		{
+			for (int32 Inverse = 0; Inverse < 2; ++Inverse)
+			{
+				for (int32 InStride = 1; InStride <= 3; InStride += 2)
+				{
+					const double Difference = CheckAgainstRecursive(Size, Inverse != 0, InStride);
+					WorstDifference = FMath::Max(WorstDifference, Difference);
+					TEST_CHECK(Difference < 1e-5, "%s, %d points, %s, stride %d: %.2e", kiss_fft_get_simd_name(), Size, Inverse ? "inverse" : "forward", InStride, Difference);
+				}
+			}
+		}
+	}
+	printf("largest difference from the recursive path: %.2e\n\n", WorstDifference);
+
+	printf("us per complex forward transform, best of 7\n");
+	printf("%-8s %6s  %10s  %10s  %7s\n", "", "N", "recursive", "iterative", "speedup");
+	for (int32 Level : Levels)
+	{
+		kiss_fft_set_simd(Level);
+		for (int32 Size = 1024; Size <= 65536; Size *= 2)
+		{
+			const int32 NumTransforms = (int32)FMath::Max<int64>(PointsPerRun / Size, 1);
+			std::vector<kiss_fft_cpx> In(Size), Out(Size);
+			FTestRandom Random(Size);
+			for (kiss_fft_cpx& Value : In)
+			{
+				Value.r = Random.NextSigned();
+				Value.i = 0.f;
+			}
+
+			double Times[2];
+			for (int32 Iterative = 0; Iterative < 2; ++Iterative)
+			{
+				kiss_fft_cfg Plan = AllocPlan(Size, false, Iterative != 0);
+				Times[Iterative] = 1e6 * TimeBestOf(7, [&]()
+				{
+					for (int32 Transform = 0; Transform < NumTransforms; ++Transform)
+					{
+						kiss_fft(Plan, In.data(), Out.data());
+					}
+				}) / NumTransforms;
+				kiss_fft_free(Plan);
+			}
+			printf("%-8s %6d  %10.2f  %10.2f  %6.2fx\n", kiss_fft_get_simd_name(), Size, Times[0], Times[1], Times[0] / Times[1]);
+		}
+	}
+	return GNumFailedChecks;
+}
@@ -0,0 +1,67 @@
+// The packed real FFT the analyzer uses against the complex FFT it replaced.
+//
+// For each size, a random real signal goes through kiss_fftr_scratch and, with zero imaginary parts,
+// through a complex kiss_fft of the same size; the N/2+1 bins the analyzer reads must agree to within
+// float rounding. kiss_fftr_scratch must also match kiss_fftr exactly, since it only moves the scratch
+// buffer out of the plan.
+//
+// Sizes cover the power of two windows the analyzer uses and a few mixed radix ones.
+
+#include "TestHelpers.h"
+#include "kiss_fftr.h"
+
+namespace
+{
+	/** Largest difference between the two spectra relative to the largest bin */
+	double RelativeError(const std::vector<kiss_fft_cpx>& Expected, const kiss_fft_cpx* Actual, int32 NumBins)
+	{
+		double MaxMagnitude = 0.0, MaxError = 0.0;
+		for (int32 Bin = 0; Bin < NumBins; ++Bin)
+		{
+			MaxMagnitude = FMath::Max(MaxMagnitude, hypot((double)Expected[Bin].r, (double)Expected[Bin].i));
+			MaxError = FMath::Max(MaxError, hypot((double)Expected[Bin].r - Actual[Bin].r, (double)Expected[Bin].i - Actual[Bin].i));
+		}
+		return MaxError / MaxMagnitude;
+	}
+}
+
+int main()
+{
+	const int32 Sizes[] = { 16, 64, 256, 480, 1000, 1024, 2048, 4096, 6000, 8192, 16384, 32768, 65536 };
+	// A few ulps per stage of the deepest transform
+	const double Tolerance = 2e-6;
+
+	printf("   size   relative error\n");
+	for (int32 Size : Sizes)
+	{
+		const int32 NumBins = Size / 2 + 1;
+		std::vector<float> Signal(Size);
+		FTestRandom Random(Size);
+		for (float& Sample : Signal)
+		{
+			Sample = 32767.f * Random.NextSigned();
+		}
+
+		std::vector<kiss_fft_cpx> ComplexIn(Size), ComplexOut(Size);
+		for (int32 Index = 0; Index < Size; ++Index)
+		{
+			ComplexIn[Index].r = Signal[Index];
+			ComplexIn[Index].i = 0.f;
+		}
+		kiss_fft_cfg ComplexPlan = kiss_fft_alloc(Size, 0, nullptr, nullptr);
+		kiss_fft(ComplexPlan, ComplexIn.data(), ComplexOut.data());
+		kiss_fft_free(ComplexPlan);
+
+		kiss_fftr_cfg RealPlan = kiss_fftr_alloc(Size, 0, nullptr, nullptr);
+		std::vector<kiss_fft_cpx> Packed(NumBins), Scratch(Size / 2), Unshared(NumBins);
+		kiss_fftr_scratch(RealPlan, Signal.data(), Packed.data(), Scratch.data());
+		kiss_fftr(RealPlan, Signal.data(), Unshared.data());
+		kiss_fftr_free(RealPlan);
+
+		const double Error = RelativeError(ComplexOut, Packed.data(), NumBins);
+		printf("%7d   %.2e\n", Size, Error);
+		TEST_CHECK(Error < Tolerance, "%d points: %.2e", Size, Error);
+		TEST_CHECK(memcmp(Packed.data(), Unshared.data(), NumBins * sizeof(kiss_fft_cpx)) == 0, "%d points: kiss_fftr_scratch differs from kiss_fftr", Size);
+	}
+	return GNumFailedChecks;
+}
@@ -0,0 +1,212 @@
+// How long the decoder thread stalls handing audio over while the game thread analyzes it.
+//
+// The producer delivers 1024 frame stereo buffers at 8x real time, as PlayAudioSink does, and times
+// each hand-over. The consumer analyzes the newest window over and over, as a level full of
+// analyzers would. Before: the int16 circular buffer, written a sample at a time under the lock
+// that the consumer holds while it analyzes. After: FAudioRingBuffer.
+//
+// Also checks that every window the ring hands out is consistent: the producer writes each frame's
+// index, so a torn window would show a gap.
+//
+//   RingBufferBench [seconds of audio]
+
+#include "TestHelpers.h"
+#include "SpectrumAnalysis.h"
+
+namespace
+{
+	const uint32 NumChannels = 2;
+	const uint32 SampleRate = 48000;
+	const uint32 BufferFrames = 1024;
+	const double Speedup = 8.0;
+
+	/** The history the analyzer kept before the ring: one lock around the samples and everything done with them */
+	class FLockedHistory
+	{
+	public:
+		explicit FLockedHistory(uint32 CapacitySamples)
+			: Samples(CapacitySamples, 0)
+			, CurSampleIndex(0)
+			, NumWritten(0)
+		{
+		}
+
+		void Write(const int16* Buffer, uint32 NumSamples)
+		{
+			FScopeLock ScopeLock(&CriticalSection);
+			for (uint32 Index = 0; Index < NumSamples; ++Index)
+			{
+				Samples[CurSampleIndex] = Buffer[Index];
+				CurSampleIndex = (CurSampleIndex + 1) & ((uint32)Samples.size() - 1);
+			}
+			NumWritten += NumSamples;
+		}
+
+		/** Converts the newest window and analyzes it without letting go of the lock, as DoCalculateFrequencySpectrum did */
+		bool Analyze(FSpectrumAnalysisEngine& Engine, const FSpectrumAnalysisSettings& Settings, uint32 FFTSize, TArray<float>& Planes, FSpectrumAnalysisResult& Out)
+		{
+			FScopeLock ScopeLock(&CriticalSection);
+			if (NumWritten < FFTSize * NumChannels)
+			{
+				return false;
+			}
+			const uint32 Mask = (uint32)Samples.size() - 1;
+			const uint32 First = (CurSampleIndex - FFTSize * NumChannels) & Mask;
+			for (uint32 Frame = 0; Frame < FFTSize; ++Frame)
+			{
+				for (uint32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					Planes[Channel * FFTSize + Frame] = Samples[(First + Frame * NumChannels + Channel) & Mask];
+				}
+			}
+			return Engine.Analyze(Settings, Planes.GetData(), NumChannels, SampleRate, 0, Out);
+		}
+
+	private:
+		FCriticalSection CriticalSection;
+		std::vector<int16> Samples;
+		uint32 CurSampleIndex;
+		uint64 NumWritten;
+	};
+
+	struct FStallStats
+	{
+		std::vector<double> Stalls;
+		int64 NumAnalyses = 0;
+		int64 NumTorn = 0;
+		int64 NumInconsistent = 0;
+	};
+
+	/** Runs Write(Buffer, FirstFrame) from a producer paced at Speedup times real time while Analyze() runs flat out */
+	template<typename WriteType, typename AnalyzeType>
+	void Run(double AudioSeconds, FStallStats& Stats, WriteType Write, AnalyzeType Analyze)
+	{
+		const int32 NumBuffers = (int32)(AudioSeconds * SampleRate / BufferFrames);
+		const double BufferSeconds = BufferFrames / (SampleRate * Speedup);
+		std::vector<int16> Buffer(BufferFrames * NumChannels);
+		volatile int32 bDone = 0;
+
+		std::thread Consumer([&]()
+		{
+			while (!bDone)
+			{
+				Analyze();
+			}
+		});
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 BufferIndex = 0; BufferIndex < NumBuffers; ++BufferIndex)
+		{
+			const double Due = Start + BufferIndex * BufferSeconds;
+			while (FPlatformTime::Seconds() < Due)
+			{
+				FPlatformProcess::Sleep(0.0002f);
+			}
+			for (uint32 Frame = 0; Frame < BufferFrames; ++Frame)
+			{
+				const int16 Value = (int16)(((uint64)BufferIndex * BufferFrames + Frame) & 0x7fff);
+				for (uint32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					Buffer[Frame * NumChannels + Channel] = Value;
+				}
+			}
+			const double WriteStart = FPlatformTime::Seconds();
+			Write(Buffer.data(), (uint64)BufferIndex * BufferFrames);
+			Stats.Stalls.push_back(FPlatformTime::Seconds() - WriteStart);
+		}
+		FPlatformAtomics::InterlockedExchange(&bDone, 1);
+		Consumer.join();
+	}
+
+	void Report(const char* Name, double AudioSeconds, FStallStats& Stats)
+	{
+		std::sort(Stats.Stalls.begin(), Stats.Stalls.end());
+		double Total = 0.0;
+		for (double Stall : Stats.Stalls)
+		{
+			Total += Stall;
+		}
+		const size_t Count = Stats.Stalls.size();
+		printf("%-7s %9.1f %9.1f %9.1f %9.1f %9.2f %10lld\n", Name, 1e6 * Total / Count, 1e6 * Stats.Stalls[Count / 2],
+			1e6 * Stats.Stalls[FMath::Min(Count - 1, Count * 999 / 1000)], 1e6 * Stats.Stalls.back(), 1e3 * Total / AudioSeconds, (long long)Stats.NumAnalyses);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double AudioSeconds = argc > 1 ? atof(argv[1]) : 20.0;
+
+	FSpectrumAnalysisSettings Settings;
+	Settings.WindowDurationInSeconds = 0.04f;
+	Settings.SpectrumWidth = 64;
+	Settings.AmplitudeBuckets = 10;
+	Settings.WindowType = ESpectrumWindowType::Hann;
+	Settings.BandScale = ESpectrumBandScale::Logarithmic;
+	Settings.MinFrequency = 20.f;
+	Settings.OctaveFraction = 3;
+	Settings.HopFraction = 0.5f;
+	Settings.Backend = ESpectrumAnalysisBackend::Native;
+	const uint32 FFTSize = Settings.GetFFTSize(SampleRate);
+
+	printf("%.0f s of %u channel audio at %.0fx real time, %u frame buffers, %u point analyses\n", AudioSeconds, NumChannels, Speedup, BufferFrames, FFTSize);
+	printf("        producer stall per buffer (us)            ms stalled\n");
+	printf("           mean    median     p99.9       max  per audio s   analyses\n");
+
+	{
+		FStallStats Stats;
+		FLockedHistory History(FMath::RoundUpToPowerOfTwo(SampleRate * 3 * NumChannels));
+		FSpectrumAnalysisEngine Engine;
+		FSpectrumAnalysisResult Result;
+		TArray<float> Planes;
+		Planes.SetNumUninitialized(FFTSize * NumChannels);
+		Run(AudioSeconds, Stats,
+			[&](const int16* Buffer, uint64) { History.Write(Buffer, BufferFrames * NumChannels); },
+			[&]() { Stats.NumAnalyses += History.Analyze(Engine, Settings, FFTSize, Planes, Result) ? 1 : 0; });
+		Report("before", AudioSeconds, Stats);
+	}
+
+	{
+		FStallStats Stats;
+		FAudioRingBuffer Ring(NumChannels, SampleRate, SampleRate * 3);
+		FSpectrumAnalysisEngine Engine;
+		FSpectrumAnalysisResult Result;
+		TArray<float> Planes;
+		Planes.SetNumUninitialized(FFTSize * NumChannels);
+		Run(AudioSeconds, Stats,
+			[&](const int16* Buffer, uint64 FirstFrame)
+			{
+				Ring.Write(Buffer, BufferFrames, FTimespan::FromSeconds((double)(FirstFrame + BufferFrames) / SampleRate));
+			},
+			[&]()
+			{
+				FTimespan EndTime;
+				const uint64 EndFrame = Ring.GetWritePosition(EndTime);
+				if (EndFrame < FFTSize)
+				{
+					return;
+				}
+				if (!Ring.ReadFrames(EndFrame, FFTSize, Planes.GetData(), FFTSize))
+				{
+					++Stats.NumTorn;
+					return;
+				}
+				for (uint32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					const float* Plane = Planes.GetData() + Channel * FFTSize;
+					for (uint32 Frame = 0; Frame < FFTSize; ++Frame)
+					{
+						if (Plane[Frame] != (float)((EndFrame - FFTSize + Frame) & 0x7fff))
+						{
+							++Stats.NumInconsistent;
+							break;
+						}
+					}
+				}
+				Stats.NumAnalyses += Engine.Analyze(Settings, Planes.GetData(), NumChannels, SampleRate, 0, Result) ? 1 : 0;
+			});
+		Report("after", AudioSeconds, Stats);
+		printf("ring: %lld windows lapped by the producer and rejected, %lld inconsistent windows accepted\n", (long long)Stats.NumTorn, (long long)Stats.NumInconsistent);
+		TEST_CHECK(Stats.NumInconsistent == 0, "%lld windows were torn", (long long)Stats.NumInconsistent);
+	}
+	return GNumFailedChecks;
+}
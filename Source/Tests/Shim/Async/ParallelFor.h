@@ -0,0 +1,34 @@
+// ParallelFor on plain threads, with index 0 run by the caller as the task graph version does.
+#pragma once
+
+inline void ParallelFor(int32 Num, std::function<void(int32)> Body, bool bForceSingleThread = false)
+{
+	if (bForceSingleThread)
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			Body(Index);
+		}
+		return;
+	}
+	std::vector<std::thread> Threads;
+	for (int32 Index = 1; Index < Num; ++Index)
+	{
+		Threads.emplace_back(Body, Index);
+	}
+	if (Num > 0)
+	{
+		Body(0);
+	}
+	for (std::thread& Thread : Threads)
+	{
+		Thread.join();
+	}
+}
+
+class FTaskGraphInterface
+{
+public:
+	static FTaskGraphInterface& Get() { static FTaskGraphInterface Interface; return Interface; }
+	int32 GetNumWorkerThreads() const { return FMath::Max((int32)std::thread::hardware_concurrency() - 1, 0); }
+};
@@ -0,0 +1,54 @@
+// FWaveModInfo and USoundWave, as far as the spectrogram baker reads them.
+#pragma once
+
+struct FWaveModInfo
+{
+	uint16* pFormatTag = nullptr;
+	uint16* pChannels = nullptr;
+	uint32* pSamplesPerSec = nullptr;
+	uint16* pBitsPerSample = nullptr;
+	uint8* SampleDataStart = nullptr;
+	uint32 SampleDataSize = 0;
+
+	bool ReadWaveInfo(uint8* WaveData, int32 WaveDataSize, FString* ErrorReason = nullptr)
+	{
+		if (WaveDataSize < 12 || memcmp(WaveData, "RIFF", 4) != 0 || memcmp(WaveData + 8, "WAVE", 4) != 0)
+		{
+			if (ErrorReason != nullptr)
+			{
+				*ErrorReason = "not a RIFF WAVE file";
+			}
+			return false;
+		}
+		for (int32 Position = 12; Position + 8 <= WaveDataSize;)
+		{
+			uint32 Length;
+			memcpy(&Length, WaveData + Position + 4, sizeof(Length));
+			if (memcmp(WaveData + Position, "fmt ", 4) == 0)
+			{
+				pFormatTag = (uint16*)(WaveData + Position + 8);
+				pChannels = (uint16*)(WaveData + Position + 10);
+				pSamplesPerSec = (uint32*)(WaveData + Position + 12);
+				pBitsPerSample = (uint16*)(WaveData + Position + 22);
+			}
+			else if (memcmp(WaveData + Position, "data", 4) == 0)
+			{
+				SampleDataStart = WaveData + Position + 8;
+				SampleDataSize = Length;
+			}
+			Position += 8 + Length + (Length & 1);
+		}
+		return pFormatTag != nullptr && SampleDataStart != nullptr;
+	}
+};
+
+class USoundWave
+{
+public:
+	uint8* RawPCMData = nullptr;
+	int32 RawPCMDataSize = 0;
+	int32 NumChannels = 0;
+	int32 SampleRate = 0;
+
+	FString GetName() const { return FString("SoundWave"); }
+};
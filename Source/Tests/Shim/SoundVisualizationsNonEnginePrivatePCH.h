@@ -0,0 +1,416 @@
+// Just enough of the engine for the plugin's engine independent sources to build and run standalone.
+// Each stand-in keeps the name and behavior of the engine type, implemented over the standard library.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <chrono>
+
+typedef int8_t int8;
+typedef uint8_t uint8;
+typedef int16_t int16;
+typedef uint16_t uint16;
+typedef int32_t int32;
+typedef uint32_t uint32;
+typedef int64_t int64;
+typedef uint64_t uint64;
+typedef size_t SIZE_T;
+typedef char TCHAR;
+
+#define TEXT(x) x
+#define FORCEINLINE inline
+#define check(x) assert(x)
+#define checkSlow(x) assert(x)
+#define INDEX_NONE (-1)
+#define ARRAY_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+#define MAX_flt (3.402823466e+38F)
+#define MAX_uint8 0xff
+#define MAX_uint16 0xffff
+#define MAX_int32 0x7fffffff
+#define MAX_int64 INT64_MAX
+#define PI (3.1415926535897932f)
+#define PLATFORM_ANDROID 0
+#define PLATFORM_WINDOWS 0
+#define PLATFORM_LINUX 1
+#define PLATFORM_MAC 0
+#define PLATFORM_IOS 0
+#define WITH_EDITORONLY_DATA 0
+#define DEFINE_LOG_CATEGORY_STATIC(...)
+#define UE_LOG(Category, Verbosity, Format, ...) (fprintf(stderr, #Verbosity ": " Format "\n", ##__VA_ARGS__))
+#define TCHAR_TO_UTF8(x) (x)
+
+struct FMath
+{
+	template<class T> static T Max(T A, T B) { return A > B ? A : B; }
+	template<class T> static T Min(T A, T B) { return A < B ? A : B; }
+	template<class T> static T Clamp(T X, T Min, T Max) { return X < Min ? Min : X > Max ? Max : X; }
+	template<class T> static T Abs(T X) { return X < 0 ? -X : X; }
+	template<class T, class U> static T Lerp(T A, T B, U Alpha) { return (T)(A + Alpha * (B - A)); }
+	static int32 RoundToInt(float X) { return (int32)floorf(X + 0.5f); }
+	static int32 FloorToInt(float X) { return (int32)floorf(X); }
+	static int32 CeilToInt(float X) { return (int32)ceilf(X); }
+	static float Loge(float X) { return logf(X); }
+	static float LogX(float Base, float X) { return logf(X) / logf(Base); }
+	static float Pow(float A, float B) { return powf(A, B); }
+	static float Sqrt(float X) { return sqrtf(X); }
+	static bool IsFinite(float X) { return std::isfinite(X); }
+	static uint32 RoundUpToPowerOfTwo(uint32 X) { uint32 P = 1; while (P < X) P <<= 1; return P; }
+};
+
+/** Allocates through operator new, so tests counting allocations see these too */
+struct FMemory
+{
+	static void* Memcpy(void* Dest, const void* Src, SIZE_T Count) { return memcpy(Dest, Src, Count); }
+	static int32 Memcmp(const void* A, const void* B, SIZE_T Count) { return memcmp(A, B, Count); }
+	static void* Memzero(void* Dest, SIZE_T Count) { return memset(Dest, 0, Count); }
+	template<class T> static void Memzero(T& Value) { memset(&Value, 0, sizeof(T)); }
+	static void* Malloc(SIZE_T Count, uint32 Alignment = 16)
+	{
+		Alignment = Alignment < 16 ? 16 : Alignment;
+		uint8* Raw = (uint8*)::operator new(Count + Alignment + sizeof(void*));
+		uint8* Aligned = (uint8*)(((uintptr_t)Raw + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1));
+		((void**)Aligned)[-1] = Raw;
+		return Aligned;
+	}
+	static void Free(void* Ptr)
+	{
+		if (Ptr != nullptr)
+		{
+			::operator delete(((void**)Ptr)[-1]);
+		}
+	}
+};
+
+template<int NumInlineElements> struct TInlineAllocator {};
+struct FDefaultAllocator {};
+
+/** std::vector allocator with room for N elements inside the array, like the engine's TInlineAllocator */
+template<class T, int N>
+struct TInlineStdAllocator
+{
+	typedef T value_type;
+	template<class U> struct rebind { typedef TInlineStdAllocator<U, N> other; };
+
+	TInlineStdAllocator() {}
+	// The copy gets its own buffer; moving would leave the vector pointing into the old one
+	TInlineStdAllocator(const TInlineStdAllocator&) {}
+	TInlineStdAllocator(TInlineStdAllocator&&) = delete;
+	TInlineStdAllocator& operator=(const TInlineStdAllocator&) { return *this; }
+
+	T* allocate(size_t Count)
+	{
+		if (Count <= (size_t)N && !bInlineUsed)
+		{
+			bInlineUsed = true;
+			return (T*)Inline;
+		}
+		return (T*)::operator new(Count * sizeof(T));
+	}
+	void deallocate(T* Ptr, size_t)
+	{
+		if (Ptr == (T*)Inline)
+		{
+			bInlineUsed = false;
+		}
+		else
+		{
+			::operator delete(Ptr);
+		}
+	}
+	bool operator==(const TInlineStdAllocator& Other) const { return this == &Other; }
+	bool operator!=(const TInlineStdAllocator& Other) const { return this != &Other; }
+
+private:
+	alignas(T) unsigned char Inline[N * sizeof(T)];
+	bool bInlineUsed = false;
+};
+
+template<class T, class AllocatorType> struct TStdStorage { typedef std::vector<T> Type; enum { NumInline = 0 }; };
+template<class T, int N> struct TStdStorage<T, TInlineAllocator<N>> { typedef std::vector<T, TInlineStdAllocator<T, N>> Type; enum { NumInline = N }; };
+
+/** TArray over std::vector; Reset and SetNum keep the allocation, as the engine's do */
+template<class T, class AllocatorType = FDefaultAllocator>
+class TArray
+{
+public:
+	// Takes the inline buffer up front; vector growth would otherwise allocate while it is in use
+	TArray() { Items.reserve(TStdStorage<T, AllocatorType>::NumInline); }
+	int32 Num() const { return (int32)Items.size(); }
+	T* GetData() { return Items.data(); }
+	const T* GetData() const { return Items.data(); }
+	T& operator[](int32 Index) { return Items[Index]; }
+	const T& operator[](int32 Index) const { return Items[Index]; }
+	void SetNum(int32 Count, bool /*bAllowShrinking*/ = true) { Items.resize(Count); }
+	void SetNumUninitialized(int32 Count) { Items.resize(Count); }
+	void SetNumZeroed(int32 Count) { Items.assign(Count, T()); }
+	int32 AddZeroed(int32 Count = 1) { const int32 Index = Num(); Items.resize(Index + Count); memset((void*)(Items.data() + Index), 0, Count * sizeof(T)); return Index; }
+	int32 AddUninitialized(int32 Count = 1) { const int32 Index = Num(); Items.resize(Index + Count); return Index; }
+	int32 AddDefaulted(int32 Count = 1) { const int32 Index = Num(); Items.resize(Index + Count); return Index; }
+	int32 Add(const T& Item) { Items.push_back(Item); return Num() - 1; }
+	int32 AddUnique(const T& Item) { for (int32 Index = 0; Index < Num(); ++Index) if (Items[Index] == Item) return Index; return Add(Item); }
+	template<class OtherAllocator> void Append(const TArray<T, OtherAllocator>& Other) { Items.insert(Items.end(), Other.GetData(), Other.GetData() + Other.Num()); }
+	void Append(const T* Ptr, int32 Count) { Items.insert(Items.end(), Ptr, Ptr + Count); }
+	void Reset(int32 NewSize = 0) { Items.clear(); Items.reserve(NewSize); }
+	void Empty(int32 Slack = 0) { Items.clear(); Items.shrink_to_fit(); Items.reserve(Slack); }
+	void Reserve(int32 Count) { Items.reserve(Count); }
+	void RemoveAtSwap(int32 Index) { Items[Index] = Items.back(); Items.pop_back(); }
+	void RemoveAt(int32 Index, int32 Count = 1) { Items.erase(Items.begin() + Index, Items.begin() + Index + Count); }
+	int32 RemoveSingle(const T& Item) { for (int32 Index = 0; Index < Num(); ++Index) if (Items[Index] == Item) { Items.erase(Items.begin() + Index); return 1; } return 0; }
+	T* begin() { return Items.data(); }
+	T* end() { return Items.data() + Items.size(); }
+	const T* begin() const { return Items.data(); }
+	const T* end() const { return Items.data() + Items.size(); }
+	bool operator==(const TArray& Other) const { return Items == Other.Items; }
+
+private:
+	typename TStdStorage<T, AllocatorType>::Type Items;
+};
+
+template<class T>
+class TArrayView
+{
+public:
+	TArrayView(T* InData, int32 InNum) : Data(InData), Count(InNum) {}
+	template<class AllocatorType> TArrayView(TArray<T, AllocatorType>& Array) : Data(Array.GetData()), Count(Array.Num()) {}
+	T* GetData() const { return Data; }
+	int32 Num() const { return Count; }
+	T& operator[](int32 Index) const { return Data[Index]; }
+
+private:
+	T* Data;
+	int32 Count;
+};
+
+inline uint32 GetTypeHash(int32 Value) { return (uint32)Value; }
+inline uint32 GetTypeHash(uint32 Value) { return Value; }
+inline uint32 GetTypeHash(uint64 Value) { return (uint32)Value + (uint32)(Value >> 32) * 23; }
+inline uint32 GetTypeHash(float Value) { uint32 Bits; memcpy(&Bits, &Value, sizeof(Bits)); return Bits; }
+inline uint32 HashCombine(uint32 A, uint32 C) { return A * 31 + C + 0x9e3779b9; }
+
+template<class KeyType> struct FTypeHasher { size_t operator()(const KeyType& Key) const { return GetTypeHash(Key); } };
+
+template<class KeyType, class ValueType>
+class TMap
+{
+	typedef std::unordered_map<KeyType, ValueType, FTypeHasher<KeyType>> FMapType;
+
+public:
+	ValueType* Find(const KeyType& Key) { auto It = Pairs.find(Key); return It == Pairs.end() ? nullptr : &It->second; }
+	const ValueType* Find(const KeyType& Key) const { auto It = Pairs.find(Key); return It == Pairs.end() ? nullptr : &It->second; }
+	ValueType& Add(const KeyType& Key) { return Pairs[Key]; }
+	ValueType& Add(const KeyType& Key, const ValueType& Value) { return Pairs[Key] = Value; }
+	int32 Remove(const KeyType& Key) { return (int32)Pairs.erase(Key); }
+	int32 Num() const { return (int32)Pairs.size(); }
+	void Empty() { Pairs.clear(); }
+
+	class TConstIterator
+	{
+	public:
+		explicit TConstIterator(const TMap& Map) : It(Map.Pairs.begin()), End(Map.Pairs.end()) {}
+		explicit operator bool() const { return It != End; }
+		TConstIterator& operator++() { ++It; return *this; }
+		const KeyType& Key() const { return It->first; }
+		const ValueType& Value() const { return It->second; }
+
+	private:
+		typename FMapType::const_iterator It;
+		typename FMapType::const_iterator End;
+	};
+
+private:
+	FMapType Pairs;
+};
+
+namespace ESPMode { enum Type { NotThreadSafe, Fast, ThreadSafe }; }
+
+template<class T, ESPMode::Type Mode = ESPMode::NotThreadSafe>
+class TSharedPtr : public std::shared_ptr<T>
+{
+public:
+	TSharedPtr() {}
+	TSharedPtr(std::nullptr_t) {}
+	template<class U> TSharedPtr(const TSharedPtr<U, Mode>& Other) : std::shared_ptr<T>(Other) {}
+	template<class U> TSharedPtr(const std::shared_ptr<U>& Other) : std::shared_ptr<T>(Other) {}
+	bool IsValid() const { return this->get() != nullptr; }
+	T* Get() const { return this->get(); }
+	void Reset() { this->reset(); }
+};
+
+template<class T, ESPMode::Type Mode = ESPMode::NotThreadSafe>
+class TSharedRef : public TSharedPtr<T, Mode>
+{
+public:
+	template<class U> TSharedRef(const std::shared_ptr<U>& Other) : TSharedPtr<T, Mode>(Other) {}
+};
+
+template<class T, ESPMode::Type Mode = ESPMode::NotThreadSafe>
+class TWeakPtr : public std::weak_ptr<T>
+{
+public:
+	TWeakPtr() {}
+	template<class U> TWeakPtr(const TSharedPtr<U, Mode>& Other) : std::weak_ptr<T>(Other) {}
+	template<class U> TWeakPtr& operator=(const TSharedPtr<U, Mode>& Other) { std::weak_ptr<T>::operator=(Other); return *this; }
+	TSharedPtr<T, Mode> Pin() const { return TSharedPtr<T, Mode>(this->lock()); }
+	bool IsValid() const { return !this->expired(); }
+	void Reset() { this->reset(); }
+};
+
+template<class T> std::shared_ptr<T> MakeShareable(T* Object) { return std::shared_ptr<T>(Object); }
+
+class FRWLock
+{
+public:
+	void ReadLock() { Mutex.lock_shared(); }
+	void ReadUnlock() { Mutex.unlock_shared(); }
+	void WriteLock() { Mutex.lock(); }
+	void WriteUnlock() { Mutex.unlock(); }
+
+private:
+	std::shared_timed_mutex Mutex;
+};
+
+class FCriticalSection
+{
+public:
+	void Lock() { Mutex.lock(); }
+	void Unlock() { Mutex.unlock(); }
+
+private:
+	std::recursive_mutex Mutex;
+};
+
+class FScopeLock
+{
+public:
+	explicit FScopeLock(FCriticalSection* InSection) : Section(InSection) { Section->Lock(); }
+	~FScopeLock() { Section->Unlock(); }
+
+private:
+	FCriticalSection* Section;
+};
+
+struct FPlatformAtomics
+{
+	static int32 InterlockedIncrement(volatile int32* Value) { return __sync_add_and_fetch(Value, 1); }
+	static int64 InterlockedIncrement(volatile int64* Value) { return __sync_add_and_fetch(Value, 1); }
+	static int32 InterlockedDecrement(volatile int32* Value) { return __sync_sub_and_fetch(Value, 1); }
+	static int64 InterlockedDecrement(volatile int64* Value) { return __sync_sub_and_fetch(Value, 1); }
+	static int32 InterlockedAdd(volatile int32* Value, int32 Amount) { return __sync_fetch_and_add(Value, Amount); }
+	static int64 InterlockedAdd(volatile int64* Value, int64 Amount) { return __sync_fetch_and_add(Value, Amount); }
+	static int32 InterlockedExchange(volatile int32* Value, int32 Exchange) { return __atomic_exchange_n(Value, Exchange, __ATOMIC_SEQ_CST); }
+	static int64 InterlockedExchange(volatile int64* Value, int64 Exchange) { return __atomic_exchange_n(Value, Exchange, __ATOMIC_SEQ_CST); }
+	static int32 InterlockedCompareExchange(volatile int32* Dest, int32 Exchange, int32 Comparand) { return __sync_val_compare_and_swap(Dest, Comparand, Exchange); }
+	static int64 InterlockedCompareExchange(volatile int64* Dest, int64 Exchange, int64 Comparand) { return __sync_val_compare_and_swap(Dest, Comparand, Exchange); }
+	static void* InterlockedCompareExchangePointer(void** Dest, void* Exchange, void* Comparand) { return __sync_val_compare_and_swap(Dest, Comparand, Exchange); }
+};
+
+namespace ETimespan { const int64 TicksPerSecond = 10000000; }
+
+class FTimespan
+{
+public:
+	FTimespan() : Ticks(0) {}
+	explicit FTimespan(int64 InTicks) : Ticks(InTicks) {}
+	int64 GetTicks() const { return Ticks; }
+	double GetTotalSeconds() const { return (double)Ticks / ETimespan::TicksPerSecond; }
+	static FTimespan FromSeconds(double Seconds) { return FTimespan((int64)(Seconds * ETimespan::TicksPerSecond)); }
+	static FTimespan MinValue() { return FTimespan(INT64_MIN); }
+	static FTimespan MaxValue() { return FTimespan(INT64_MAX); }
+	FTimespan operator-(const FTimespan& Other) const { return FTimespan(Ticks - Other.Ticks); }
+	FTimespan operator+(const FTimespan& Other) const { return FTimespan(Ticks + Other.Ticks); }
+	bool operator<=(const FTimespan& Other) const { return Ticks <= Other.Ticks; }
+	bool operator<(const FTimespan& Other) const { return Ticks < Other.Ticks; }
+	bool operator>=(const FTimespan& Other) const { return Ticks >= Other.Ticks; }
+	bool operator>(const FTimespan& Other) const { return Ticks > Other.Ticks; }
+	bool operator==(const FTimespan& Other) const { return Ticks == Other.Ticks; }
+	bool operator!=(const FTimespan& Other) const { return Ticks != Other.Ticks; }
+
+private:
+	int64 Ticks;
+};
+
+class FString
+{
+public:
+	FString() {}
+	FString(const char* InString) : String(InString) {}
+	const char* operator*() const { return String.c_str(); }
+	FString operator+(const char* Suffix) const { return FString((String + Suffix).c_str()); }
+	bool operator==(const FString& Other) const { return String == Other.String; }
+	bool operator!=(const FString& Other) const { return String != Other.String; }
+	bool IsEmpty() const { return String.empty(); }
+	void Empty() { String.clear(); }
+	bool RemoveFromStart(const char* Prefix) { const size_t Length = strlen(Prefix); if (String.compare(0, Length, Prefix) == 0) { String.erase(0, Length); return true; } return false; }
+
+private:
+	std::string String;
+};
+
+/** Writers only, which is all the plugin creates */
+class FArchive
+{
+public:
+	explicit FArchive(const char* Path) : Stream(Path, std::ios::binary) {}
+	virtual ~FArchive() {}
+	void Serialize(void* Data, int64 Num) { Stream.write((const char*)Data, Num); }
+	int64 Tell() { return (int64)Stream.tellp(); }
+	void Seek(int64 Position) { Stream.seekp(Position); }
+	bool IsError() const { return !Stream.good(); }
+	bool Close() { Stream.close(); return !Stream.fail(); }
+
+private:
+	std::ofstream Stream;
+};
+
+class IFileManager
+{
+public:
+	static IFileManager& Get() { static IFileManager Manager; return Manager; }
+	FArchive* CreateFileWriter(const char* Path, uint32 /*WriteFlags*/ = 0) { FArchive* Writer = new FArchive(Path); if (Writer->IsError()) { delete Writer; return nullptr; } return Writer; }
+	int64 FileSize(const char* Path) { std::ifstream File(Path, std::ios::binary | std::ios::ate); return File ? (int64)File.tellg() : -1; }
+	bool Delete(const char* Path, bool /*bRequireExists*/ = false, bool /*bEvenReadOnly*/ = false, bool /*bQuiet*/ = false) { return remove(Path) == 0; }
+	bool Move(const char* Dest, const char* Src, bool /*bReplace*/ = true, bool /*bEvenIfReadOnly*/ = false, bool /*bAttributes*/ = false, bool /*bDoNotRetryOrError*/ = false) { return rename(Src, Dest) == 0; }
+	FString ConvertToAbsolutePathForExternalAppForRead(const char* Path) { return FString(Path); }
+};
+
+#define FILEREAD_Silent 1
+
+struct FFileHelper
+{
+	static bool LoadFileToArray(TArray<uint8>& Result, const char* Path, uint32 /*Flags*/ = 0)
+	{
+		std::ifstream File(Path, std::ios::binary | std::ios::ate);
+		if (!File)
+		{
+			return false;
+		}
+		Result.SetNumUninitialized((int32)File.tellg());
+		File.seekg(0);
+		File.read((char*)Result.GetData(), Result.Num());
+		return true;
+	}
+};
+
+struct FPlatformProcess
+{
+	static void Sleep(float Seconds) { std::this_thread::sleep_for(std::chrono::microseconds((int64)(Seconds * 1e6))); }
+};
+
+struct FPlatformTime
+{
+	static double Seconds() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+};
@@ -0,0 +1,36 @@
+// The enums of Classes/SpectrumAnalyzer.h, without the UObject that needs the engine to build.
+// Keep them in the same order as there.
+#pragma once
+
+enum class ESpectrumWindowType : uint8
+{
+	Hann,
+	Hamming,
+	BlackmanHarris,
+	Kaiser,
+	FlatTop,
+};
+
+enum class ESpectrumBandScale : uint8
+{
+	Linear,
+	Logarithmic,
+	Mel,
+	Bark,
+	Octave,
+};
+
+enum class ESpectrumAnalysisBackend : uint8
+{
+	Native,
+	PlatformFFT,
+};
+
+enum class ESpectrogramBakePrecision : uint8
+{
+	EightBit,
+	SixteenBit,
+};
+
+class FBakedSpectrogram;
+class USoundWave;
@@ -0,0 +1,64 @@
+// Checks, timing and test signals shared by the standalone tests and benchmarks.
+#pragma once
+
+#include "SoundVisualizationsNonEnginePrivatePCH.h"
+
+/** Checks that have failed so far; every test returns it from main, so make check stops at the first failing test */
+static int32 GNumFailedChecks = 0;
+
+#define TEST_CHECK(Condition, Format, ...) \
+	do \
+	{ \
+		if (!(Condition)) \
+		{ \
+			++GNumFailedChecks; \
+			fprintf(stderr, "%s:%d: check failed: %s: " Format "\n", __FILE__, __LINE__, #Condition, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/** Seconds taken by the fastest of Repeats runs of Body */
+template<typename BodyType>
+double TimeBestOf(int32 Repeats, BodyType Body)
+{
+	double Best = 1e30;
+	for (int32 Repeat = 0; Repeat < Repeats; ++Repeat)
+	{
+		const double Start = FPlatformTime::Seconds();
+		Body();
+		Best = FMath::Min(Best, FPlatformTime::Seconds() - Start);
+	}
+	return Best;
+}
+
+/** Repeatable noise, so every run and every platform sees the same signals */
+class FTestRandom
+{
+public:
+	explicit FTestRandom(uint32 Seed = 1) : State(Seed) {}
+
+	uint32 NextBits()
+	{
+		State = State * 1664525u + 1013904223u;
+		return State >> 8;
+	}
+	/** Uniform in [-1, 1) */
+	float NextSigned() { return (float)NextBits() / (float)(1u << 23) - 1.f; }
+
+private:
+	uint32 State;
+};
+
+/** Interleaved int16 audio: a tone per channel, each a little higher than the last, plus a little noise */
+inline void MakeTestAudio(int16* Out, uint32 NumChannels, int64 NumFrames, uint32 SampleRate, uint32 Seed = 1)
+{
+	FTestRandom Random(Seed);
+	for (int64 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const double Time = (double)Frame / SampleRate;
+		for (uint32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			const double Tone = 8000.0 * sin(2.0 * PI * (220.0 * (Channel + 1)) * Time);
+			Out[Frame * NumChannels + Channel] = (int16)(Tone + 500.f * Random.NextSigned());
+		}
+	}
+}
@@ -0,0 +1,274 @@
+// Band levels VisualizerSpectrum maps from emulated Android Visualizer captures.
+//
+// A capture is made here the way the Visualizer makes one: the 8 bit waveform is widened to the int16
+// scale, transformed, divided by the capture size, and every component shifted down 5 bits into a
+// byte, halved further while it does not fit, and packed with DC and Nyquist sharing the first pair.
+// Tones in bands one bin wide must read their known level; mixes on the other band layouts must read
+// what FBandMap gives for the exact transform of the same waveform; and the packing, the channel
+// planes and the failure cases must behave as VisualizerSpectrum.h says.
+
+#include "TestHelpers.h"
+#include "VisualizerSpectrum.h"
+#include "BandMapper.h"
+
+namespace
+{
+	const uint32 SampleRates[] = { 44100, 48000 };
+	const int32 CaptureSizes[] = { 128, 256, 512, 1024 };
+	const int32 NumMixes = 100;
+
+	/** The waveform the Visualizer captures: bytes around 128, widened as its FFT widens them */
+	std::vector<double> QuantizeWaveform(const std::vector<double>& Signal)
+	{
+		std::vector<double> Waveform(Signal.size());
+		for (size_t Index = 0; Index < Signal.size(); ++Index)
+		{
+			const int32 Byte = FMath::Clamp((int32)floor(128.0 + Signal[Index] / 256.0 + 0.5), 0, 255);
+			Waveform[Index] = (Byte - 128) * 256.0;
+		}
+		return Waveform;
+	}
+
+	/** Bins 0 .. N / 2 of the exact transform, unscaled as kiss_fftr leaves them */
+	std::vector<kiss_fft_cpx> Transform(const std::vector<double>& Waveform)
+	{
+		const int32 Size = (int32)Waveform.size();
+		std::vector<kiss_fft_cpx> Bins(Size / 2 + 1);
+		for (int32 Bin = 0; Bin <= Size / 2; ++Bin)
+		{
+			double Real = 0.0, Imag = 0.0;
+			for (int32 Index = 0; Index < Size; ++Index)
+			{
+				const double Phase = 2.0 * PI * (double)((int64)Bin * Index % Size) / Size;
+				Real += Waveform[Index] * cos(Phase);
+				Imag -= Waveform[Index] * sin(Phase);
+			}
+			Bins[Bin].r = (float)Real;
+			Bins[Bin].i = (float)Imag;
+		}
+		return Bins;
+	}
+
+	int8 PackComponent(double Value, int32 Size)
+	{
+		int32 Packed = (int32)floor(Value / Size) >> 5;
+		while (Packed > 127 || Packed < -128)
+		{
+			Packed >>= 1;
+		}
+		return (int8)Packed;
+	}
+
+	FVisualizerCapture MakeCapture(const std::vector<kiss_fft_cpx>& Bins, uint32 SampleRate)
+	{
+		const int32 Size = ((int32)Bins.size() - 1) * 2;
+		FVisualizerCapture Capture;
+		Capture.SampleRate = SampleRate;
+		Capture.Bins.SetNumUninitialized(Size);
+		Capture.Bins[0] = PackComponent(Bins[0].r, Size);
+		Capture.Bins[1] = PackComponent(Bins[Size / 2].r, Size);
+		for (int32 Bin = 1; Bin < Size / 2; ++Bin)
+		{
+			Capture.Bins[2 * Bin] = PackComponent(Bins[Bin].r, Size);
+			Capture.Bins[2 * Bin + 1] = PackComponent(Bins[Bin].i, Size);
+		}
+		return Capture;
+	}
+
+	FSpectrumAnalysisSettings MakeSettings(ESpectrumBandScale Scale, int32 NumBands)
+	{
+		FSpectrumAnalysisSettings Settings;
+		Settings.SpectrumWidth = NumBands;
+		Settings.AmplitudeBuckets = 10;
+		Settings.BandScale = Scale;
+		Settings.MinFrequency = 40.f;
+		Settings.OctaveFraction = 3;
+		Settings.Backend = ESpectrumAnalysisBackend::PlatformFFT;
+		return Settings;
+	}
+
+	/** Linear bands one bin wide: band k - 1 holds bin k, and a tone of amplitude A centred on it reads 20 log10(A) */
+	void CheckTones(int32 Size, uint32 SampleRate, double& WorstError)
+	{
+		const FSpectrumAnalysisSettings Settings = MakeSettings(ESpectrumBandScale::Linear, Size / 2);
+		FTestRandom Random(Size + SampleRate);
+		const double Amplitudes[] = { 2048.0, 4096.0, 7936.0 };
+		for (double Amplitude : Amplitudes)
+		{
+			const int32 ToneBin = 1 + Random.NextBits() % (Size / 2 - 1);
+			const double Phase = PI * Random.NextSigned();
+			std::vector<double> Signal(Size);
+			for (int32 Index = 0; Index < Size; ++Index)
+			{
+				Signal[Index] = Amplitude * cos(2.0 * PI * ToneBin * Index / Size + Phase);
+			}
+
+			FSpectrumAnalysisResult Result;
+			Result.NumChannels = 1;
+			const bool bMapped = VisualizerSpectrum::MapSpectrum(Settings, MakeCapture(Transform(QuantizeWaveform(Signal)), SampleRate), Result);
+			TEST_CHECK(bMapped, "%d point capture at %u Hz", Size, SampleRate);
+			if (!bMapped)
+			{
+				continue;
+			}
+
+			const float* Bands = Result.GetSpectrum(0);
+			const double Expected = 20.0 * log10(Amplitude);
+			const double Error = FMath::Abs(Bands[ToneBin - 1] - Expected);
+			WorstError = FMath::Max(WorstError, Error);
+			TEST_CHECK(Error < 0.75, "%d points at %u Hz, bin %d of amplitude %.0f: %.2f dB, expected %.2f", Size, SampleRate, ToneBin, Amplitude, Bands[ToneBin - 1], Expected);
+			// The shift rounds down, so bins the tone misses may read -1 in both parts, but no more
+			const double OneStep = 20.0 * log10(64.0 * sqrt(2.0)) + 0.01;
+			for (int32 Band = 0; Band < Size / 2; ++Band)
+			{
+				TEST_CHECK(Band == ToneBin - 1 || Bands[Band] < OneStep, "%d points at %u Hz: band %d reads %.2f dB beside a %.2f dB tone", Size, SampleRate, Band, Bands[Band], Expected);
+			}
+		}
+
+		// Nyquist is packed into the second byte; alternating samples of A put A * N into it, which reads 20 log10(2A)
+		std::vector<double> Signal(Size);
+		for (int32 Index = 0; Index < Size; ++Index)
+		{
+			Signal[Index] = (Index & 1) != 0 ? -2048.0 : 2048.0;
+		}
+		FSpectrumAnalysisResult Result;
+		Result.NumChannels = 1;
+		VisualizerSpectrum::MapSpectrum(Settings, MakeCapture(Transform(QuantizeWaveform(Signal)), SampleRate), Result);
+		const double NyquistLevel = Result.GetSpectrum(0)[Size / 2 - 1];
+		TEST_CHECK(FMath::Abs(NyquistLevel - 20.0 * log10(4096.0)) < 0.25, "%d points at %u Hz: Nyquist reads %.2f dB", Size, SampleRate, NyquistLevel);
+	}
+
+	/** Two tones and noise at random levels on a perceptual layout, against FBandMap over the exact transform */
+	void CheckMixes(ESpectrumBandScale Scale, int32 Size, uint32 SampleRate, double& SumError, int32& NumErrors, double& WorstError)
+	{
+		const FSpectrumAnalysisSettings Settings = MakeSettings(Scale, 32);
+		FBandMapSettings BandSettings;
+		BandSettings.FFTSize = Size;
+		BandSettings.SampleRate = SampleRate;
+		BandSettings.NumBands = Settings.SpectrumWidth;
+		BandSettings.Scale = Settings.BandScale;
+		BandSettings.OctaveFraction = Settings.OctaveFraction;
+		BandSettings.MinFrequency = Settings.MinFrequency;
+		const FBandMap BandMap(BandSettings);
+		// Bands 16 packed steps loud, 18 dB below the loudest tone here
+		const float ResolvedLevel = 20.f * log10f(64.f * 16.f);
+
+		FTestRandom Random(Size * 3 + (uint32)Scale);
+		for (int32 Mix = 0; Mix < NumMixes; ++Mix)
+		{
+			const double Level1 = 8000.0 * (Random.NextSigned() * 0.25 + 0.75);
+			const double Level2 = 2000.0 * (Random.NextSigned() * 0.5 + 0.5);
+			const double Bin1 = 2.0 + (Random.NextBits() % (Size / 2 - 4)) + (Random.NextSigned() * 0.5 + 0.5);
+			const double Bin2 = 2.0 + (Random.NextBits() % (Size / 2 - 4)) + (Random.NextSigned() * 0.5 + 0.5);
+			const double Noise = 1000.0 * (Random.NextSigned() * 0.5 + 0.5);
+			std::vector<double> Signal(Size);
+			for (int32 Index = 0; Index < Size; ++Index)
+			{
+				Signal[Index] = Level1 * sin(2.0 * PI * Bin1 * Index / Size + Mix) + Level2 * sin(2.0 * PI * Bin2 * Index / Size)
+					+ Noise * Random.NextSigned();
+			}
+			const std::vector<kiss_fft_cpx> Bins = Transform(QuantizeWaveform(Signal));
+
+			float Expected[32] = {};
+			BandMap.AccumulatePower(Bins.data(), Expected);
+			FBandMap::PowerToDecibels(Expected, Settings.SpectrumWidth);
+			FSpectrumAnalysisResult Result;
+			Result.NumChannels = 1;
+			const bool bMapped = VisualizerSpectrum::MapSpectrum(Settings, MakeCapture(Bins, SampleRate), Result);
+			TEST_CHECK(bMapped, "%d point capture at %u Hz", Size, SampleRate);
+			if (!bMapped)
+			{
+				continue;
+			}
+			for (int32 Band = 0; Band < Settings.SpectrumWidth; ++Band)
+			{
+				// Quieter bands are mostly rounding in the packed bytes
+				if (Expected[Band] > ResolvedLevel)
+				{
+					const double Error = FMath::Abs((double)Result.GetSpectrum(0)[Band] - Expected[Band]);
+					SumError += Error;
+					++NumErrors;
+					WorstError = FMath::Max(WorstError, Error);
+				}
+			}
+		}
+	}
+
+	void CheckContract()
+	{
+		const FSpectrumAnalysisSettings Settings = MakeSettings(ESpectrumBandScale::Logarithmic, 16);
+		std::vector<double> Signal(512);
+		for (int32 Index = 0; Index < 512; ++Index)
+		{
+			Signal[Index] = 6000.0 * sin(2.0 * PI * 37.0 * Index / 512);
+		}
+		FVisualizerCapture Capture = MakeCapture(Transform(QuantizeWaveform(Signal)), 48000);
+		Capture.Time = FTimespan::FromSeconds(2.5);
+
+		// Every channel gets the bands of the mix
+		FSpectrumAnalysisResult Result;
+		Result.NumChannels = 3;
+		TEST_CHECK(VisualizerSpectrum::MapSpectrum(Settings, Capture, Result), "stereo capture");
+		TEST_CHECK(Result.SpectrumWidth == 16 && Result.Spectrum.Num() == 16 * 4, "%d bands in %d values", Result.SpectrumWidth, Result.Spectrum.Num());
+		for (uint32 Channel = 1; Channel <= Result.NumChannels; ++Channel)
+		{
+			TEST_CHECK(memcmp(Result.GetSpectrum(0), Result.GetSpectrum(Channel), 16 * sizeof(float)) == 0, "channel %u differs from the mix", Channel);
+		}
+
+		// Without a ring the amplitudes read 0 and the result takes the capture's time
+		FSpectrumAnalysisEngine Engine;
+		FSpectrumAnalysisResult Analyzed;
+		TEST_CHECK(VisualizerSpectrum::Analyze(Engine, Settings, Capture, nullptr, FSpectrumAnalysisWindow(), FTimespan(0), Analyzed), "analysis without a ring");
+		TEST_CHECK(Analyzed.NumChannels == 1 && Analyzed.Time == Capture.Time, "%u channels", Analyzed.NumChannels);
+		TEST_CHECK(Analyzed.Amplitude.Num() == 20 && Analyzed.GetAmplitude(0)[0] == 0.f, "%d amplitude values", Analyzed.Amplitude.Num());
+		TEST_CHECK(memcmp(Analyzed.GetSpectrum(1), Result.GetSpectrum(0), 16 * sizeof(float)) == 0, "Analyze mapped different bands");
+
+		FSpectrumAnalysisSettings NoBands = Settings;
+		NoBands.SpectrumWidth = 0;
+		TEST_CHECK(VisualizerSpectrum::MapSpectrum(NoBands, Capture, Result) && Result.Spectrum.Num() == 0, "no bands asked for");
+
+		FVisualizerCapture Empty;
+		Empty.SampleRate = 48000;
+		TEST_CHECK(!VisualizerSpectrum::MapSpectrum(Settings, Empty, Result), "empty capture");
+		TEST_CHECK(!VisualizerSpectrum::Analyze(Engine, Settings, Empty, nullptr, FSpectrumAnalysisWindow(), FTimespan(0), Analyzed), "analysis of an empty capture");
+		FVisualizerCapture NoRate = Capture;
+		NoRate.SampleRate = 0;
+		TEST_CHECK(!VisualizerSpectrum::MapSpectrum(Settings, NoRate, Result), "capture without a sample rate");
+		Result.NumChannels = 0;
+		TEST_CHECK(!VisualizerSpectrum::MapSpectrum(Settings, Capture, Result), "result without channels");
+	}
+}
+
+int main()
+{
+	double WorstToneError = 0.0;
+	for (uint32 SampleRate : SampleRates)
+	{
+		for (int32 Size : CaptureSizes)
+		{
+			CheckTones(Size, SampleRate, WorstToneError);
+		}
+	}
+	printf("tones in one bin bands: largest error %.3f dB\n\n", WorstToneError);
+
+	printf("%d mixes per size, 32 bands; error in dB of bands 16 packed steps loud or more\n", NumMixes);
+	printf("%-12s %7s  %6s  %6s\n", "scale", "capture", "mean", "max");
+	const ESpectrumBandScale Scales[] = { ESpectrumBandScale::Logarithmic, ESpectrumBandScale::Octave, ESpectrumBandScale::Mel, ESpectrumBandScale::Bark };
+	const char* ScaleNames[] = { "logarithmic", "octave", "mel", "bark" };
+	for (int32 ScaleIndex = 0; ScaleIndex < (int32)ARRAY_COUNT(Scales); ++ScaleIndex)
+	{
+		for (int32 Size : CaptureSizes)
+		{
+			double SumError = 0.0, WorstError = 0.0;
+			int32 NumErrors = 0;
+			CheckMixes(Scales[ScaleIndex], Size, 48000, SumError, NumErrors, WorstError);
+			const double MeanError = NumErrors > 0 ? SumError / NumErrors : 0.0;
+			printf("%-12s %7d  %6.3f  %6.3f\n", ScaleNames[ScaleIndex], Size, MeanError, WorstError);
+			TEST_CHECK(NumErrors > 0, "%s, %d points: no band was loud enough to compare", ScaleNames[ScaleIndex], Size);
+			TEST_CHECK(MeanError < 0.15 && WorstError < 1.0, "%s, %d points: mean %.3f dB, max %.3f dB", ScaleNames[ScaleIndex], Size, MeanError, WorstError);
+		}
+	}
+
+	CheckContract();
+	return GNumFailedChecks;
+}